@@ -0,0 +1,432 @@
+// any_bloom
+//
+// A single-file library that provides Bloom filters, in the standard and in
+// the cache line blocked variant, built on any_hash.
+//
+// To use this library you should choose a suitable file to put the
+// implementation and define ANY_BLOOM_IMPLEMENT. For example
+//
+//    #define ANY_BLOOM_IMPLEMENT
+//    #include "any_bloom.h"
+//
+// The keys are hashed with any_hash, so its implementation must be included
+// in some file of the project as well (not necessarily the same).
+//
+// Additionally, you can customize the library behavior by defining certain
+// macros in the file where you put the implementation. You can see which are
+// supported by reading the code guarded by ANY_BLOOM_IMPLEMENT.
+//
+// This library is licensed under the terms of the MIT license.
+// A copy of the license is included at the end of this file.
+//
+
+// How does it work?
+//
+// A Bloom filter answers whether a key may have been added (with a small
+// chance of a false positive) or surely was not. Every key is hashed once
+// with any_hash_xxh64 and the k bits of the key are derived from the two
+// halves of the hash (double hashing, h1 + i * h2).
+//
+// In the standard filter the bits are spread over the whole array, so a
+// lookup touches up to k cache lines. The blocked filter picks a 64 byte
+// block with h1 and sets all the bits in it, so a lookup touches a single
+// cache line, at the cost of a slightly higher false positive rate for the
+// same size.
+//
+
+#ifndef ANY_BLOOM_INCLUDE
+#define ANY_BLOOM_INCLUDE
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "any_hash.h"
+
+#define ANY_BLOOM_BLOCKED (1 << 0)
+
+// The size of the header of a serialized filter, the bits follow it
+#define ANY_BLOOM_HEADER 64
+
+typedef struct {
+    uint8_t *bits;
+    uint64_t size;
+    uint32_t hashes;
+    uint32_t flags;
+    uint64_t seed;
+    void *memory;
+} any_bloom_t;
+
+// Initialize an empty filter sized for count keys with the given false
+// positive rate (for example 0.01), with ANY_BLOOM_BLOCKED in flags for the
+// blocked variant. This function returns false if the filter would be too
+// big or the allocation fails.
+//
+// The standard filter has at most 2^32 bits (512 MiB).
+//
+bool any_bloom_init(any_bloom_t *bloom, size_t count, double rate, uint64_t seed, uint32_t flags);
+
+// Free the filter (it does nothing for loaded filters).
+//
+void any_bloom_free(any_bloom_t *bloom);
+
+void any_bloom_add(any_bloom_t *bloom, const uint8_t *key, size_t length);
+
+bool any_bloom_has(const any_bloom_t *bloom, const uint8_t *key, size_t length);
+
+// Add or look up a key by its hash, which must be any_hash_xxh64 of the key
+// with the seed of the filter (or any_hash_xxh64_u64 for integer keys).
+//
+void any_bloom_add_hash(any_bloom_t *bloom, uint64_t hash);
+
+bool any_bloom_has_hash(const any_bloom_t *bloom, uint64_t hash);
+
+// Add or look up count keys at once, storing in results[i] whether keys[i]
+// may be in the filter. The keys are hashed with any_hash_xxh64_batch and
+// the cache lines of a group of keys are prefetched before they are used,
+// so that their misses overlap.
+//
+void any_bloom_add_batch(any_bloom_t *bloom, const uint8_t **keys, const size_t *lengths, size_t count);
+
+void any_bloom_has_batch(const any_bloom_t *bloom, const uint8_t **keys, const size_t *lengths,
+                         size_t count, bool *results);
+
+// Serialization
+//
+// A serialized filter is a header of ANY_BLOOM_HEADER bytes (the magic
+// "ANYBLOOM", the version and the parameters of the filter, in little endian)
+// followed by the bits. The format doesn't depend on the cpu, so filters can
+// be shipped between processes and machines. For example
+//
+//    size_t size = any_bloom_serialized_size(&bloom);
+//    uint8_t *buffer = malloc(size);
+//    any_bloom_serialize(&bloom, buffer);
+//    fwrite(buffer, 1, size, file);
+//
+// and in another process
+//
+//    void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+//
+//    any_bloom_t bloom;
+//    if (!any_bloom_load(&bloom, map, size))
+//        ...
+//
+size_t any_bloom_serialized_size(const any_bloom_t *bloom);
+
+void any_bloom_serialize(const any_bloom_t *bloom, uint8_t *buffer);
+
+// Make a filter that uses the bits in data in place, without copying them.
+// This function returns false if data is not a valid serialized filter.
+//
+// NOTE: The filter can be used for lookups only, unless the memory in data
+//       is writable
+//
+bool any_bloom_load(any_bloom_t *bloom, const uint8_t *data, size_t size);
+
+#endif
+
+#ifdef ANY_BLOOM_IMPLEMENT
+
+#include <string.h>
+#include <math.h>
+
+// The filters are allocated with ANY_BLOOM_MALLOC and freed with ANY_BLOOM_FREE.
+// You can change allocation strategy by defining these macros in the
+// implementation file like so
+//
+//    #define ANY_BLOOM_IMPLEMENT
+//    #define ANY_BLOOM_MALLOC my_malloc
+//    #define ANY_BLOOM_FREE my_free
+//    #include "any_bloom.h"
+//
+#ifndef ANY_BLOOM_MALLOC
+#include <stdlib.h>
+#define ANY_BLOOM_MALLOC malloc
+#define ANY_BLOOM_FREE free
+#endif
+
+// The keys of a batch are hashed and prefetched in groups of this size
+#ifndef ANY_BLOOM_BATCH
+#define ANY_BLOOM_BATCH 32
+#endif
+
+#define ANY_BLOOM_LINE 64
+#define ANY_BLOOM_LINE_BITS (ANY_BLOOM_LINE * 8)
+#define ANY_BLOOM_MAX_HASHES 32
+
+#define ANY_BLOOM_MAGIC "ANYBLOOM"
+#define ANY_BLOOM_VERSION 1
+
+#ifdef __GNUC__
+#define ANY_BLOOM_PREFETCH(address) __builtin_prefetch(address)
+#else
+#define ANY_BLOOM_PREFETCH(address) ((void)(address))
+#endif
+
+// Map a 32 bit value to [0, range) without a division
+static inline uint64_t any_bloom_reduce(uint32_t value, uint64_t range)
+{
+    return (uint64_t)value * range >> 32;
+}
+
+// The block of a key is chosen with the low half of the hash, the bits in
+// the block are derived from the high half (the step is odd, so that the
+// first 512 of them are all distinct)
+static inline const uint8_t *any_bloom_block(const any_bloom_t *bloom, uint64_t hash)
+{
+    return bloom->bits + any_bloom_reduce((uint32_t)hash, bloom->size / ANY_BLOOM_LINE_BITS) * ANY_BLOOM_LINE;
+}
+
+static inline void any_bloom_set(uint8_t *bits, uint64_t bit)
+{
+    bits[bit >> 3] |= (uint8_t)(1 << (bit & 7));
+}
+
+static inline bool any_bloom_get(const uint8_t *bits, uint64_t bit)
+{
+    return (bits[bit >> 3] >> (bit & 7)) & 1;
+}
+
+void any_bloom_add_hash(any_bloom_t *bloom, uint64_t hash)
+{
+    const uint32_t h1 = (uint32_t)hash;
+    const uint32_t h2 = (uint32_t)(hash >> 32);
+
+    if (bloom->flags & ANY_BLOOM_BLOCKED) {
+        uint8_t *block = (uint8_t *)any_bloom_block(bloom, hash);
+        const uint32_t step = (h2 >> 16) | 1;
+        for (uint32_t i = 0; i < bloom->hashes; i++)
+            any_bloom_set(block, (h2 + i * step) & (ANY_BLOOM_LINE_BITS - 1));
+    } else {
+        for (uint32_t i = 0; i < bloom->hashes; i++)
+            any_bloom_set(bloom->bits, any_bloom_reduce(h1 + i * h2, bloom->size));
+    }
+}
+
+bool any_bloom_has_hash(const any_bloom_t *bloom, uint64_t hash)
+{
+    const uint32_t h1 = (uint32_t)hash;
+    const uint32_t h2 = (uint32_t)(hash >> 32);
+
+    if (bloom->flags & ANY_BLOOM_BLOCKED) {
+        const uint8_t *block = any_bloom_block(bloom, hash);
+        const uint32_t step = (h2 >> 16) | 1;
+        for (uint32_t i = 0; i < bloom->hashes; i++) {
+            if (!any_bloom_get(block, (h2 + i * step) & (ANY_BLOOM_LINE_BITS - 1)))
+                return false;
+        }
+    } else {
+        for (uint32_t i = 0; i < bloom->hashes; i++) {
+            if (!any_bloom_get(bloom->bits, any_bloom_reduce(h1 + i * h2, bloom->size)))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+// Prefetch the block of a key, or the first bit of it for the standard
+// filter (the others are spread over the array)
+static inline void any_bloom_prefetch(const any_bloom_t *bloom, uint64_t hash)
+{
+    if (bloom->flags & ANY_BLOOM_BLOCKED)
+        ANY_BLOOM_PREFETCH(any_bloom_block(bloom, hash));
+    else
+        ANY_BLOOM_PREFETCH(bloom->bits + (any_bloom_reduce((uint32_t)hash, bloom->size) >> 3));
+}
+
+bool any_bloom_init(any_bloom_t *bloom, size_t count, double rate, uint64_t seed, uint32_t flags)
+{
+    if (count == 0)
+        count = 1;
+
+    if (!(rate > 0 && rate < 1))
+        return false;
+
+    // The optimal number of bits is -n ln(p) / ln(2)^2 and the optimal
+    // number of hashes is ln(2) m / n
+    const double ln2 = 0.6931471805599453;
+    double bits = ceil(-(double)count * log(rate) / (ln2 * ln2));
+    double hashes = round(ln2 * bits / count);
+
+    if (hashes < 1)
+        hashes = 1;
+    if (hashes > ANY_BLOOM_MAX_HASHES)
+        hashes = ANY_BLOOM_MAX_HASHES;
+
+    if (flags & ANY_BLOOM_BLOCKED)
+        bits = ceil(bits / ANY_BLOOM_LINE_BITS) * ANY_BLOOM_LINE_BITS;
+    else
+        bits = ceil(bits / 8) * 8;
+
+    const double limit = (flags & ANY_BLOOM_BLOCKED) ? 4294967296.0 * ANY_BLOOM_LINE_BITS : 4294967296.0;
+    if (bits > limit || bits / 8 > (double)(SIZE_MAX - ANY_BLOOM_LINE))
+        return false;
+
+    bloom->size = (uint64_t)bits;
+    bloom->hashes = (uint32_t)hashes;
+    bloom->flags = flags & ANY_BLOOM_BLOCKED;
+    bloom->seed = seed;
+
+    // The bits are aligned to a cache line
+    const size_t bytes = (size_t)(bloom->size / 8);
+    bloom->memory = ANY_BLOOM_MALLOC(bytes + ANY_BLOOM_LINE);
+    if (bloom->memory == NULL)
+        return false;
+
+    bloom->bits = (uint8_t *)bloom->memory + (ANY_BLOOM_LINE - (uintptr_t)bloom->memory % ANY_BLOOM_LINE) % ANY_BLOOM_LINE;
+    memset(bloom->bits, 0, bytes);
+    return true;
+}
+
+void any_bloom_free(any_bloom_t *bloom)
+{
+    if (bloom->memory != NULL)
+        ANY_BLOOM_FREE(bloom->memory);
+
+    bloom->memory = NULL;
+    bloom->bits = NULL;
+    bloom->size = 0;
+}
+
+void any_bloom_add(any_bloom_t *bloom, const uint8_t *key, size_t length)
+{
+    any_bloom_add_hash(bloom, any_hash_xxh64(key, length, bloom->seed));
+}
+
+bool any_bloom_has(const any_bloom_t *bloom, const uint8_t *key, size_t length)
+{
+    return any_bloom_has_hash(bloom, any_hash_xxh64(key, length, bloom->seed));
+}
+
+void any_bloom_add_batch(any_bloom_t *bloom, const uint8_t **keys, const size_t *lengths, size_t count)
+{
+    any_hash64_t hashes[ANY_BLOOM_BATCH];
+
+    for (size_t start = 0; start < count; start += ANY_BLOOM_BATCH) {
+        const size_t group = count - start < ANY_BLOOM_BATCH ? count - start : ANY_BLOOM_BATCH;
+        any_hash_xxh64_batch(keys + start, lengths + start, group, bloom->seed, hashes);
+
+        for (size_t i = 0; i < group; i++)
+            any_bloom_prefetch(bloom, hashes[i]);
+
+        for (size_t i = 0; i < group; i++)
+            any_bloom_add_hash(bloom, hashes[i]);
+    }
+}
+
+void any_bloom_has_batch(const any_bloom_t *bloom, const uint8_t **keys, const size_t *lengths,
+                         size_t count, bool *results)
+{
+    any_hash64_t hashes[ANY_BLOOM_BATCH];
+
+    for (size_t start = 0; start < count; start += ANY_BLOOM_BATCH) {
+        const size_t group = count - start < ANY_BLOOM_BATCH ? count - start : ANY_BLOOM_BATCH;
+        any_hash_xxh64_batch(keys + start, lengths + start, group, bloom->seed, hashes);
+
+        for (size_t i = 0; i < group; i++)
+            any_bloom_prefetch(bloom, hashes[i]);
+
+        for (size_t i = 0; i < group; i++)
+            results[start + i] = any_bloom_has_hash(bloom, hashes[i]);
+    }
+}
+
+// Serialization
+
+static inline void any_bloom_store32(uint8_t *buffer, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        buffer[i] = (uint8_t)(value >> (8 * i));
+}
+
+static inline void any_bloom_store64(uint8_t *buffer, uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+        buffer[i] = (uint8_t)(value >> (8 * i));
+}
+
+static inline uint32_t any_bloom_load32(const uint8_t *buffer)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++)
+        value |= (uint32_t)buffer[i] << (8 * i);
+    return value;
+}
+
+static inline uint64_t any_bloom_load64(const uint8_t *buffer)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++)
+        value |= (uint64_t)buffer[i] << (8 * i);
+    return value;
+}
+
+size_t any_bloom_serialized_size(const any_bloom_t *bloom)
+{
+    return ANY_BLOOM_HEADER + (size_t)(bloom->size / 8);
+}
+
+void any_bloom_serialize(const any_bloom_t *bloom, uint8_t *buffer)
+{
+    memset(buffer, 0, ANY_BLOOM_HEADER);
+    memcpy(buffer, ANY_BLOOM_MAGIC, 8);
+    any_bloom_store32(buffer + 8, ANY_BLOOM_VERSION);
+    any_bloom_store32(buffer + 12, bloom->flags);
+    any_bloom_store32(buffer + 16, bloom->hashes);
+    any_bloom_store64(buffer + 24, bloom->size);
+    any_bloom_store64(buffer + 32, bloom->seed);
+
+    memcpy(buffer + ANY_BLOOM_HEADER, bloom->bits, (size_t)(bloom->size / 8));
+}
+
+bool any_bloom_load(any_bloom_t *bloom, const uint8_t *data, size_t size)
+{
+    if (size < ANY_BLOOM_HEADER || memcmp(data, ANY_BLOOM_MAGIC, 8) != 0
+        || any_bloom_load32(data + 8) != ANY_BLOOM_VERSION)
+        return false;
+
+    const uint32_t flags = any_bloom_load32(data + 12);
+    const uint32_t hashes = any_bloom_load32(data + 16);
+    const uint64_t bits = any_bloom_load64(data + 24);
+
+    const uint64_t granule = (flags & ANY_BLOOM_BLOCKED) ? ANY_BLOOM_LINE_BITS : 8;
+    const uint64_t limit = (flags & ANY_BLOOM_BLOCKED) ? (uint64_t)ANY_BLOOM_LINE_BITS << 32 : (uint64_t)1 << 32;
+
+    if ((flags & ~ANY_BLOOM_BLOCKED) != 0 || hashes == 0 || hashes > ANY_BLOOM_MAX_HASHES
+        || bits == 0 || bits % granule != 0 || bits > limit || bits / 8 != size - ANY_BLOOM_HEADER)
+        return false;
+
+    bloom->bits = (uint8_t *)data + ANY_BLOOM_HEADER;
+    bloom->size = bits;
+    bloom->hashes = hashes;
+    bloom->flags = flags;
+    bloom->seed = any_bloom_load64(data + 32);
+    bloom->memory = NULL;
+    return true;
+}
+
+#endif
+
+// MIT License
+//
+// Copyright (c) 2024 Federico Angelilli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
@@ -1,7 +1,9 @@
 // any_hash
 //
-// A single-file library that provides a simple implementation of the
-// xxHash xxh32 and xxh64 hashing algorithms.
+// A single-file library that provides an implementation of the xxHash
+// xxh32, xxh64, xxh3 and xxh128 hashing algorithms, with streaming, batch,
+// scatter gather, parallel tree and file hashing and a content defined
+// chunker built on them.
 //
 // To use this library you should choose a suitable file to put the
 // implementation and define ANY_HASH_IMPLEMENT. For example
@@ -25,9 +27,11 @@
 // more than 7000 lines of code. This becomes a burden both for shipping
 // and compiling the header file in a (especially small) project.
 //
-// Meanwhile this any_hash is a few hundreds lines at most.
-// This comes at a cost thought: less architecture specific optimizations,
-// less hashing algorithms, slightly less performance overall.
+// Meanwhile this any_hash is about 3000 lines, most of them for the APIs
+// built on the hash functions (batch, tree, file and chunker) that xxHash
+// doesn't provide. This comes at a cost thought: less architecture
+// specific optimizations (only SSE2, AVX2 and AVX-512 kernels, selected at
+// runtime) and slightly less performance overall.
 //
 // Note however that the library is still very fast and the perfomance
 // difference will not be noticeable in small projects.
@@ -56,6 +60,10 @@
 // The speed was measured with the 'benchHash' program provided by
 // the xxHash library and without AVX2 enabled.
 //
+// The any_hash functions can be measured without xxHash with bench/hash
+// (make benches), which prints the GB/s and hash/s for every input size from
+// 1 B to 1 MiB, at aligned and unaligned offsets.
+//
 
 #ifndef ANY_HASH_INCLUDE
 #define ANY_HASH_INCLUDE
@@ -68,360 +76,3125 @@
 
 typedef uint32_t any_hash32_t;
 
+// The primes of xxh32, also used by the constexpr functions below
+#define ANY_HASH_PRIME32_1 2654435761u
+#define ANY_HASH_PRIME32_2 2246822519u
+#define ANY_HASH_PRIME32_3 3266489917u
+#define ANY_HASH_PRIME32_4 668265263u
+#define ANY_HASH_PRIME32_5 374761393u
+
 any_hash32_t any_hash_xxh32(const uint8_t *data, size_t length, any_hash32_t seed);
 
+// Streaming state for xxh32, for hashing data that arrives in pieces.
+//
+// The state holds the four lanes and the bytes that didn't fill a full
+// stripe of 16 bytes yet. Hashing the pieces with any_hash_xxh32_update gives
+// the same result of calling any_hash_xxh32 on their concatenation. For example
+//
+//    any_hash_xxh32_state_t state;
+//    any_hash_xxh32_reset(&state, seed);
+//
+//    while ((length = read_chunk(chunk)) > 0)
+//        any_hash_xxh32_update(&state, chunk, length);
+//
+//    any_hash32_t hash = any_hash_xxh32_digest(&state);
+//
+typedef struct {
+    any_hash32_t st1, st2, st3, st4;
+    uint8_t buffer[16];
+    size_t buffered;
+    size_t length;
+} any_hash_xxh32_state_t;
+
+void any_hash_xxh32_reset(any_hash_xxh32_state_t *state, any_hash32_t seed);
+
+void any_hash_xxh32_update(any_hash_xxh32_state_t *state, const uint8_t *data, size_t length);
+
+// The state is not modified, so you can keep updating it after this call.
+//
+any_hash32_t any_hash_xxh32_digest(const any_hash_xxh32_state_t *state);
+
+// Hash count keys at once, storing the hash of keys[i] in hashes[i].
+//
+// The output is the same of calling any_hash_xxh32 on each key, but short
+// keys are hashed together in the lanes of the vectorized kernel (eight at a
+// time with AVX2), hiding the latency of the rounds. Keys longer than
+// ANY_HASH_BATCH_LIMIT bytes are hashed one by one.
+//
+// NOTE: Without AVX2 the keys are all hashed one by one, and even with it
+//       the gain is small (about 1.2x on the keys of 16 to 64 bytes, see the
+//       xxh32_batch rows of bench/hash), since the cpu already overlaps the
+//       rounds of consecutive calls
+//
+void any_hash_xxh32_batch(const uint8_t **keys, const size_t *lengths, size_t count,
+                          any_hash32_t seed, any_hash32_t *hashes);
+
 #endif
 
 #ifndef ANY_HASH_NO_XXH64
 
 typedef uint64_t any_hash64_t;
 
+// The primes of xxh64, also used by the inline and constexpr functions below
+#define ANY_HASH_PRIME64_1 11400714785074694791ull
+#define ANY_HASH_PRIME64_2 14029467366897019727ull
+#define ANY_HASH_PRIME64_3 1609587929392839161ull
+#define ANY_HASH_PRIME64_4 9650029242287828579ull
+#define ANY_HASH_PRIME64_5 2870177450012600261ull
+
 any_hash64_t any_hash_xxh64(const uint8_t *data, size_t length, any_hash64_t seed);
 
-#endif
+// Streaming state for xxh64, with stripes of 32 bytes.
+// See any_hash_xxh32_state_t for an example.
+//
+typedef struct {
+    any_hash64_t st1, st2, st3, st4;
+    uint8_t buffer[32];
+    size_t buffered;
+    size_t length;
+} any_hash_xxh64_state_t;
 
-#endif
+void any_hash_xxh64_reset(any_hash_xxh64_state_t *state, any_hash64_t seed);
 
-#ifdef ANY_HASH_IMPLEMENT
+void any_hash_xxh64_update(any_hash_xxh64_state_t *state, const uint8_t *data, size_t length);
 
-#include <string.h>
+// The state is not modified, so you can keep updating it after this call.
+//
+any_hash64_t any_hash_xxh64_digest(const any_hash_xxh64_state_t *state);
 
-#define ANY_HASH_ALIGNED 0
+// Hash count keys at once, see any_hash_xxh32_batch.
+// The keys are hashed in eight lanes with AVX-512.
+//
+// NOTE: Without AVX-512 the keys are hashed one by one, so this function is
+//       only a convenience there. An interleaved scalar version was measured
+//       as no faster than consecutive calls (see the xxh64_batch rows of
+//       bench/hash)
+//
+void any_hash_xxh64_batch(const uint8_t **keys, const size_t *lengths, size_t count,
+                          any_hash64_t seed, any_hash64_t *hashes);
 
-#define ANY_HASH_ROTL1 1
-#define ANY_HASH_ROTL2 7
-#define ANY_HASH_ROTL3 12
-#define ANY_HASH_ROTL4 18
+// Hash fixed width integer keys, giving the same result of any_hash_xxh64 on
+// their little endian bytes (for the u128 variant, low and then high).
+// For example
+//
+//    any_hash64_t hash = any_hash_xxh64_u64(id, seed);
+//
+// is equal to any_hash_xxh64((const uint8_t *)&id, 8, seed) on little endian
+// cpus. These functions are inline and unrolled for their length, so that a
+// constant key (or seed) is folded by the compiler.
+//
+static inline any_hash64_t any_hash_xxh64_fixed_lane(any_hash64_t hash, uint64_t lane)
+{
+    lane *= ANY_HASH_PRIME64_2;
+    lane = (lane << 31) | (lane >> 33);
+    hash ^= lane * ANY_HASH_PRIME64_1;
+    hash = (hash << 27) | (hash >> 37);
+    return hash * ANY_HASH_PRIME64_1 + ANY_HASH_PRIME64_4;
+}
 
-#ifndef ANY_HASH_LIKELY
-#ifdef __has_builtin
-#if __has_builtin(__builtin_expect)
-#define ANY_HASH_LIKELY(...) __builtin_expect(!!(__VA_ARGS__), 1)
-#endif
-#endif
+static inline any_hash64_t any_hash_xxh64_fixed_avalanche(any_hash64_t hash)
+{
+    hash ^= hash >> 33;
+    hash *= ANY_HASH_PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= ANY_HASH_PRIME64_3;
+    hash ^= hash >> 32;
+    return hash;
+}
 
-#ifndef ANY_HASH_LIKELY
-#define ANY_HASH_LIKELY(...)
-#endif
-#endif
+static inline any_hash64_t any_hash_xxh64_u32(uint32_t key, any_hash64_t seed)
+{
+    any_hash64_t hash = seed + ANY_HASH_PRIME64_5 + 4;
+    hash ^= key * ANY_HASH_PRIME64_1;
+    hash = (hash << 23) | (hash >> 41);
+    hash = hash * ANY_HASH_PRIME64_2 + ANY_HASH_PRIME64_3;
+    return any_hash_xxh64_fixed_avalanche(hash);
+}
 
-#ifndef ANY_HASH_RUNTIME_ENDIAN
-#ifndef ANY_HASH_LITTLE_ENDIAN
-#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__ || \
-    defined(__BIG_ENDIAN__) || defined(__BIG_ENDIAN) || defined(_BIG_ENDIAN)
-#define ANY_HASH_LITTLE_ENDIAN 0
-#else
-#define ANY_HASH_LITTLE_ENDIAN 1
-#endif
-#endif
-#else
-#define ANY_HASH_LITTLE_ENDIAN any_hash_little_endian()
+static inline any_hash64_t any_hash_xxh64_u64(uint64_t key, any_hash64_t seed)
+{
+    any_hash64_t hash = seed + ANY_HASH_PRIME64_5 + 8;
+    hash = any_hash_xxh64_fixed_lane(hash, key);
+    return any_hash_xxh64_fixed_avalanche(hash);
+}
 
-static inline int any_hash_little_endian(void)
+static inline any_hash64_t any_hash_xxh64_u128(uint64_t low, uint64_t high, any_hash64_t seed)
 {
-    const union {
-        uint32_t uint;
-        char bytes[4];
-    } t = { 1 };
-    return t.bytes[0];
+    any_hash64_t hash = seed + ANY_HASH_PRIME64_5 + 16;
+    hash = any_hash_xxh64_fixed_lane(hash, low);
+    hash = any_hash_xxh64_fixed_lane(hash, high);
+    return any_hash_xxh64_fixed_avalanche(hash);
 }
+
 #endif
 
-#ifndef ANY_HASH_NO_XXH32
+// Compile time hashing
+//
+// In C++14 and later the hashes of string literals can be computed by the
+// compiler, with the same result of the functions above, so that they can
+// be used as case labels. For example
+//
+//    switch (any_hash_xxh32((const uint8_t *)key, length, 0)) {
+//    case ANY_HASH_LIT32("timeout"):
+//        ...
+//    case ANY_HASH_LIT32("retries"):
+//        ...
+//    }
+//
+// The hash of the key must still be checked with a comparison, unless the
+// keys are known to be in the set.
+//
+// C has no compile time functions (C23 constexpr applies only to objects),
+// so in C the constants must be generated, for example with
+//
+//    printf timeout | tools/any_hashsum -H0
+//
+// You can disable this by defining ANY_HASH_NO_CONSTEXPR.
+//
+#if defined(__cplusplus) && __cplusplus >= 201402L && !defined(ANY_HASH_NO_CONSTEXPR)
 
-#define ANY_HASH_BYTES32 sizeof(any_hash32_t)
-#define ANY_HASH_DATALEN32 16
+// Force the evaluation at compile time also outside of constant expressions
+template <typename T, T value>
+struct any_hash_constant {
+    static constexpr T hash = value;
+};
 
-#define ANY_HASH_ALIGN32 3
-#define ANY_HASH_ROUND32 13
+#ifndef ANY_HASH_NO_XXH32
 
-#define ANY_HASH_AV32_1 15
-#define ANY_HASH_AV32_2 13
-#define ANY_HASH_AV32_3 16
+constexpr any_hash32_t any_hash_constexpr_read32(const char *data)
+{
+    return (any_hash32_t)(uint8_t)data[0] | (any_hash32_t)(uint8_t)data[1] << 8
+         | (any_hash32_t)(uint8_t)data[2] << 16 | (any_hash32_t)(uint8_t)data[3] << 24;
+}
 
-#define ANY_HASH_PROC32_1 17
-#define ANY_HASH_PROC32_2 11
+constexpr any_hash32_t any_hash_constexpr_rotl32(any_hash32_t value, int bits)
+{
+    return (value << bits) | (value >> (32 - bits));
+}
 
-#define ANY_HASH_PRIME32_1 2654435761u
-#define ANY_HASH_PRIME32_2 2246822519u
-#define ANY_HASH_PRIME32_3 3266489917u
-#define ANY_HASH_PRIME32_4 668265263u
-#define ANY_HASH_PRIME32_5 374761393u
+constexpr any_hash32_t any_hash_constexpr_round32(any_hash32_t acc, any_hash32_t lane)
+{
+    return any_hash_constexpr_rotl32(acc + lane * ANY_HASH_PRIME32_2, 13) * ANY_HASH_PRIME32_1;
+}
 
-#ifdef __has_builtin
-#if __has_builtin(__builtin_bswap32)
-#define ANY_HASH_SWAP32 __builtin_bswap32
-#endif
+constexpr any_hash32_t any_hash_xxh32_constexpr(const char *data, size_t length, any_hash32_t seed)
+{
+    any_hash32_t hash = seed + ANY_HASH_PRIME32_5;
+    size_t i = 0;
+
+    if (length >= 16) {
+        any_hash32_t v1 = seed + ANY_HASH_PRIME32_1 + ANY_HASH_PRIME32_2, v2 = seed + ANY_HASH_PRIME32_2;
+        any_hash32_t v3 = seed, v4 = seed - ANY_HASH_PRIME32_1;
+
+        for (; i + 16 <= length; i += 16) {
+            v1 = any_hash_constexpr_round32(v1, any_hash_constexpr_read32(data + i));
+            v2 = any_hash_constexpr_round32(v2, any_hash_constexpr_read32(data + i + 4));
+            v3 = any_hash_constexpr_round32(v3, any_hash_constexpr_read32(data + i + 8));
+            v4 = any_hash_constexpr_round32(v4, any_hash_constexpr_read32(data + i + 12));
+        }
+
+        hash = any_hash_constexpr_rotl32(v1, 1) + any_hash_constexpr_rotl32(v2, 7)
+             + any_hash_constexpr_rotl32(v3, 12) + any_hash_constexpr_rotl32(v4, 18);
+    }
 
-#if __has_builtin(__builtin_rotateleft32)
-#define ANY_HASH_ROTL32 __builtin_rotateleft32
-#endif
-#endif
+    hash += (any_hash32_t)length;
 
-#ifndef ANY_HASH_SWAP32
-#define ANY_HASH_SWAP32 any_hash_swap32
+    for (; i + 4 <= length; i += 4) {
+        hash += any_hash_constexpr_read32(data + i) * ANY_HASH_PRIME32_3;
+        hash = any_hash_constexpr_rotl32(hash, 17) * ANY_HASH_PRIME32_4;
+    }
 
-static inline any_hash32_t any_hash_swap32(any_hash32_t hash)
-{
-    return ((hash << 24) & 0xff000000) |
-           ((hash <<  8) & 0x00ff0000) |
-           ((hash <<  8) & 0x0000ff00) |
-           ((hash << 24) & 0x000000ff);
+    for (; i < length; i++) {
+        hash += (uint8_t)data[i] * ANY_HASH_PRIME32_5;
+        hash = any_hash_constexpr_rotl32(hash, 11) * ANY_HASH_PRIME32_1;
+    }
+
+    hash ^= hash >> 15;
+    hash *= ANY_HASH_PRIME32_2;
+    hash ^= hash >> 13;
+    hash *= ANY_HASH_PRIME32_3;
+    hash ^= hash >> 16;
+    return hash;
 }
-#endif
 
-#ifndef ANY_HASH_ROTL32
-#define ANY_HASH_ROTL32 any_hash_rotl32
+#define ANY_HASH_LIT32(literal) \
+    (any_hash_constant<any_hash32_t, any_hash_xxh32_constexpr(literal, sizeof(literal) - 1, 0)>::hash)
 
-static inline any_hash32_t any_hash_rotl32(any_hash32_t hash, uint32_t bits)
-{
-    return (hash << bits) | (hash >> (32 - bits));
-}
 #endif
 
+#ifndef ANY_HASH_NO_XXH64
 
-static inline any_hash32_t any_hash_fetch32(const uint8_t *data, int_fast32_t align)
+constexpr any_hash64_t any_hash_constexpr_read64(const char *data)
 {
-    if (ANY_HASH_LIKELY(align == ANY_HASH_ALIGNED))
-        return ANY_HASH_LITTLE_ENDIAN
-            ? *(const any_hash32_t *)data
-            : ANY_HASH_SWAP32(*(const any_hash32_t *)data);
-
-    any_hash32_t hash;
-    memcpy(&hash, data, 4);
-
-    return ANY_HASH_LITTLE_ENDIAN
-        ? hash
-        : ANY_HASH_SWAP32(hash);
+    return (any_hash64_t)any_hash_constexpr_read32(data) | (any_hash64_t)any_hash_constexpr_read32(data + 4) << 32;
 }
 
-static inline any_hash32_t any_hash_avalanche32(any_hash32_t hash)
+constexpr any_hash64_t any_hash_constexpr_rotl64(any_hash64_t value, int bits)
 {
-    hash ^= hash >> ANY_HASH_AV32_1;
-    hash *= ANY_HASH_PRIME32_2;
-    hash ^= hash >> ANY_HASH_AV32_2;
-    hash *= ANY_HASH_PRIME32_3;
-    hash ^= hash >> ANY_HASH_AV32_3;
-    return hash;
+    return (value << bits) | (value >> (64 - bits));
 }
 
-static any_hash32_t any_hash_round32(any_hash32_t hash, any_hash32_t next)
+constexpr any_hash64_t any_hash_constexpr_round64(any_hash64_t acc, any_hash64_t lane)
 {
-    hash += next * ANY_HASH_PRIME32_2;
-    hash = ANY_HASH_ROTL32(hash, ANY_HASH_ROUND32);
-    hash *= ANY_HASH_PRIME32_1;
-    return hash;
+    return any_hash_constexpr_rotl64(acc + lane * ANY_HASH_PRIME64_2, 31) * ANY_HASH_PRIME64_1;
 }
 
-any_hash32_t any_hash_xxh32(const uint8_t *data, size_t length, any_hash32_t seed)
+constexpr any_hash64_t any_hash_xxh64_constexpr(const char *data, size_t length, any_hash64_t seed)
 {
-    any_hash32_t hash;
-    const int_fast32_t align = (uintptr_t)data & ANY_HASH_ALIGN32;
+    any_hash64_t hash = seed + ANY_HASH_PRIME64_5;
+    size_t i = 0;
+
+    if (length >= 32) {
+        any_hash64_t v1 = seed + ANY_HASH_PRIME64_1 + ANY_HASH_PRIME64_2;
+        any_hash64_t v2 = seed + ANY_HASH_PRIME64_2, v3 = seed, v4 = seed - ANY_HASH_PRIME64_1;
+
+        for (; i + 32 <= length; i += 32) {
+            v1 = any_hash_constexpr_round64(v1, any_hash_constexpr_read64(data + i));
+            v2 = any_hash_constexpr_round64(v2, any_hash_constexpr_read64(data + i + 8));
+            v3 = any_hash_constexpr_round64(v3, any_hash_constexpr_read64(data + i + 16));
+            v4 = any_hash_constexpr_round64(v4, any_hash_constexpr_read64(data + i + 24));
+        }
+
+        hash = any_hash_constexpr_rotl64(v1, 1) + any_hash_constexpr_rotl64(v2, 7)
+             + any_hash_constexpr_rotl64(v3, 12) + any_hash_constexpr_rotl64(v4, 18);
+
+        const any_hash64_t lanes[4] = { v1, v2, v3, v4 };
+        for (int j = 0; j < 4; j++) {
+            hash ^= any_hash_constexpr_round64(0, lanes[j]);
+            hash = hash * ANY_HASH_PRIME64_1 + ANY_HASH_PRIME64_4;
+        }
+    }
 
-    if (length >= ANY_HASH_DATALEN32) {
-        const uint8_t *const end = data + length - ANY_HASH_DATALEN32;
-
-        any_hash32_t st1 = seed + ANY_HASH_PRIME32_1 + ANY_HASH_PRIME32_2;
-        any_hash32_t st2 = seed + ANY_HASH_PRIME32_2;
-        any_hash32_t st3 = seed;
-        any_hash32_t st4 = seed - ANY_HASH_PRIME32_1;
-
-        do {
-            st1 = any_hash_round32(st1, any_hash_fetch32(data, align));
-            data += ANY_HASH_BYTES32;
-            st2 = any_hash_round32(st2, any_hash_fetch32(data, align));
-            data += ANY_HASH_BYTES32;
-            st3 = any_hash_round32(st3, any_hash_fetch32(data, align));
-            data += ANY_HASH_BYTES32;
-            st4 = any_hash_round32(st4, any_hash_fetch32(data, align));
-            data += ANY_HASH_BYTES32;
-        } while (data <= end);
-
-        hash = ANY_HASH_ROTL32(st1, ANY_HASH_ROTL1) + ANY_HASH_ROTL32(st2, ANY_HASH_ROTL2)
-             + ANY_HASH_ROTL32(st3, ANY_HASH_ROTL3) + ANY_HASH_ROTL32(st4, ANY_HASH_ROTL4);
-    } else
-        hash = seed + ANY_HASH_PRIME32_5;
+    hash += (any_hash64_t)length;
 
-    hash += length;
-    length &= (ANY_HASH_DATALEN32 - 1);
+    for (; i + 8 <= length; i += 8) {
+        hash ^= any_hash_constexpr_round64(0, any_hash_constexpr_read64(data + i));
+        hash = any_hash_constexpr_rotl64(hash, 27) * ANY_HASH_PRIME64_1 + ANY_HASH_PRIME64_4;
+    }
 
-    while (length >= 4) {
-        hash += any_hash_fetch32(data, align) * ANY_HASH_PRIME32_3;
-        hash = ANY_HASH_ROTL32(hash, ANY_HASH_PROC32_1) * ANY_HASH_PRIME32_4;
-        data += ANY_HASH_BYTES32;
-        length -= ANY_HASH_BYTES32;
+    if (i + 4 <= length) {
+        hash ^= any_hash_constexpr_read32(data + i) * ANY_HASH_PRIME64_1;
+        hash = any_hash_constexpr_rotl64(hash, 23) * ANY_HASH_PRIME64_2 + ANY_HASH_PRIME64_3;
+        i += 4;
     }
 
-    while (length > 0) {
-        hash += (*data++) * ANY_HASH_PRIME32_5;
-        hash = ANY_HASH_ROTL32(hash, ANY_HASH_PROC32_2) * ANY_HASH_PRIME32_1;
-        --length;
+    for (; i < length; i++) {
+        hash ^= (uint8_t)data[i] * ANY_HASH_PRIME64_5;
+        hash = any_hash_constexpr_rotl64(hash, 11) * ANY_HASH_PRIME64_1;
     }
 
-    return any_hash_avalanche32(hash);
+    hash ^= hash >> 33;
+    hash *= ANY_HASH_PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= ANY_HASH_PRIME64_3;
+    hash ^= hash >> 32;
+    return hash;
 }
 
+#define ANY_HASH_LIT64(literal) \
+    (any_hash_constant<any_hash64_t, any_hash_xxh64_constexpr(literal, sizeof(literal) - 1, 0)>::hash)
+
 #endif
 
-#ifndef ANY_HASH_NO_XXH64
+#endif
 
-#define ANY_HASH_BYTES64 sizeof(any_hash64_t)
-#define ANY_HASH_DATALEN64 32
+// The file functions need POSIX (mmap and read)
+//
+#if !defined(__unix__) && !defined(__APPLE__)
+#ifndef ANY_HASH_NO_FILE
+#define ANY_HASH_NO_FILE
+#endif
+#endif
 
-#define ANY_HASH_ALIGN64 7
-#define ANY_HASH_ROUND64 31
+#ifndef ANY_HASH_NO_FILE
 
-#define ANY_HASH_AV64_1 33
-#define ANY_HASH_AV64_2 29
-#define ANY_HASH_AV64_3 32
+// Hash a whole file, giving the same hash of the functions above on its
+// contents. For example
+//
+//    any_hash64_t hash;
+//    if (!any_hash_file_xxh64("snapshot.bin", 0, &hash))
+//        perror("snapshot.bin");
+//
+// Regular files are mapped in memory and hashed with a sequential access
+// hint, other files (like pipes) are read in chunks of ANY_HASH_FILE_BUFFER
+// bytes into a page aligned buffer. These functions return false on error,
+// with errno set.
+//
+// NOTE: A mapped file that is truncated while it is hashed raises SIGBUS
+//
+#ifndef ANY_HASH_NO_XXH32
 
-#define ANY_HASH_PROC64_1 27
-#define ANY_HASH_PROC64_2 23
-#define ANY_HASH_PROC64_3 11
+bool any_hash_file_xxh32(const char *path, any_hash32_t seed, any_hash32_t *hash);
 
-#define ANY_HASH_PRIME64_1 11400714785074694791ull
-#define ANY_HASH_PRIME64_2 14029467366897019727ull
-#define ANY_HASH_PRIME64_3 1609587929392839161ull
-#define ANY_HASH_PRIME64_4 9650029242287828579ull
-#define ANY_HASH_PRIME64_5 2870177450012600261ull
+bool any_hash_fd_xxh32(int fd, any_hash32_t seed, any_hash32_t *hash);
 
-#ifdef __has_builtin
-#if __has_builtin(__builtin_bswap64)
-#define ANY_HASH_SWAP64 __builtin_bswap64
 #endif
 
-#if __has_builtin(__builtin_rotateleft64)
-#define ANY_HASH_ROTL64 __builtin_rotateleft64
-#endif
-#endif
+#ifndef ANY_HASH_NO_XXH64
 
-#ifndef ANY_HASH_SWAP64
-#define ANY_HASH_SWAP64 any_hash_swap64
+bool any_hash_file_xxh64(const char *path, any_hash64_t seed, any_hash64_t *hash);
+
+bool any_hash_fd_xxh64(int fd, any_hash64_t seed, any_hash64_t *hash);
 
-static inline any_hash64_t any_hash_swap64(any_hash64_t hash)
-{
-    return ((hash << 56) & 0xff00000000000000ull) |
-           ((hash << 40) & 0x00ff000000000000ull) |
-           ((hash << 24) & 0x0000ff0000000000ull) |
-           ((hash <<  8) & 0x000000ff00000000ull) |
-           ((hash >>  8) & 0x00000000ff000000ull) |
-           ((hash >> 24) & 0x0000000000ff0000ull) |
-           ((hash >> 40) & 0x000000000000ff00ull) |
-           ((hash >> 56) & 0x00000000000000ffull);
-}
 #endif
 
-#ifndef ANY_HASH_ROTL64
-#define ANY_HASH_ROTL64 any_hash_rotl64
+#endif
 
-static inline any_hash64_t any_hash_rotl64(any_hash64_t hash, uint32_t bits)
-{
-    return (hash << bits) | (hash >> (64 - bits));
-}
+// The scatter gather functions need struct iovec (POSIX)
+//
+#if !defined(__unix__) && !defined(__APPLE__)
+#ifndef ANY_HASH_NO_IOV
+#define ANY_HASH_NO_IOV
+#endif
 #endif
 
-static inline any_hash64_t any_hash_fetch64(const uint8_t *data, int_fast32_t align)
-{
-    if (ANY_HASH_LIKELY(align == ANY_HASH_ALIGNED))
-        return ANY_HASH_LITTLE_ENDIAN
-            ? *(const any_hash64_t *)data
-            : ANY_HASH_SWAP64(*(const any_hash64_t *)data);
+#ifndef ANY_HASH_NO_IOV
 
-    any_hash64_t hash;
-    memcpy(&hash, data, 8);
+#include <sys/uio.h>
 
-    return ANY_HASH_LITTLE_ENDIAN
-        ? hash
-        : ANY_HASH_SWAP64(hash);
-}
+// Hash the concatenation of cnt fragments, as they would be written by
+// writev. For example
+//
+//    struct iovec iov[3] = {
+//        { header, sizeof(*header) },
+//        { body, body_length },
+//        { trailer, sizeof(*trailer) },
+//    };
+//    any_hash64_t hash = any_hash_xxh64_iov(iov, 3, seed);
+//
+// The lanes are carried across the fragments, so the result is the same of
+// hashing one buffer with their concatenation without copying them in it.
+//
+#ifndef ANY_HASH_NO_XXH32
+
+any_hash32_t any_hash_xxh32_iov(const struct iovec *iov, int cnt, any_hash32_t seed);
+
+#endif
+
+#ifndef ANY_HASH_NO_XXH64
+
+any_hash64_t any_hash_xxh64_iov(const struct iovec *iov, int cnt, any_hash64_t seed);
+
+#endif
+
+#endif
+
+#if !defined(ANY_HASH_NO_XXH64) && !defined(ANY_HASH_NO_TREE)
+
+// The tree mode splits the input in leaves of ANY_HASH_TREE_LEAF bytes
+// (the last one may be shorter), hashes each leaf with xxh64 and then hashes
+// the leaf hashes, as 64 bit little endian words, with xxh64. For example
+//
+//    any_hash_pool_t *pool = any_hash_pool_new(0);
+//    any_hash64_t hash = any_hash_xxh64_tree(pool, data, length, seed);
+//    any_hash_pool_free(pool);
+//
+// The leaves are hashed in parallel by a pool of threads, but the result
+// only depends on the data, the seed and the leaf size. An input that fits
+// in a single leaf gives the same hash of any_hash_xxh64.
+//
+// NOTE: Changing ANY_HASH_TREE_LEAF changes the hashes
+//
+#ifndef ANY_HASH_TREE_LEAF
+#define ANY_HASH_TREE_LEAF (1024 * 1024)
+#endif
+
+typedef struct any_hash_pool any_hash_pool_t;
+
+// Start a pool with the given number of threads, counting the caller of
+// any_hash_xxh64_tree which also hashes the leaves. With zero threads one
+// is used for each cpu. This function returns NULL on failure.
+//
+// In the implementation you can define ANY_HASH_NO_THREADS to build the
+// library without pthreads, then the leaves are hashed by the caller only.
+//
+any_hash_pool_t *any_hash_pool_new(size_t threads);
+
+void any_hash_pool_free(any_hash_pool_t *pool);
+
+// The pool can be NULL, then the leaves are hashed by the caller.
+// A pool must not be used by more threads at the same time.
+//
+any_hash64_t any_hash_xxh64_tree(any_hash_pool_t *pool, const uint8_t *data, size_t length, any_hash64_t seed);
+
+#endif
+
+#if !defined(ANY_HASH_NO_XXH64) && !defined(ANY_HASH_NO_CHUNKER)
+
+// Content defined chunking, in the style of FastCDC.
+//
+// The chunker splits a stream in chunks where a rolling hash (Gear) of the
+// last bytes matches a mask, so the boundaries depend on the content and not
+// on the offsets: inserting a byte changes only the chunk where it lands
+// (and rarely the next one), and the others can be deduplicated. Each chunk
+// is reported with its offset, length and xxh64, for example
+//
+//    static void on_chunk(void *user, uint64_t offset, size_t length, any_hash64_t hash)
+//    {
+//        store_chunk_if_new(user, hash, offset, length);
+//    }
+//
+//    any_hash_chunker_t chunker;
+//    any_hash_chunker_init(&chunker, 2048, 8192, 65536, 0);
+//
+//    while ((length = read_chunk(buffer)) > 0)
+//        any_hash_chunker_update(&chunker, buffer, length, on_chunk, user);
+//
+//    any_hash_chunker_final(&chunker, on_chunk, user);
+//
+// The chunks are between min and max bytes long (except the last one) and
+// about avg bytes on average. The boundaries also depend on the seed, since
+// the Gear table is derived from it.
+//
+typedef void (*any_hash_chunk_callback_t)(void *user, uint64_t offset, size_t length, any_hash64_t hash);
+
+typedef struct {
+    uint64_t gear[256];
+    uint64_t mask_small;
+    uint64_t mask_large;
+    size_t min, avg, max;
+    uint64_t fingerprint;
+    uint64_t offset;
+    size_t length;
+    any_hash64_t seed;
+    any_hash_xxh64_state_t state;
+} any_hash_chunker_t;
+
+// Initialize a chunker, the chunks are hashed with the given seed.
+// This function returns false if the sizes are not 0 < min <= avg <= max.
+//
+bool any_hash_chunker_init(any_hash_chunker_t *chunker, size_t min, size_t avg, size_t max, any_hash64_t seed);
+
+// Feed the next bytes of the stream, calling the callback for every chunk
+// that ends in them. The bytes of a chunk are hashed as they are scanned,
+// so the data doesn't need to be kept until the chunk ends.
+//
+void any_hash_chunker_update(any_hash_chunker_t *chunker, const uint8_t *data, size_t length,
+                             any_hash_chunk_callback_t callback, void *user);
+
+// Report the last chunk, if the stream didn't end at a boundary, and reset
+// the chunker for another stream.
+//
+void any_hash_chunker_final(any_hash_chunker_t *chunker, any_hash_chunk_callback_t callback, void *user);
+
+#endif
+
+// The xxh3 algorithm reuses the primitives of both xxh32 and xxh64,
+// so disabling either of them will also disable it.
+//
+#if defined(ANY_HASH_NO_XXH32) || defined(ANY_HASH_NO_XXH64)
+#ifndef ANY_HASH_NO_XXH3
+#define ANY_HASH_NO_XXH3
+#endif
+#endif
+
+#ifndef ANY_HASH_NO_XXH3
+
+// The output is the same as XXH3_64bits_withSeed of the xxHash library.
+//
+// The long input loop is vectorized with the kernel chosen at runtime.
+// See any_hash_kernel_t.
+//
+any_hash64_t any_hash_xxh3_64(const uint8_t *data, size_t length, any_hash64_t seed);
+
+// The 128 bit digest of xxh3, split in two 64 bit words.
+//
+typedef struct {
+    any_hash64_t low;
+    any_hash64_t high;
+} any_hash128_t;
+
+// The output is the same as XXH3_128bits_withSeed of the xxHash library.
+//
+any_hash128_t any_hash_xxh128(const uint8_t *data, size_t length, any_hash64_t seed);
+
+// Keyed hashing
+//
+// A seed is mixed in the hash with a few additions, so for a known or
+// guessed seed an attacker can craft many keys with the same hash and turn
+// the hash tables fed with untrusted input into lists (HashDoS). In keyed
+// mode the whole secret of xxh3, ANY_HASH_SECRET_SIZE random bytes, is the
+// key, and it must be kept private. For example
+//
+//    static uint8_t secret[ANY_HASH_SECRET_SIZE];
+//
+//    if (!any_hash_secret_random(secret))
+//        abort();
+//
+//    any_hash64_t hash = any_hash_xxh3_64_secret(key, length, secret);
+//
+// The short inputs take the same path of the seeded functions, so they are
+// hashed at the same speed (see the _secret rows of bench/hash).
+//
+// NOTE: The secret is read in place, so it must stay alive while it is used
+//
+#define ANY_HASH_SECRET_SIZE 192
+
+// The output is the same as XXH3_64bits_withSecret of the xxHash library,
+// with a secret of ANY_HASH_SECRET_SIZE bytes.
+//
+any_hash64_t any_hash_xxh3_64_secret(const uint8_t *data, size_t length, const uint8_t *secret);
+
+// The output is the same as XXH3_128bits_withSecret of the xxHash library,
+// with a secret of ANY_HASH_SECRET_SIZE bytes.
+//
+any_hash128_t any_hash_xxh128_secret(const uint8_t *data, size_t length, const uint8_t *secret);
+
+// Fill a secret with ANY_HASH_SECRET_SIZE bytes from the random source of
+// the system (getrandom on Linux, getentropy on the other systems). This
+// function returns false if the source fails, with errno set. Call it once
+// at startup and share the secret among the threads.
+//
+// You can disable it by defining ANY_HASH_NO_RANDOM, it is disabled on the
+// systems that are not POSIX.
+//
+#if !defined(__unix__) && !defined(__APPLE__)
+#ifndef ANY_HASH_NO_RANDOM
+#define ANY_HASH_NO_RANDOM
+#endif
+#endif
+
+#ifndef ANY_HASH_NO_RANDOM
+
+bool any_hash_secret_random(uint8_t *secret);
+
+#endif
+
+#endif
+
+// These values represent the kernels used by the vectorized parts of the
+// library, in increasing order of speed.
+//
+// On x86 with GCC or Clang all the kernels are compiled and the fastest one
+// supported by the cpu is chosen when you call any_hash_init, or at the first
+// use of a vectorized function. Otherwise only the kernels enabled by the
+// compiler flags (eg -mavx2) are available.
+//
+// In the implementation you can disable runtime detection by defining
+// ANY_HASH_NO_DISPATCH, and each kernel by defining ANY_HASH_NO_SSE2,
+// ANY_HASH_NO_AVX2 and ANY_HASH_NO_AVX512.
+//
+// NOTE: The value ANY_HASH_KERNEL_ALL is not an actual kernel and it is used
+//       as a sentinel to indicate the last value of any_hash_kernel_t
+//
+typedef enum {
+    ANY_HASH_KERNEL_SCALAR,
+    ANY_HASH_KERNEL_SSE2,
+    ANY_HASH_KERNEL_AVX2,
+    ANY_HASH_KERNEL_AVX512,
+    ANY_HASH_KERNEL_ALL,
+} any_hash_kernel_t;
+
+// Detect the cpu features and bind the fastest kernel.
+//
+// The kernel can be forced (for example to benchmark them) with the
+// environment variable ANY_HASH_KERNEL (set to "scalar", "sse2", "avx2" or
+// "avx512"), or by defining ANY_HASH_FORCE_KERNEL in the implementation.
+// A forced kernel is ignored if the cpu doesn't support it.
+//
+// Calling this function is optional, but you should call it before starting
+// other threads (for example in main) to keep the detection out of them.
+//
+any_hash_kernel_t any_hash_init(void);
+
+// Get the kernel in use, initializing the library if needed.
+//
+any_hash_kernel_t any_hash_kernel(void);
+
+// Bind a specific kernel. This function returns false if the kernel is
+// not available.
+//
+bool any_hash_set_kernel(any_hash_kernel_t kernel);
+
+const char *any_hash_kernel_to_string(any_hash_kernel_t kernel);
+
+#endif
+
+// The implementation is guarded too, so that the header can be included
+// again (for example by any_map.h) in the file where it is implemented
+#if defined(ANY_HASH_IMPLEMENT) && !defined(ANY_HASH_IMPLEMENTED)
+#define ANY_HASH_IMPLEMENTED
+
+#include <string.h>
+#include <stdlib.h>
+
+#ifndef ANY_HASH_MALLOC
+#define ANY_HASH_MALLOC malloc
+#define ANY_HASH_FREE free
+#endif
+
+#define ANY_HASH_ALIGNED 0
+#define ANY_HASH_UNALIGNED 1
+
+#define ANY_HASH_ROTL1 1
+#define ANY_HASH_ROTL2 7
+#define ANY_HASH_ROTL3 12
+#define ANY_HASH_ROTL4 18
+
+#ifndef ANY_HASH_LIKELY
+#ifdef __has_builtin
+#if __has_builtin(__builtin_expect)
+#define ANY_HASH_LIKELY(...) __builtin_expect(!!(__VA_ARGS__), 1)
+#endif
+#endif
+
+#ifndef ANY_HASH_LIKELY
+#define ANY_HASH_LIKELY(...) (__VA_ARGS__)
+#endif
+#endif
+
+#ifndef ANY_HASH_FORCE_INLINE
+#ifdef __GNUC__
+#define ANY_HASH_FORCE_INLINE inline __attribute__((always_inline))
+#else
+#define ANY_HASH_FORCE_INLINE inline
+#endif
+#endif
+
+// With GCC and Clang the kernels are compiled for their instruction set with
+// the target attribute, and the best one is chosen at runtime with cpuid
+// (through __builtin_cpu_supports, which caches its result).
+//
+#if !defined(ANY_HASH_NO_DISPATCH) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ANY_HASH_DISPATCH
+#define ANY_HASH_TARGET(...) __attribute__((target(__VA_ARGS__)))
+#define ANY_HASH_CPU_SUPPORTS(feature) __builtin_cpu_supports(feature)
+#else
+#define ANY_HASH_TARGET(...)
+#define ANY_HASH_CPU_SUPPORTS(feature) true
+#endif
+
+// The bound kernels (see any_hash_set_kernel) are switched while other
+// threads may be hashing, so they are stored and loaded atomically
+#ifdef __GNUC__
+#define ANY_HASH_LOAD(pointer) __atomic_load_n(pointer, __ATOMIC_ACQUIRE)
+#define ANY_HASH_STORE(pointer, value) __atomic_store_n(pointer, value, __ATOMIC_RELEASE)
+#else
+#define ANY_HASH_LOAD(pointer) (*(pointer))
+#define ANY_HASH_STORE(pointer, value) (*(pointer) = (value))
+#endif
+
+#if !defined(ANY_HASH_NO_SSE2) && (defined(ANY_HASH_DISPATCH) || defined(__SSE2__) || defined(_M_X64))
+#define ANY_HASH_HAS_SSE2
+#endif
+
+#if !defined(ANY_HASH_NO_AVX2) && (defined(ANY_HASH_DISPATCH) || defined(__AVX2__))
+#define ANY_HASH_HAS_AVX2
+#endif
+
+#if !defined(ANY_HASH_NO_AVX512) && (defined(ANY_HASH_DISPATCH) || defined(__AVX512F__))
+#define ANY_HASH_HAS_AVX512
+#endif
+
+#if defined(ANY_HASH_HAS_AVX2) || defined(ANY_HASH_HAS_AVX512)
+#include <immintrin.h>
+#elif defined(ANY_HASH_HAS_SSE2)
+#include <emmintrin.h>
+#endif
+
+#ifndef ANY_HASH_RUNTIME_ENDIAN
+#ifndef ANY_HASH_LITTLE_ENDIAN
+// NOTE: glibc always defines __BIG_ENDIAN (as a value for __BYTE_ORDER),
+//       so __BYTE_ORDER__ must be checked first
+#if defined(__BYTE_ORDER__)
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define ANY_HASH_LITTLE_ENDIAN 0
+#else
+#define ANY_HASH_LITTLE_ENDIAN 1
+#endif
+#elif defined(__BIG_ENDIAN__) || defined(_BIG_ENDIAN)
+#define ANY_HASH_LITTLE_ENDIAN 0
+#else
+#define ANY_HASH_LITTLE_ENDIAN 1
+#endif
+#endif
+#else
+#define ANY_HASH_LITTLE_ENDIAN any_hash_little_endian()
+
+static inline int any_hash_little_endian(void)
+{
+    const union {
+        uint32_t uint;
+        char bytes[4];
+    } t = { 1 };
+    return t.bytes[0];
+}
+#endif
+
+#ifndef ANY_HASH_NO_XXH32
+
+#define ANY_HASH_BYTES32 sizeof(any_hash32_t)
+#define ANY_HASH_DATALEN32 16
+
+#define ANY_HASH_ALIGN32 3
+#define ANY_HASH_ROUND32 13
+
+#define ANY_HASH_AV32_1 15
+#define ANY_HASH_AV32_2 13
+#define ANY_HASH_AV32_3 16
+
+#define ANY_HASH_PROC32_1 17
+#define ANY_HASH_PROC32_2 11
+
+#ifdef __has_builtin
+#if __has_builtin(__builtin_bswap32)
+#define ANY_HASH_SWAP32 __builtin_bswap32
+#endif
+
+#if __has_builtin(__builtin_rotateleft32)
+#define ANY_HASH_ROTL32 __builtin_rotateleft32
+#endif
+#endif
+
+#ifndef ANY_HASH_SWAP32
+#define ANY_HASH_SWAP32 any_hash_swap32
+
+static inline any_hash32_t any_hash_swap32(any_hash32_t hash)
+{
+    return ((hash << 24) & 0xff000000) |
+           ((hash <<  8) & 0x00ff0000) |
+           ((hash >>  8) & 0x0000ff00) |
+           ((hash >> 24) & 0x000000ff);
+}
+#endif
+
+#ifndef ANY_HASH_ROTL32
+#define ANY_HASH_ROTL32 any_hash_rotl32
+
+static inline any_hash32_t any_hash_rotl32(any_hash32_t hash, uint32_t bits)
+{
+    return (hash << bits) | (hash >> (32 - bits));
+}
+#endif
+
+
+static inline any_hash32_t any_hash_fetch32(const uint8_t *data, int_fast32_t align)
+{
+    if (ANY_HASH_LIKELY(align == ANY_HASH_ALIGNED))
+        return ANY_HASH_LITTLE_ENDIAN
+            ? *(const any_hash32_t *)data
+            : ANY_HASH_SWAP32(*(const any_hash32_t *)data);
+
+    any_hash32_t hash;
+    memcpy(&hash, data, 4);
+
+    return ANY_HASH_LITTLE_ENDIAN
+        ? hash
+        : ANY_HASH_SWAP32(hash);
+}
+
+static inline any_hash32_t any_hash_avalanche32(any_hash32_t hash)
+{
+    hash ^= hash >> ANY_HASH_AV32_1;
+    hash *= ANY_HASH_PRIME32_2;
+    hash ^= hash >> ANY_HASH_AV32_2;
+    hash *= ANY_HASH_PRIME32_3;
+    hash ^= hash >> ANY_HASH_AV32_3;
+    return hash;
+}
+
+static any_hash32_t any_hash_round32(any_hash32_t hash, any_hash32_t next)
+{
+    hash += next * ANY_HASH_PRIME32_2;
+    hash = ANY_HASH_ROTL32(hash, ANY_HASH_ROUND32);
+    hash *= ANY_HASH_PRIME32_1;
+    return hash;
+}
+
+static inline void any_hash_xxh32_lanes(any_hash_xxh32_state_t *state, any_hash32_t seed)
+{
+    state->st1 = seed + ANY_HASH_PRIME32_1 + ANY_HASH_PRIME32_2;
+    state->st2 = seed + ANY_HASH_PRIME32_2;
+    state->st3 = seed;
+    state->st4 = seed - ANY_HASH_PRIME32_1;
+}
+
+// Process all the full stripes and return the pointer to the remaining data
+static inline const uint8_t *any_hash_xxh32_stripes(any_hash_xxh32_state_t *state, const uint8_t *data,
+                                                    size_t length, int_fast32_t align)
+{
+    const uint8_t *const end = data + length - ANY_HASH_DATALEN32;
+
+    any_hash32_t st1 = state->st1;
+    any_hash32_t st2 = state->st2;
+    any_hash32_t st3 = state->st3;
+    any_hash32_t st4 = state->st4;
+
+    do {
+        st1 = any_hash_round32(st1, any_hash_fetch32(data, align));
+        data += ANY_HASH_BYTES32;
+        st2 = any_hash_round32(st2, any_hash_fetch32(data, align));
+        data += ANY_HASH_BYTES32;
+        st3 = any_hash_round32(st3, any_hash_fetch32(data, align));
+        data += ANY_HASH_BYTES32;
+        st4 = any_hash_round32(st4, any_hash_fetch32(data, align));
+        data += ANY_HASH_BYTES32;
+    } while (data <= end);
+
+    state->st1 = st1;
+    state->st2 = st2;
+    state->st3 = st3;
+    state->st4 = st4;
+    return data;
+}
+
+static inline any_hash32_t any_hash_xxh32_converge(const any_hash_xxh32_state_t *state)
+{
+    return ANY_HASH_ROTL32(state->st1, ANY_HASH_ROTL1) + ANY_HASH_ROTL32(state->st2, ANY_HASH_ROTL2)
+         + ANY_HASH_ROTL32(state->st3, ANY_HASH_ROTL3) + ANY_HASH_ROTL32(state->st4, ANY_HASH_ROTL4);
+}
+
+// Process the last bytes (less than a stripe) and avalanche
+static inline any_hash32_t any_hash_xxh32_finalize(any_hash32_t hash, const uint8_t *data,
+                                                   size_t length, int_fast32_t align)
+{
+    while (length >= 4) {
+        hash += any_hash_fetch32(data, align) * ANY_HASH_PRIME32_3;
+        hash = ANY_HASH_ROTL32(hash, ANY_HASH_PROC32_1) * ANY_HASH_PRIME32_4;
+        data += ANY_HASH_BYTES32;
+        length -= ANY_HASH_BYTES32;
+    }
+
+    while (length > 0) {
+        hash += (*data++) * ANY_HASH_PRIME32_5;
+        hash = ANY_HASH_ROTL32(hash, ANY_HASH_PROC32_2) * ANY_HASH_PRIME32_1;
+        --length;
+    }
+
+    return any_hash_avalanche32(hash);
+}
+
+any_hash32_t any_hash_xxh32(const uint8_t *data, size_t length, any_hash32_t seed)
+{
+    any_hash32_t hash;
+    const int_fast32_t align = (uintptr_t)data & ANY_HASH_ALIGN32;
+
+    if (length >= ANY_HASH_DATALEN32) {
+        any_hash_xxh32_state_t state;
+        any_hash_xxh32_lanes(&state, seed);
+
+        data = any_hash_xxh32_stripes(&state, data, length, align);
+        hash = any_hash_xxh32_converge(&state);
+    } else
+        hash = seed + ANY_HASH_PRIME32_5;
+
+    hash += length;
+    return any_hash_xxh32_finalize(hash, data, length & (ANY_HASH_DATALEN32 - 1), align);
+}
+
+void any_hash_xxh32_reset(any_hash_xxh32_state_t *state, any_hash32_t seed)
+{
+    any_hash_xxh32_lanes(state, seed);
+    state->buffered = 0;
+    state->length = 0;
+}
+
+void any_hash_xxh32_update(any_hash_xxh32_state_t *state, const uint8_t *data, size_t length)
+{
+    state->length += length;
+
+    if (state->buffered + length < ANY_HASH_DATALEN32) {
+        memcpy(state->buffer + state->buffered, data, length);
+        state->buffered += length;
+        return;
+    }
+
+    // Complete the stripe left from the previous update
+    if (state->buffered > 0) {
+        const size_t fill = ANY_HASH_DATALEN32 - state->buffered;
+        memcpy(state->buffer + state->buffered, data, fill);
+        any_hash_xxh32_stripes(state, state->buffer, ANY_HASH_DATALEN32, ANY_HASH_UNALIGNED);
+
+        data += fill;
+        length -= fill;
+        state->buffered = 0;
+    }
+
+    if (length >= ANY_HASH_DATALEN32) {
+        const uint8_t *rest = any_hash_xxh32_stripes(state, data, length,
+                                                     (uintptr_t)data & ANY_HASH_ALIGN32);
+        length -= rest - data;
+        data = rest;
+    }
+
+    memcpy(state->buffer, data, length);
+    state->buffered = length;
+}
+
+any_hash32_t any_hash_xxh32_digest(const any_hash_xxh32_state_t *state)
+{
+    // NOTE: The third lane holds the seed until a stripe is processed
+    any_hash32_t hash = state->length >= ANY_HASH_DATALEN32
+                      ? any_hash_xxh32_converge(state)
+                      : state->st3 + ANY_HASH_PRIME32_5;
+
+    hash += state->length;
+    return any_hash_xxh32_finalize(hash, state->buffer, state->buffered, ANY_HASH_UNALIGNED);
+}
+
+#endif
+
+#ifndef ANY_HASH_NO_XXH64
+
+#define ANY_HASH_BYTES64 sizeof(any_hash64_t)
+#define ANY_HASH_DATALEN64 32
+
+#define ANY_HASH_ALIGN64 7
+#define ANY_HASH_ROUND64 31
+
+#define ANY_HASH_AV64_1 33
+#define ANY_HASH_AV64_2 29
+#define ANY_HASH_AV64_3 32
+
+#define ANY_HASH_PROC64_1 27
+#define ANY_HASH_PROC64_2 23
+#define ANY_HASH_PROC64_3 11
+
+#ifdef __has_builtin
+#if __has_builtin(__builtin_bswap64)
+#define ANY_HASH_SWAP64 __builtin_bswap64
+#endif
+
+#if __has_builtin(__builtin_rotateleft64)
+#define ANY_HASH_ROTL64 __builtin_rotateleft64
+#endif
+#endif
+
+#ifndef ANY_HASH_SWAP64
+#define ANY_HASH_SWAP64 any_hash_swap64
+
+static inline any_hash64_t any_hash_swap64(any_hash64_t hash)
+{
+    return ((hash << 56) & 0xff00000000000000ull) |
+           ((hash << 40) & 0x00ff000000000000ull) |
+           ((hash << 24) & 0x0000ff0000000000ull) |
+           ((hash <<  8) & 0x000000ff00000000ull) |
+           ((hash >>  8) & 0x00000000ff000000ull) |
+           ((hash >> 24) & 0x0000000000ff0000ull) |
+           ((hash >> 40) & 0x000000000000ff00ull) |
+           ((hash >> 56) & 0x00000000000000ffull);
+}
+#endif
+
+#ifndef ANY_HASH_ROTL64
+#define ANY_HASH_ROTL64 any_hash_rotl64
+
+static inline any_hash64_t any_hash_rotl64(any_hash64_t hash, uint32_t bits)
+{
+    return (hash << bits) | (hash >> (64 - bits));
+}
+#endif
+
+static inline any_hash64_t any_hash_fetch64(const uint8_t *data, int_fast32_t align)
+{
+    if (ANY_HASH_LIKELY(align == ANY_HASH_ALIGNED))
+        return ANY_HASH_LITTLE_ENDIAN
+            ? *(const any_hash64_t *)data
+            : ANY_HASH_SWAP64(*(const any_hash64_t *)data);
+
+    any_hash64_t hash;
+    memcpy(&hash, data, 8);
+
+    return ANY_HASH_LITTLE_ENDIAN
+        ? hash
+        : ANY_HASH_SWAP64(hash);
+}
 
 static inline any_hash64_t any_hash_avalanche64(any_hash64_t hash)
 {
-    hash ^= hash >> ANY_HASH_AV64_1;
-    hash *= ANY_HASH_PRIME64_2;
-    hash ^= hash >> ANY_HASH_AV64_2;
-    hash *= ANY_HASH_PRIME64_3;
-    hash ^= hash >> ANY_HASH_AV64_3;
-    return hash;
+    hash ^= hash >> ANY_HASH_AV64_1;
+    hash *= ANY_HASH_PRIME64_2;
+    hash ^= hash >> ANY_HASH_AV64_2;
+    hash *= ANY_HASH_PRIME64_3;
+    hash ^= hash >> ANY_HASH_AV64_3;
+    return hash;
+}
+
+static any_hash64_t any_hash_round64(any_hash64_t hash, any_hash64_t next)
+{
+    hash += next * ANY_HASH_PRIME64_2;
+    hash = ANY_HASH_ROTL64(hash, ANY_HASH_ROUND64);
+    hash *= ANY_HASH_PRIME64_1;
+    return hash;
+}
+
+static any_hash64_t any_hash_round64_merge(any_hash64_t hash, any_hash64_t next)
+{
+    hash ^= any_hash_round64(0, next);
+    hash = hash * ANY_HASH_PRIME64_1 + ANY_HASH_PRIME64_4;
+    return hash;
+}
+
+static inline void any_hash_xxh64_lanes(any_hash_xxh64_state_t *state, any_hash64_t seed)
+{
+    state->st1 = seed + ANY_HASH_PRIME64_1 + ANY_HASH_PRIME64_2;
+    state->st2 = seed + ANY_HASH_PRIME64_2;
+    state->st3 = seed;
+    state->st4 = seed - ANY_HASH_PRIME64_1;
+}
+
+// Process all the full stripes and return the pointer to the remaining data
+static inline const uint8_t *any_hash_xxh64_stripes(any_hash_xxh64_state_t *state, const uint8_t *data,
+                                                    size_t length, int_fast32_t align)
+{
+    const uint8_t *const end = data + length - ANY_HASH_DATALEN64;
+
+    any_hash64_t st1 = state->st1;
+    any_hash64_t st2 = state->st2;
+    any_hash64_t st3 = state->st3;
+    any_hash64_t st4 = state->st4;
+
+    do {
+        st1 = any_hash_round64(st1, any_hash_fetch64(data, align));
+        data += ANY_HASH_BYTES64;
+        st2 = any_hash_round64(st2, any_hash_fetch64(data, align));
+        data += ANY_HASH_BYTES64;
+        st3 = any_hash_round64(st3, any_hash_fetch64(data, align));
+        data += ANY_HASH_BYTES64;
+        st4 = any_hash_round64(st4, any_hash_fetch64(data, align));
+        data += ANY_HASH_BYTES64;
+    } while (data <= end);
+
+    state->st1 = st1;
+    state->st2 = st2;
+    state->st3 = st3;
+    state->st4 = st4;
+    return data;
+}
+
+static inline any_hash64_t any_hash_xxh64_converge(const any_hash_xxh64_state_t *state)
+{
+    any_hash64_t hash = ANY_HASH_ROTL64(state->st1, ANY_HASH_ROTL1) + ANY_HASH_ROTL64(state->st2, ANY_HASH_ROTL2)
+                      + ANY_HASH_ROTL64(state->st3, ANY_HASH_ROTL3) + ANY_HASH_ROTL64(state->st4, ANY_HASH_ROTL4);
+
+    hash = any_hash_round64_merge(hash, state->st1);
+    hash = any_hash_round64_merge(hash, state->st2);
+    hash = any_hash_round64_merge(hash, state->st3);
+    hash = any_hash_round64_merge(hash, state->st4);
+    return hash;
+}
+
+// Process the last bytes (less than a stripe) and avalanche
+static inline any_hash64_t any_hash_xxh64_finalize(any_hash64_t hash, const uint8_t *data,
+                                                   size_t length, int_fast32_t align)
+{
+    while (length >= 8) {
+        hash ^= any_hash_round64(0, any_hash_fetch64(data, align));
+        hash = ANY_HASH_ROTL64(hash, ANY_HASH_PROC64_1) * ANY_HASH_PRIME64_1 + ANY_HASH_PRIME64_4;
+        data += ANY_HASH_BYTES64;
+        length -= ANY_HASH_BYTES64;
+    }
+
+    while (length >= 4) {
+        hash ^= (any_hash64_t)(any_hash_fetch32(data, align)) * ANY_HASH_PRIME64_1;
+        hash = ANY_HASH_ROTL64(hash, ANY_HASH_PROC64_2) * ANY_HASH_PRIME64_2 + ANY_HASH_PRIME64_3;
+        data += ANY_HASH_BYTES32;
+        length -= ANY_HASH_BYTES32;
+    }
+
+    while (length > 0) {
+        hash ^= (*data++) * ANY_HASH_PRIME64_5;
+        hash = ANY_HASH_ROTL64(hash, ANY_HASH_PROC64_3) * ANY_HASH_PRIME64_1;
+        --length;
+    }
+
+    return any_hash_avalanche64(hash);
+}
+
+any_hash64_t any_hash_xxh64(const uint8_t *data, size_t length, any_hash64_t seed)
+{
+    any_hash64_t hash;
+    const int_fast32_t align = (uintptr_t)data & ANY_HASH_ALIGN64;
+
+    if (length >= ANY_HASH_DATALEN64) {
+        any_hash_xxh64_state_t state;
+        any_hash_xxh64_lanes(&state, seed);
+
+        data = any_hash_xxh64_stripes(&state, data, length, align);
+        hash = any_hash_xxh64_converge(&state);
+    } else
+        hash = seed + ANY_HASH_PRIME64_5;
+
+    hash += length;
+    return any_hash_xxh64_finalize(hash, data, length & (ANY_HASH_DATALEN64 - 1), align);
+}
+
+void any_hash_xxh64_reset(any_hash_xxh64_state_t *state, any_hash64_t seed)
+{
+    any_hash_xxh64_lanes(state, seed);
+    state->buffered = 0;
+    state->length = 0;
+}
+
+void any_hash_xxh64_update(any_hash_xxh64_state_t *state, const uint8_t *data, size_t length)
+{
+    state->length += length;
+
+    if (state->buffered + length < ANY_HASH_DATALEN64) {
+        memcpy(state->buffer + state->buffered, data, length);
+        state->buffered += length;
+        return;
+    }
+
+    // Complete the stripe left from the previous update
+    if (state->buffered > 0) {
+        const size_t fill = ANY_HASH_DATALEN64 - state->buffered;
+        memcpy(state->buffer + state->buffered, data, fill);
+        any_hash_xxh64_stripes(state, state->buffer, ANY_HASH_DATALEN64, ANY_HASH_UNALIGNED);
+
+        data += fill;
+        length -= fill;
+        state->buffered = 0;
+    }
+
+    if (length >= ANY_HASH_DATALEN64) {
+        const uint8_t *rest = any_hash_xxh64_stripes(state, data, length,
+                                                     (uintptr_t)data & ANY_HASH_ALIGN64);
+        length -= rest - data;
+        data = rest;
+    }
+
+    memcpy(state->buffer, data, length);
+    state->buffered = length;
+}
+
+any_hash64_t any_hash_xxh64_digest(const any_hash_xxh64_state_t *state)
+{
+    // NOTE: The third lane holds the seed until a stripe is processed
+    any_hash64_t hash = state->length >= ANY_HASH_DATALEN64
+                      ? any_hash_xxh64_converge(state)
+                      : state->st3 + ANY_HASH_PRIME64_5;
+
+    hash += state->length;
+    return any_hash_xxh64_finalize(hash, state->buffer, state->buffered, ANY_HASH_UNALIGNED);
+}
+
+#endif
+
+#ifndef ANY_HASH_NO_XXH3
+
+#define ANY_HASH_XXH3_STRIPE 64
+#define ANY_HASH_XXH3_ACCS 8
+#define ANY_HASH_XXH3_SECRET 192
+#define ANY_HASH_XXH3_SECRET_MIN 136
+#define ANY_HASH_XXH3_SECRET_RATE 8
+
+#define ANY_HASH_XXH3_MIDSIZE 240
+#define ANY_HASH_XXH3_MIDSIZE_START 3
+#define ANY_HASH_XXH3_MIDSIZE_LAST 17
+#define ANY_HASH_XXH3_LAST_START 7
+#define ANY_HASH_XXH3_MERGE_START 11
+
+#define ANY_HASH_XXH3_AV_1 37
+#define ANY_HASH_XXH3_AV_2 32
+#define ANY_HASH_XXH3_SHIFT 47
+
+#define ANY_HASH_PRIME_MX1 0x165667919e3779f9ull
+#define ANY_HASH_PRIME_MX2 0x9fb21c651e98df25ull
+
+// The default secret, taken from the xxHash library (which took it from FARSH)
+static const uint8_t any_hash_xxh3_secret[ANY_HASH_XXH3_SECRET] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+// Multiply two 64 bit values with a 128 bit result
+static inline any_hash128_t any_hash_mul128(any_hash64_t lhs, any_hash64_t rhs)
+{
+#ifdef __SIZEOF_INT128__
+    const __uint128_t product = (__uint128_t)lhs * rhs;
+    const any_hash128_t result = { (any_hash64_t)product, (any_hash64_t)(product >> 64) };
+    return result;
+#else
+    const any_hash64_t lo_lo = (lhs & 0xffffffff) * (rhs & 0xffffffff);
+    const any_hash64_t hi_lo = (lhs >> 32) * (rhs & 0xffffffff);
+    const any_hash64_t lo_hi = (lhs & 0xffffffff) * (rhs >> 32);
+    const any_hash64_t hi_hi = (lhs >> 32) * (rhs >> 32);
+
+    const any_hash64_t cross = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+    const any_hash128_t result = {
+        (cross << 32) | (lo_lo & 0xffffffff),
+        (hi_lo >> 32) + (cross >> 32) + hi_hi,
+    };
+    return result;
+#endif
+}
+
+// Multiply two 64 bit values and fold the 128 bit result (low ^ high)
+static inline any_hash64_t any_hash_mul128_fold64(any_hash64_t lhs, any_hash64_t rhs)
+{
+    const any_hash128_t product = any_hash_mul128(lhs, rhs);
+    return product.low ^ product.high;
+}
+
+static inline any_hash64_t any_hash_xxh3_avalanche(any_hash64_t hash)
+{
+    hash ^= hash >> ANY_HASH_XXH3_AV_1;
+    hash *= ANY_HASH_PRIME_MX1;
+    hash ^= hash >> ANY_HASH_XXH3_AV_2;
+    return hash;
+}
+
+static inline any_hash64_t any_hash_xxh3_rrmxmx(any_hash64_t hash, size_t length)
+{
+    hash ^= ANY_HASH_ROTL64(hash, 49) ^ ANY_HASH_ROTL64(hash, 24);
+    hash *= ANY_HASH_PRIME_MX2;
+    hash ^= (hash >> 35) + length;
+    hash *= ANY_HASH_PRIME_MX2;
+    return hash ^ (hash >> 28);
+}
+
+static inline any_hash64_t any_hash_xxh3_mix16(const uint8_t *data, const uint8_t *secret, any_hash64_t seed)
+{
+    const any_hash64_t lo = any_hash_fetch64(data, ANY_HASH_UNALIGNED);
+    const any_hash64_t hi = any_hash_fetch64(data + 8, ANY_HASH_UNALIGNED);
+
+    return any_hash_mul128_fold64(lo ^ (any_hash_fetch64(secret, ANY_HASH_UNALIGNED) + seed),
+                                  hi ^ (any_hash_fetch64(secret + 8, ANY_HASH_UNALIGNED) - seed));
+}
+
+static any_hash64_t any_hash_xxh3_64_short(const uint8_t *data, size_t length,
+                                           const uint8_t *secret, any_hash64_t seed)
+{
+    if (length > 8) {
+        const any_hash64_t flip1 = (any_hash_fetch64(secret + 24, ANY_HASH_UNALIGNED)
+                                 ^ any_hash_fetch64(secret + 32, ANY_HASH_UNALIGNED)) + seed;
+        const any_hash64_t flip2 = (any_hash_fetch64(secret + 40, ANY_HASH_UNALIGNED)
+                                 ^ any_hash_fetch64(secret + 48, ANY_HASH_UNALIGNED)) - seed;
+
+        const any_hash64_t lo = any_hash_fetch64(data, ANY_HASH_UNALIGNED) ^ flip1;
+        const any_hash64_t hi = any_hash_fetch64(data + length - 8, ANY_HASH_UNALIGNED) ^ flip2;
+
+        return any_hash_xxh3_avalanche(length + ANY_HASH_SWAP64(lo) + hi + any_hash_mul128_fold64(lo, hi));
+    }
+
+    if (length >= 4) {
+        seed ^= (any_hash64_t)ANY_HASH_SWAP32((any_hash32_t)seed) << 32;
+
+        const any_hash64_t flip = (any_hash_fetch64(secret + 8, ANY_HASH_UNALIGNED)
+                                ^ any_hash_fetch64(secret + 16, ANY_HASH_UNALIGNED)) - seed;
+
+        const any_hash64_t value = any_hash_fetch32(data + length - 4, ANY_HASH_UNALIGNED)
+                                 + ((any_hash64_t)any_hash_fetch32(data, ANY_HASH_UNALIGNED) << 32);
+
+        return any_hash_xxh3_rrmxmx(value ^ flip, length);
+    }
+
+    if (length > 0) {
+        const any_hash32_t value = ((any_hash32_t)data[0] << 16) | ((any_hash32_t)data[length >> 1] << 24)
+                                 | ((any_hash32_t)data[length - 1]) | ((any_hash32_t)length << 8);
+
+        const any_hash64_t flip = (any_hash_fetch32(secret, ANY_HASH_UNALIGNED)
+                                ^ any_hash_fetch32(secret + 4, ANY_HASH_UNALIGNED)) + seed;
+
+        return any_hash_avalanche64(value ^ flip);
+    }
+
+    return any_hash_avalanche64(seed ^ any_hash_fetch64(secret + 56, ANY_HASH_UNALIGNED)
+                                     ^ any_hash_fetch64(secret + 64, ANY_HASH_UNALIGNED));
+}
+
+static any_hash64_t any_hash_xxh3_64_medium(const uint8_t *data, size_t length,
+                                            const uint8_t *secret, any_hash64_t seed)
+{
+    any_hash64_t hash = length * ANY_HASH_PRIME64_1;
+
+    if (length <= 128) {
+        // Mix pairs of blocks taken from both ends of the input
+        for (size_t i = 0; i <= (length - 1) / 32; i++) {
+            hash += any_hash_xxh3_mix16(data + 16 * i, secret + 32 * i, seed);
+            hash += any_hash_xxh3_mix16(data + length - 16 * (i + 1), secret + 32 * i + 16, seed);
+        }
+
+        return any_hash_xxh3_avalanche(hash);
+    }
+
+    for (size_t i = 0; i < 8; i++)
+        hash += any_hash_xxh3_mix16(data + 16 * i, secret + 16 * i, seed);
+
+    hash = any_hash_xxh3_avalanche(hash);
+
+    any_hash64_t last = any_hash_xxh3_mix16(data + length - 16, secret + ANY_HASH_XXH3_SECRET_MIN
+                                            - ANY_HASH_XXH3_MIDSIZE_LAST, seed);
+
+    for (size_t i = 8; i < length / 16; i++)
+        last += any_hash_xxh3_mix16(data + 16 * i, secret + 16 * (i - 8) + ANY_HASH_XXH3_MIDSIZE_START, seed);
+
+    return any_hash_xxh3_avalanche(hash + last);
+}
+
+// The stripe kernels process stripes of 64 bytes, consuming 8 bytes of the
+// secret for each stripe. The accumulators don't need to be aligned.
+//
+static ANY_HASH_FORCE_INLINE void any_hash_xxh3_accumulate_scalar(any_hash64_t *acc, const uint8_t *data,
+                                                                  const uint8_t *secret, size_t stripes)
+{
+    for (size_t n = 0; n < stripes; n++) {
+        for (size_t i = 0; i < ANY_HASH_XXH3_ACCS; i++) {
+            const any_hash64_t value = any_hash_fetch64(data + 8 * i, ANY_HASH_UNALIGNED);
+            const any_hash64_t key = value ^ any_hash_fetch64(secret + 8 * i, ANY_HASH_UNALIGNED);
+
+            acc[i ^ 1] += value;
+            acc[i] += (key & 0xffffffff) * (key >> 32);
+        }
+
+        data += ANY_HASH_XXH3_STRIPE;
+        secret += ANY_HASH_XXH3_SECRET_RATE;
+    }
+}
+
+static ANY_HASH_FORCE_INLINE void any_hash_xxh3_scramble_scalar(any_hash64_t *acc, const uint8_t *secret)
+{
+    for (size_t i = 0; i < ANY_HASH_XXH3_ACCS; i++) {
+        any_hash64_t hash = acc[i];
+        hash ^= hash >> ANY_HASH_XXH3_SHIFT;
+        hash ^= any_hash_fetch64(secret + 8 * i, ANY_HASH_UNALIGNED);
+        hash *= ANY_HASH_PRIME32_1;
+        acc[i] = hash;
+    }
+}
+
+#ifdef ANY_HASH_HAS_SSE2
+
+ANY_HASH_TARGET("sse2")
+static ANY_HASH_FORCE_INLINE void any_hash_xxh3_accumulate_sse2(any_hash64_t *acc, const uint8_t *data,
+                                                                const uint8_t *secret, size_t stripes)
+{
+    __m128i xacc[4];
+    for (size_t i = 0; i < 4; i++)
+        xacc[i] = _mm_loadu_si128((const __m128i *)acc + i);
+
+    for (size_t n = 0; n < stripes; n++) {
+        for (size_t i = 0; i < 4; i++) {
+            const __m128i value = _mm_loadu_si128((const __m128i *)data + i);
+            const __m128i key = _mm_xor_si128(value, _mm_loadu_si128((const __m128i *)secret + i));
+            const __m128i product = _mm_mul_epu32(key, _mm_shuffle_epi32(key, _MM_SHUFFLE(0, 3, 0, 1)));
+            const __m128i swap = _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+            xacc[i] = _mm_add_epi64(xacc[i], _mm_add_epi64(product, swap));
+        }
+
+        data += ANY_HASH_XXH3_STRIPE;
+        secret += ANY_HASH_XXH3_SECRET_RATE;
+    }
+
+    for (size_t i = 0; i < 4; i++)
+        _mm_storeu_si128((__m128i *)acc + i, xacc[i]);
+}
+
+ANY_HASH_TARGET("sse2")
+static ANY_HASH_FORCE_INLINE void any_hash_xxh3_scramble_sse2(any_hash64_t *acc, const uint8_t *secret)
+{
+    const __m128i prime = _mm_set1_epi32((int)ANY_HASH_PRIME32_1);
+
+    for (size_t i = 0; i < 4; i++) {
+        __m128i value = _mm_loadu_si128((const __m128i *)acc + i);
+        value = _mm_xor_si128(value, _mm_srli_epi64(value, ANY_HASH_XXH3_SHIFT));
+        value = _mm_xor_si128(value, _mm_loadu_si128((const __m128i *)secret + i));
+
+        const __m128i lo = _mm_mul_epu32(value, prime);
+        const __m128i hi = _mm_mul_epu32(_mm_shuffle_epi32(value, _MM_SHUFFLE(0, 3, 0, 1)), prime);
+        _mm_storeu_si128((__m128i *)acc + i, _mm_add_epi64(lo, _mm_slli_epi64(hi, 32)));
+    }
+}
+
+#endif
+
+#ifdef ANY_HASH_HAS_AVX2
+
+ANY_HASH_TARGET("avx2")
+static ANY_HASH_FORCE_INLINE void any_hash_xxh3_accumulate_avx2(any_hash64_t *acc, const uint8_t *data,
+                                                                const uint8_t *secret, size_t stripes)
+{
+    __m256i xacc[2];
+    for (size_t i = 0; i < 2; i++)
+        xacc[i] = _mm256_loadu_si256((const __m256i *)acc + i);
+
+    for (size_t n = 0; n < stripes; n++) {
+        for (size_t i = 0; i < 2; i++) {
+            const __m256i value = _mm256_loadu_si256((const __m256i *)data + i);
+            const __m256i key = _mm256_xor_si256(value, _mm256_loadu_si256((const __m256i *)secret + i));
+            const __m256i product = _mm256_mul_epu32(key, _mm256_srli_epi64(key, 32));
+            const __m256i swap = _mm256_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+            xacc[i] = _mm256_add_epi64(xacc[i], _mm256_add_epi64(product, swap));
+        }
+
+        data += ANY_HASH_XXH3_STRIPE;
+        secret += ANY_HASH_XXH3_SECRET_RATE;
+    }
+
+    for (size_t i = 0; i < 2; i++)
+        _mm256_storeu_si256((__m256i *)acc + i, xacc[i]);
+}
+
+ANY_HASH_TARGET("avx2")
+static ANY_HASH_FORCE_INLINE void any_hash_xxh3_scramble_avx2(any_hash64_t *acc, const uint8_t *secret)
+{
+    const __m256i prime = _mm256_set1_epi32((int)ANY_HASH_PRIME32_1);
+
+    for (size_t i = 0; i < 2; i++) {
+        __m256i value = _mm256_loadu_si256((const __m256i *)acc + i);
+        value = _mm256_xor_si256(value, _mm256_srli_epi64(value, ANY_HASH_XXH3_SHIFT));
+        value = _mm256_xor_si256(value, _mm256_loadu_si256((const __m256i *)secret + i));
+
+        const __m256i lo = _mm256_mul_epu32(value, prime);
+        const __m256i hi = _mm256_mul_epu32(_mm256_srli_epi64(value, 32), prime);
+        _mm256_storeu_si256((__m256i *)acc + i, _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32)));
+    }
+}
+
+#endif
+
+#ifdef ANY_HASH_HAS_AVX512
+
+ANY_HASH_TARGET("avx512f")
+static ANY_HASH_FORCE_INLINE void any_hash_xxh3_accumulate_avx512(any_hash64_t *acc, const uint8_t *data,
+                                                                  const uint8_t *secret, size_t stripes)
+{
+    __m512i xacc = _mm512_loadu_si512(acc);
+
+    for (size_t n = 0; n < stripes; n++) {
+        const __m512i value = _mm512_loadu_si512(data);
+        const __m512i key = _mm512_xor_si512(value, _mm512_loadu_si512(secret));
+        const __m512i product = _mm512_mul_epu32(key, _mm512_srli_epi64(key, 32));
+        const __m512i swap = _mm512_shuffle_epi32(value, (_MM_PERM_ENUM)_MM_SHUFFLE(1, 0, 3, 2));
+        xacc = _mm512_add_epi64(xacc, _mm512_add_epi64(product, swap));
+
+        data += ANY_HASH_XXH3_STRIPE;
+        secret += ANY_HASH_XXH3_SECRET_RATE;
+    }
+
+    _mm512_storeu_si512(acc, xacc);
+}
+
+ANY_HASH_TARGET("avx512f")
+static ANY_HASH_FORCE_INLINE void any_hash_xxh3_scramble_avx512(any_hash64_t *acc, const uint8_t *secret)
+{
+    const __m512i prime = _mm512_set1_epi32((int)ANY_HASH_PRIME32_1);
+
+    __m512i value = _mm512_loadu_si512(acc);
+    value = _mm512_xor_si512(value, _mm512_srli_epi64(value, ANY_HASH_XXH3_SHIFT));
+    value = _mm512_xor_si512(value, _mm512_loadu_si512(secret));
+
+    const __m512i lo = _mm512_mul_epu32(value, prime);
+    const __m512i hi = _mm512_mul_epu32(_mm512_srli_epi64(value, 32), prime);
+    _mm512_storeu_si512(acc, _mm512_add_epi64(lo, _mm512_slli_epi64(hi, 32)));
+}
+
+#endif
+
+// Derive a secret from the default one and the seed
+static void any_hash_xxh3_secret_init(uint8_t *secret, any_hash64_t seed)
+{
+    for (size_t i = 0; i < ANY_HASH_XXH3_SECRET; i += 16) {
+        any_hash64_t lo = any_hash_fetch64(any_hash_xxh3_secret + i, ANY_HASH_UNALIGNED) + seed;
+        any_hash64_t hi = any_hash_fetch64(any_hash_xxh3_secret + i + 8, ANY_HASH_UNALIGNED) - seed;
+
+        if (!ANY_HASH_LITTLE_ENDIAN) {
+            lo = ANY_HASH_SWAP64(lo);
+            hi = ANY_HASH_SWAP64(hi);
+        }
+
+        memcpy(secret + i, &lo, 8);
+        memcpy(secret + i + 8, &hi, 8);
+    }
+}
+
+typedef void (*any_hash_xxh3_accumulate_t)(any_hash64_t *acc, const uint8_t *data,
+                                           const uint8_t *secret, size_t stripes);
+
+typedef void (*any_hash_xxh3_scramble_t)(any_hash64_t *acc, const uint8_t *secret);
+
+// This is inlined in every kernel, so that the stripe functions are inlined too
+static ANY_HASH_FORCE_INLINE void any_hash_xxh3_long_loop(any_hash64_t *acc, const uint8_t *data, size_t length,
+                                                          const uint8_t *secret,
+                                                          any_hash_xxh3_accumulate_t accumulate,
+                                                          any_hash_xxh3_scramble_t scramble)
+{
+    const size_t stripes = (ANY_HASH_XXH3_SECRET - ANY_HASH_XXH3_STRIPE) / ANY_HASH_XXH3_SECRET_RATE;
+    const size_t block = stripes * ANY_HASH_XXH3_STRIPE;
+    const size_t blocks = (length - 1) / block;
+
+    for (size_t n = 0; n < blocks; n++) {
+        accumulate(acc, data + n * block, secret, stripes);
+        scramble(acc, secret + ANY_HASH_XXH3_SECRET - ANY_HASH_XXH3_STRIPE);
+    }
+
+    accumulate(acc, data + blocks * block, secret, ((length - 1) - blocks * block) / ANY_HASH_XXH3_STRIPE);
+
+    // The last stripe is always processed in full (overlapping the previous one)
+    accumulate(acc, data + length - ANY_HASH_XXH3_STRIPE, secret + ANY_HASH_XXH3_SECRET
+               - ANY_HASH_XXH3_STRIPE - ANY_HASH_XXH3_LAST_START, 1);
+}
+
+typedef void (*any_hash_xxh3_long_t)(any_hash64_t *acc, const uint8_t *data,
+                                     size_t length, const uint8_t *secret);
+
+static void any_hash_xxh3_long_scalar(any_hash64_t *acc, const uint8_t *data, size_t length, const uint8_t *secret)
+{
+    any_hash_xxh3_long_loop(acc, data, length, secret, any_hash_xxh3_accumulate_scalar,
+                            any_hash_xxh3_scramble_scalar);
+}
+
+#ifdef ANY_HASH_HAS_SSE2
+ANY_HASH_TARGET("sse2")
+static void any_hash_xxh3_long_sse2(any_hash64_t *acc, const uint8_t *data, size_t length, const uint8_t *secret)
+{
+    any_hash_xxh3_long_loop(acc, data, length, secret, any_hash_xxh3_accumulate_sse2,
+                            any_hash_xxh3_scramble_sse2);
+}
+#endif
+
+#ifdef ANY_HASH_HAS_AVX2
+ANY_HASH_TARGET("avx2")
+static void any_hash_xxh3_long_avx2(any_hash64_t *acc, const uint8_t *data, size_t length, const uint8_t *secret)
+{
+    any_hash_xxh3_long_loop(acc, data, length, secret, any_hash_xxh3_accumulate_avx2,
+                            any_hash_xxh3_scramble_avx2);
+}
+#endif
+
+#ifdef ANY_HASH_HAS_AVX512
+ANY_HASH_TARGET("avx512f")
+static void any_hash_xxh3_long_avx512(any_hash64_t *acc, const uint8_t *data, size_t length, const uint8_t *secret)
+{
+    any_hash_xxh3_long_loop(acc, data, length, secret, any_hash_xxh3_accumulate_avx512,
+                            any_hash_xxh3_scramble_avx512);
+}
+#endif
+
+// The kernel is bound by any_hash_set_kernel, the first call goes through
+// any_hash_xxh3_long_resolve to initialize the library. The threads that
+// make the first call at the same time all initialize it, binding the same
+// kernels.
+//
+static void any_hash_xxh3_long_resolve(any_hash64_t *acc, const uint8_t *data,
+                                       size_t length, const uint8_t *secret);
+
+static any_hash_xxh3_long_t any_hash_xxh3_long = any_hash_xxh3_long_resolve;
+
+static void any_hash_xxh3_long_resolve(any_hash64_t *acc, const uint8_t *data,
+                                       size_t length, const uint8_t *secret)
+{
+    any_hash_init();
+    ANY_HASH_LOAD(&any_hash_xxh3_long)(acc, data, length, secret);
+}
+
+static any_hash64_t any_hash_xxh3_merge(const any_hash64_t *acc, const uint8_t *secret, any_hash64_t hash)
+{
+    for (size_t i = 0; i < ANY_HASH_XXH3_ACCS; i += 2) {
+        hash += any_hash_mul128_fold64(acc[i] ^ any_hash_fetch64(secret + 8 * i, ANY_HASH_UNALIGNED),
+                                       acc[i + 1] ^ any_hash_fetch64(secret + 8 * i + 8, ANY_HASH_UNALIGNED));
+    }
+
+    return any_hash_xxh3_avalanche(hash);
+}
+
+#define ANY_HASH_XXH3_ACC_INIT \
+    { ANY_HASH_PRIME32_3, ANY_HASH_PRIME64_1, ANY_HASH_PRIME64_2, ANY_HASH_PRIME64_3, \
+      ANY_HASH_PRIME64_4, ANY_HASH_PRIME32_2, ANY_HASH_PRIME64_5, ANY_HASH_PRIME32_1 }
+
+any_hash64_t any_hash_xxh3_64(const uint8_t *data, size_t length, any_hash64_t seed)
+{
+    if (length <= 16)
+        return any_hash_xxh3_64_short(data, length, any_hash_xxh3_secret, seed);
+
+    if (length <= ANY_HASH_XXH3_MIDSIZE)
+        return any_hash_xxh3_64_medium(data, length, any_hash_xxh3_secret, seed);
+
+    uint8_t custom[ANY_HASH_XXH3_SECRET];
+    const uint8_t *secret = any_hash_xxh3_secret;
+
+    if (seed != 0) {
+        any_hash_xxh3_secret_init(custom, seed);
+        secret = custom;
+    }
+
+    any_hash64_t acc[ANY_HASH_XXH3_ACCS] = ANY_HASH_XXH3_ACC_INIT;
+    ANY_HASH_LOAD(&any_hash_xxh3_long)(acc, data, length, secret);
+
+    return any_hash_xxh3_merge(acc, secret + ANY_HASH_XXH3_MERGE_START, length * ANY_HASH_PRIME64_1);
+}
+
+static any_hash128_t any_hash_xxh128_short(const uint8_t *data, size_t length,
+                                           const uint8_t *secret, any_hash64_t seed)
+{
+    any_hash128_t hash;
+
+    if (length > 8) {
+        const any_hash64_t flip_lo = (any_hash_fetch64(secret + 32, ANY_HASH_UNALIGNED)
+                                   ^ any_hash_fetch64(secret + 40, ANY_HASH_UNALIGNED)) - seed;
+        const any_hash64_t flip_hi = (any_hash_fetch64(secret + 48, ANY_HASH_UNALIGNED)
+                                   ^ any_hash_fetch64(secret + 56, ANY_HASH_UNALIGNED)) + seed;
+
+        const any_hash64_t lo = any_hash_fetch64(data, ANY_HASH_UNALIGNED);
+        any_hash64_t hi = any_hash_fetch64(data + length - 8, ANY_HASH_UNALIGNED);
+
+        any_hash128_t mix = any_hash_mul128(lo ^ hi ^ flip_lo, ANY_HASH_PRIME64_1);
+        hi ^= flip_hi;
+        mix.low += (any_hash64_t)(length - 1) << 54;
+        mix.high += hi + (hi & 0xffffffff) * (ANY_HASH_PRIME32_2 - 1);
+        mix.low ^= ANY_HASH_SWAP64(mix.high);
+
+        hash = any_hash_mul128(mix.low, ANY_HASH_PRIME64_2);
+        hash.high += mix.high * ANY_HASH_PRIME64_2;
+        hash.low = any_hash_xxh3_avalanche(hash.low);
+        hash.high = any_hash_xxh3_avalanche(hash.high);
+        return hash;
+    }
+
+    if (length >= 4) {
+        seed ^= (any_hash64_t)ANY_HASH_SWAP32((any_hash32_t)seed) << 32;
+
+        const any_hash64_t flip = (any_hash_fetch64(secret + 16, ANY_HASH_UNALIGNED)
+                                ^ any_hash_fetch64(secret + 24, ANY_HASH_UNALIGNED)) + seed;
+
+        const any_hash64_t value = any_hash_fetch32(data, ANY_HASH_UNALIGNED)
+                                 + ((any_hash64_t)any_hash_fetch32(data + length - 4, ANY_HASH_UNALIGNED) << 32);
+
+        hash = any_hash_mul128(value ^ flip, ANY_HASH_PRIME64_1 + (length << 2));
+        hash.high += hash.low << 1;
+        hash.low ^= hash.high >> 3;
+
+        hash.low ^= hash.low >> 35;
+        hash.low *= ANY_HASH_PRIME_MX2;
+        hash.low ^= hash.low >> 28;
+        hash.high = any_hash_xxh3_avalanche(hash.high);
+        return hash;
+    }
+
+    if (length > 0) {
+        const any_hash32_t value_lo = ((any_hash32_t)data[0] << 16) | ((any_hash32_t)data[length >> 1] << 24)
+                                    | ((any_hash32_t)data[length - 1]) | ((any_hash32_t)length << 8);
+        const any_hash32_t value_hi = ANY_HASH_ROTL32(ANY_HASH_SWAP32(value_lo), 13);
+
+        const any_hash64_t flip_lo = (any_hash_fetch32(secret, ANY_HASH_UNALIGNED)
+                                   ^ any_hash_fetch32(secret + 4, ANY_HASH_UNALIGNED)) + seed;
+        const any_hash64_t flip_hi = (any_hash_fetch32(secret + 8, ANY_HASH_UNALIGNED)
+                                   ^ any_hash_fetch32(secret + 12, ANY_HASH_UNALIGNED)) - seed;
+
+        hash.low = any_hash_avalanche64(value_lo ^ flip_lo);
+        hash.high = any_hash_avalanche64(value_hi ^ flip_hi);
+        return hash;
+    }
+
+    hash.low = any_hash_avalanche64(seed ^ any_hash_fetch64(secret + 64, ANY_HASH_UNALIGNED)
+                                         ^ any_hash_fetch64(secret + 72, ANY_HASH_UNALIGNED));
+    hash.high = any_hash_avalanche64(seed ^ any_hash_fetch64(secret + 80, ANY_HASH_UNALIGNED)
+                                          ^ any_hash_fetch64(secret + 88, ANY_HASH_UNALIGNED));
+    return hash;
+}
+
+static inline any_hash128_t any_hash_xxh128_mix32(any_hash128_t hash, const uint8_t *data1, const uint8_t *data2,
+                                                  const uint8_t *secret, any_hash64_t seed)
+{
+    hash.low += any_hash_xxh3_mix16(data1, secret, seed);
+    hash.low ^= any_hash_fetch64(data2, ANY_HASH_UNALIGNED) + any_hash_fetch64(data2 + 8, ANY_HASH_UNALIGNED);
+    hash.high += any_hash_xxh3_mix16(data2, secret + 16, seed);
+    hash.high ^= any_hash_fetch64(data1, ANY_HASH_UNALIGNED) + any_hash_fetch64(data1 + 8, ANY_HASH_UNALIGNED);
+    return hash;
+}
+
+static any_hash128_t any_hash_xxh128_medium(const uint8_t *data, size_t length,
+                                            const uint8_t *secret, any_hash64_t seed)
+{
+    any_hash128_t acc = { length * ANY_HASH_PRIME64_1, 0 };
+
+    if (length <= 128) {
+        for (size_t i = (length - 1) / 32 + 1; i-- > 0; ) {
+            acc = any_hash_xxh128_mix32(acc, data + 16 * i, data + length - 16 * (i + 1),
+                                        secret + 32 * i, seed);
+        }
+    } else {
+        for (size_t i = 32; i < 160; i += 32)
+            acc = any_hash_xxh128_mix32(acc, data + i - 32, data + i - 16, secret + i - 32, seed);
+
+        acc.low = any_hash_xxh3_avalanche(acc.low);
+        acc.high = any_hash_xxh3_avalanche(acc.high);
+
+        for (size_t i = 160; i <= length; i += 32) {
+            acc = any_hash_xxh128_mix32(acc, data + i - 32, data + i - 16,
+                                        secret + ANY_HASH_XXH3_MIDSIZE_START + i - 160, seed);
+        }
+
+        acc = any_hash_xxh128_mix32(acc, data + length - 16, data + length - 32, secret
+                                    + ANY_HASH_XXH3_SECRET_MIN - ANY_HASH_XXH3_MIDSIZE_LAST - 16, 0 - seed);
+    }
+
+    any_hash128_t hash;
+    hash.low = any_hash_xxh3_avalanche(acc.low + acc.high);
+    hash.high = 0 - any_hash_xxh3_avalanche(acc.low * ANY_HASH_PRIME64_1 + acc.high * ANY_HASH_PRIME64_4
+                                            + (length - seed) * ANY_HASH_PRIME64_2);
+    return hash;
+}
+
+any_hash128_t any_hash_xxh128(const uint8_t *data, size_t length, any_hash64_t seed)
+{
+    if (length <= 16)
+        return any_hash_xxh128_short(data, length, any_hash_xxh3_secret, seed);
+
+    if (length <= ANY_HASH_XXH3_MIDSIZE)
+        return any_hash_xxh128_medium(data, length, any_hash_xxh3_secret, seed);
+
+    uint8_t custom[ANY_HASH_XXH3_SECRET];
+    const uint8_t *secret = any_hash_xxh3_secret;
+
+    if (seed != 0) {
+        any_hash_xxh3_secret_init(custom, seed);
+        secret = custom;
+    }
+
+    any_hash64_t acc[ANY_HASH_XXH3_ACCS] = ANY_HASH_XXH3_ACC_INIT;
+    ANY_HASH_LOAD(&any_hash_xxh3_long)(acc, data, length, secret);
+
+    any_hash128_t hash;
+    hash.low = any_hash_xxh3_merge(acc, secret + ANY_HASH_XXH3_MERGE_START, length * ANY_HASH_PRIME64_1);
+    hash.high = any_hash_xxh3_merge(acc, secret + ANY_HASH_XXH3_SECRET - ANY_HASH_XXH3_STRIPE
+                                    - ANY_HASH_XXH3_MERGE_START, ~(length * ANY_HASH_PRIME64_2));
+    return hash;
+}
+
+
+any_hash64_t any_hash_xxh3_64_secret(const uint8_t *data, size_t length, const uint8_t *secret)
+{
+    if (length <= 16)
+        return any_hash_xxh3_64_short(data, length, secret, 0);
+
+    if (length <= ANY_HASH_XXH3_MIDSIZE)
+        return any_hash_xxh3_64_medium(data, length, secret, 0);
+
+    any_hash64_t acc[ANY_HASH_XXH3_ACCS] = ANY_HASH_XXH3_ACC_INIT;
+    ANY_HASH_LOAD(&any_hash_xxh3_long)(acc, data, length, secret);
+
+    return any_hash_xxh3_merge(acc, secret + ANY_HASH_XXH3_MERGE_START, length * ANY_HASH_PRIME64_1);
+}
+
+any_hash128_t any_hash_xxh128_secret(const uint8_t *data, size_t length, const uint8_t *secret)
+{
+    if (length <= 16)
+        return any_hash_xxh128_short(data, length, secret, 0);
+
+    if (length <= ANY_HASH_XXH3_MIDSIZE)
+        return any_hash_xxh128_medium(data, length, secret, 0);
+
+    any_hash64_t acc[ANY_HASH_XXH3_ACCS] = ANY_HASH_XXH3_ACC_INIT;
+    ANY_HASH_LOAD(&any_hash_xxh3_long)(acc, data, length, secret);
+
+    any_hash128_t hash;
+    hash.low = any_hash_xxh3_merge(acc, secret + ANY_HASH_XXH3_MERGE_START, length * ANY_HASH_PRIME64_1);
+    hash.high = any_hash_xxh3_merge(acc, secret + ANY_HASH_XXH3_SECRET - ANY_HASH_XXH3_STRIPE
+                                    - ANY_HASH_XXH3_MERGE_START, ~(length * ANY_HASH_PRIME64_2));
+    return hash;
+}
+
+#ifndef ANY_HASH_NO_RANDOM
+
+#include <sys/types.h>
+#include <unistd.h>
+#include <errno.h>
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/random.h>
+#endif
+
+bool any_hash_secret_random(uint8_t *secret)
+{
+#ifdef __linux__
+    // Reads of up to 256 bytes are not interrupted once the pool is ready,
+    // but the call can still fail with EINTR while it blocks waiting for it
+    size_t done = 0;
+    while (done < ANY_HASH_SECRET_SIZE) {
+        const ssize_t n = getrandom(secret + done, ANY_HASH_SECRET_SIZE - done, 0);
+        if (n < 0 && errno != EINTR)
+            return false;
+        if (n > 0)
+            done += (size_t)n;
+    }
+    return true;
+#else
+    return getentropy(secret, ANY_HASH_SECRET_SIZE) == 0;
+#endif
+}
+
+#endif
+#endif
+
+// Batch hashing
+//
+// The batch functions collect the short keys in groups of ANY_HASH_BATCH_KEYS
+// and hash each group with the kernel. The kernels hold a key in every lane
+// of their vectors, and the lanes of the keys with less stripes or tail words
+// than the others are masked out. Every step is done on ANY_HASH_BATCH_WAYS
+// vectors at once, so that their multiplications overlap.
+
+// Keys longer than this are hashed one by one, they would keep the other
+// lanes idle for too long
+#ifndef ANY_HASH_BATCH_LIMIT
+#define ANY_HASH_BATCH_LIMIT 256
+#endif
+
+#define ANY_HASH_BATCH_LANES 8
+#define ANY_HASH_BATCH_WAYS 4
+#define ANY_HASH_BATCH_KEYS (ANY_HASH_BATCH_LANES * ANY_HASH_BATCH_WAYS)
+
+// Pack the last bytes (at most 3) of a key in a word without branching on
+// their number, the bytes past the end are repeated and masked out later
+static inline uint32_t any_hash_batch_bytes(const uint8_t *data, size_t length)
+{
+    static const uint8_t empty[1] = { 0 };
+
+    data = length > 0 ? data : empty;
+    length = length > 0 ? length : 1;
+    return (uint32_t)data[0] | ((uint32_t)data[length >> 1] << 8) | ((uint32_t)data[length - 1] << 16);
+}
+
+#ifndef ANY_HASH_NO_XXH32
+
+typedef void (*any_hash_xxh32_group_t)(const uint8_t *const *keys, const size_t *lengths,
+                                       any_hash32_t seed, any_hash32_t *hashes);
+
+static void any_hash_xxh32_group_scalar(const uint8_t *const *keys, const size_t *lengths,
+                                        any_hash32_t seed, any_hash32_t *hashes)
+{
+    for (size_t i = 0; i < ANY_HASH_BATCH_KEYS; i++)
+        hashes[i] = any_hash_xxh32(keys[i], lengths[i], seed);
+}
+
+#ifdef ANY_HASH_HAS_AVX2
+
+// Masks for loading the first n words of a key, the other words are not
+// read so the loads never cross the end of the key
+static const int32_t any_hash_batch_masks32[5][4] = {
+    {  0,  0,  0,  0 },
+    { -1,  0,  0,  0 },
+    { -1, -1,  0,  0 },
+    { -1, -1, -1,  0 },
+    { -1, -1, -1, -1 },
+};
+
+ANY_HASH_TARGET("avx2")
+static ANY_HASH_FORCE_INLINE __m256i any_hash_rotl32_avx2(__m256i hash, int bits)
+{
+    return _mm256_or_si256(_mm256_slli_epi32(hash, bits), _mm256_srli_epi32(hash, 32 - bits));
+}
+
+ANY_HASH_TARGET("avx2")
+static ANY_HASH_FORCE_INLINE __m256i any_hash_mul32_avx2(__m256i hash, any_hash32_t prime)
+{
+    return _mm256_mullo_epi32(hash, _mm256_set1_epi32((int)prime));
+}
+
+ANY_HASH_TARGET("avx2")
+static ANY_HASH_FORCE_INLINE __m256i any_hash_round32_avx2(__m256i hash, __m256i next)
+{
+    hash = _mm256_add_epi32(hash, any_hash_mul32_avx2(next, ANY_HASH_PRIME32_2));
+    return any_hash_mul32_avx2(any_hash_rotl32_avx2(hash, ANY_HASH_ROUND32), ANY_HASH_PRIME32_1);
+}
+
+// Load the first words at offset of eight keys and transpose them, so that
+// the vector i holds the word i of every key
+ANY_HASH_TARGET("avx2")
+static ANY_HASH_FORCE_INLINE void any_hash_fetch32_avx2(__m256i *word, const uint8_t *const *keys,
+                                                        const size_t *offsets, const size_t *words)
+{
+    for (size_t i = 0; i < 4; i++) {
+        const __m128i lo = _mm_maskload_epi32((const int *)(keys[i] + offsets[i]),
+                                              _mm_loadu_si128((const __m128i *)any_hash_batch_masks32[words[i]]));
+        const __m128i hi = _mm_maskload_epi32((const int *)(keys[i + 4] + offsets[i + 4]),
+                                              _mm_loadu_si128((const __m128i *)any_hash_batch_masks32[words[i + 4]]));
+        word[i] = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+    }
+
+    const __m256i t0 = _mm256_unpacklo_epi32(word[0], word[1]);
+    const __m256i t1 = _mm256_unpackhi_epi32(word[0], word[1]);
+    const __m256i t2 = _mm256_unpacklo_epi32(word[2], word[3]);
+    const __m256i t3 = _mm256_unpackhi_epi32(word[2], word[3]);
+
+    word[0] = _mm256_unpacklo_epi64(t0, t2);
+    word[1] = _mm256_unpackhi_epi64(t0, t2);
+    word[2] = _mm256_unpacklo_epi64(t1, t3);
+    word[3] = _mm256_unpackhi_epi64(t1, t3);
+}
+
+ANY_HASH_TARGET("avx2")
+static void any_hash_xxh32_group_avx2(const uint8_t *const *keys, const size_t *lengths,
+                                      any_hash32_t seed, any_hash32_t *hashes)
+{
+    __m256i length[ANY_HASH_BATCH_WAYS];
+    __m256i st1[ANY_HASH_BATCH_WAYS], st2[ANY_HASH_BATCH_WAYS], st3[ANY_HASH_BATCH_WAYS], st4[ANY_HASH_BATCH_WAYS];
+    __m256i word[ANY_HASH_BATCH_WAYS][4];
+    size_t offsets[ANY_HASH_BATCH_KEYS];
+    size_t words[ANY_HASH_BATCH_KEYS];
+    size_t max = 0, tail = 0;
+
+    // The steps that no key needs are skipped, the or of the tails is
+    // at least as large as the longest of them
+    for (size_t i = 0; i < ANY_HASH_BATCH_KEYS; i++) {
+        max = lengths[i] > max ? lengths[i] : max;
+        tail |= lengths[i] & (ANY_HASH_DATALEN32 - 1);
+    }
+
+    for (size_t w = 0; w < ANY_HASH_BATCH_WAYS; w++) {
+        const size_t *l = lengths + w * ANY_HASH_BATCH_LANES;
+        length[w] = _mm256_set_epi32((int)l[7], (int)l[6], (int)l[5], (int)l[4],
+                                     (int)l[3], (int)l[2], (int)l[1], (int)l[0]);
+
+        st1[w] = _mm256_set1_epi32((int)(seed + ANY_HASH_PRIME32_1 + ANY_HASH_PRIME32_2));
+        st2[w] = _mm256_set1_epi32((int)(seed + ANY_HASH_PRIME32_2));
+        st3[w] = _mm256_set1_epi32((int)seed);
+        st4[w] = _mm256_set1_epi32((int)(seed - ANY_HASH_PRIME32_1));
+    }
+
+    for (size_t offset = 0; offset + ANY_HASH_DATALEN32 <= max; offset += ANY_HASH_DATALEN32) {
+        for (size_t i = 0; i < ANY_HASH_BATCH_KEYS; i++) {
+            offsets[i] = offset;
+            words[i] = offset + ANY_HASH_DATALEN32 <= lengths[i] ? 4 : 0;
+        }
+
+        const __m256i end = _mm256_set1_epi32((int)(offset + ANY_HASH_DATALEN32 - 1));
+        for (size_t w = 0; w < ANY_HASH_BATCH_WAYS; w++) {
+            const size_t key = w * ANY_HASH_BATCH_LANES;
+            any_hash_fetch32_avx2(word[w], keys + key, offsets + key, words + key);
+
+            const __m256i active = _mm256_cmpgt_epi32(length[w], end);
+            st1[w] = _mm256_blendv_epi8(st1[w], any_hash_round32_avx2(st1[w], word[w][0]), active);
+            st2[w] = _mm256_blendv_epi8(st2[w], any_hash_round32_avx2(st2[w], word[w][1]), active);
+            st3[w] = _mm256_blendv_epi8(st3[w], any_hash_round32_avx2(st3[w], word[w][2]), active);
+            st4[w] = _mm256_blendv_epi8(st4[w], any_hash_round32_avx2(st4[w], word[w][3]), active);
+        }
+    }
+
+    // The remaining words (at most 3) start after the stripes of each key
+    for (size_t i = 0; i < ANY_HASH_BATCH_KEYS; i++) {
+        offsets[i] = lengths[i] & ~(size_t)(ANY_HASH_DATALEN32 - 1);
+        words[i] = (lengths[i] & (ANY_HASH_DATALEN32 - 1)) / ANY_HASH_BYTES32;
+    }
+
+    __m256i hash[ANY_HASH_BATCH_WAYS];
+    for (size_t w = 0; w < ANY_HASH_BATCH_WAYS; w++) {
+        const size_t key = w * ANY_HASH_BATCH_LANES;
+        any_hash_fetch32_avx2(word[w], keys + key, offsets + key, words + key);
+
+        hash[w] = _mm256_add_epi32(_mm256_add_epi32(any_hash_rotl32_avx2(st1[w], ANY_HASH_ROTL1),
+                                                    any_hash_rotl32_avx2(st2[w], ANY_HASH_ROTL2)),
+                                   _mm256_add_epi32(any_hash_rotl32_avx2(st3[w], ANY_HASH_ROTL3),
+                                                    any_hash_rotl32_avx2(st4[w], ANY_HASH_ROTL4)));
+
+        const __m256i stripes = _mm256_cmpgt_epi32(length[w], _mm256_set1_epi32(ANY_HASH_DATALEN32 - 1));
+        hash[w] = _mm256_blendv_epi8(_mm256_set1_epi32((int)(seed + ANY_HASH_PRIME32_5)), hash[w], stripes);
+        hash[w] = _mm256_add_epi32(hash[w], length[w]);
+    }
+
+    for (size_t n = 0; 4 * n + 3 < tail; n++) {
+        for (size_t w = 0; w < ANY_HASH_BATCH_WAYS; w++) {
+            const __m256i rest = _mm256_and_si256(length[w], _mm256_set1_epi32(ANY_HASH_DATALEN32 - 1));
+            const __m256i active = _mm256_cmpgt_epi32(rest, _mm256_set1_epi32((int)(4 * n + 3)));
+
+            __m256i next = _mm256_add_epi32(hash[w], any_hash_mul32_avx2(word[w][n], ANY_HASH_PRIME32_3));
+            next = any_hash_mul32_avx2(any_hash_rotl32_avx2(next, ANY_HASH_PROC32_1), ANY_HASH_PRIME32_4);
+            hash[w] = _mm256_blendv_epi8(hash[w], next, active);
+        }
+    }
+
+    __m256i bytes[ANY_HASH_BATCH_WAYS];
+    for (size_t w = 0; w < ANY_HASH_BATCH_WAYS; w++) {
+        const uint8_t *const *k = keys + w * ANY_HASH_BATCH_LANES;
+        const size_t *l = lengths + w * ANY_HASH_BATCH_LANES;
+        bytes[w] = _mm256_set_epi32((int)any_hash_batch_bytes(k[7] + (l[7] & ~(size_t)3), l[7] & 3),
+                                    (int)any_hash_batch_bytes(k[6] + (l[6] & ~(size_t)3), l[6] & 3),
+                                    (int)any_hash_batch_bytes(k[5] + (l[5] & ~(size_t)3), l[5] & 3),
+                                    (int)any_hash_batch_bytes(k[4] + (l[4] & ~(size_t)3), l[4] & 3),
+                                    (int)any_hash_batch_bytes(k[3] + (l[3] & ~(size_t)3), l[3] & 3),
+                                    (int)any_hash_batch_bytes(k[2] + (l[2] & ~(size_t)3), l[2] & 3),
+                                    (int)any_hash_batch_bytes(k[1] + (l[1] & ~(size_t)3), l[1] & 3),
+                                    (int)any_hash_batch_bytes(k[0] + (l[0] & ~(size_t)3), l[0] & 3));
+    }
+
+    for (size_t n = 0; n < (tail & 3); n++) {
+        for (size_t w = 0; w < ANY_HASH_BATCH_WAYS; w++) {
+            const __m256i count = _mm256_and_si256(length[w], _mm256_set1_epi32(3));
+            const __m256i active = _mm256_cmpgt_epi32(count, _mm256_set1_epi32((int)n));
+            const __m256i byte = _mm256_and_si256(_mm256_srli_epi32(bytes[w], (int)(8 * n)), _mm256_set1_epi32(0xff));
+
+            __m256i next = _mm256_add_epi32(hash[w], any_hash_mul32_avx2(byte, ANY_HASH_PRIME32_5));
+            next = any_hash_mul32_avx2(any_hash_rotl32_avx2(next, ANY_HASH_PROC32_2), ANY_HASH_PRIME32_1);
+            hash[w] = _mm256_blendv_epi8(hash[w], next, active);
+        }
+    }
+
+    for (size_t w = 0; w < ANY_HASH_BATCH_WAYS; w++) {
+        __m256i value = hash[w];
+        value = _mm256_xor_si256(value, _mm256_srli_epi32(value, ANY_HASH_AV32_1));
+        value = any_hash_mul32_avx2(value, ANY_HASH_PRIME32_2);
+        value = _mm256_xor_si256(value, _mm256_srli_epi32(value, ANY_HASH_AV32_2));
+        value = any_hash_mul32_avx2(value, ANY_HASH_PRIME32_3);
+        value = _mm256_xor_si256(value, _mm256_srli_epi32(value, ANY_HASH_AV32_3));
+        _mm256_storeu_si256((__m256i *)(hashes + w * ANY_HASH_BATCH_LANES), value);
+    }
+}
+
+#endif
+
+// The kernel is bound by any_hash_set_kernel, see any_hash_xxh3_long
+//
+static void any_hash_xxh32_group_resolve(const uint8_t *const *keys, const size_t *lengths,
+                                         any_hash32_t seed, any_hash32_t *hashes);
+
+static any_hash_xxh32_group_t any_hash_xxh32_group = any_hash_xxh32_group_resolve;
+
+static void any_hash_xxh32_group_resolve(const uint8_t *const *keys, const size_t *lengths,
+                                         any_hash32_t seed, any_hash32_t *hashes)
+{
+    any_hash_init();
+    ANY_HASH_LOAD(&any_hash_xxh32_group)(keys, lengths, seed, hashes);
+}
+
+void any_hash_xxh32_batch(const uint8_t **keys, const size_t *lengths, size_t count,
+                          any_hash32_t seed, any_hash32_t *hashes)
+{
+    const uint8_t *group[ANY_HASH_BATCH_KEYS];
+    size_t group_lengths[ANY_HASH_BATCH_KEYS];
+    size_t indices[ANY_HASH_BATCH_KEYS];
+    any_hash32_t group_hashes[ANY_HASH_BATCH_KEYS];
+    size_t size = 0;
+
+    // Without a vectorized kernel the grouping is only overhead
+    const any_hash_xxh32_group_t group_kernel = ANY_HASH_LOAD(&any_hash_xxh32_group);
+    if (group_kernel == any_hash_xxh32_group_scalar) {
+        for (size_t i = 0; i < count; i++)
+            hashes[i] = any_hash_xxh32(keys[i], lengths[i], seed);
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (lengths[i] > ANY_HASH_BATCH_LIMIT) {
+            hashes[i] = any_hash_xxh32(keys[i], lengths[i], seed);
+            continue;
+        }
+
+        group[size] = keys[i];
+        group_lengths[size] = lengths[i];
+        indices[size++] = i;
+
+        if (size == ANY_HASH_BATCH_KEYS) {
+            group_kernel(group, group_lengths, seed, group_hashes);
+            for (size_t j = 0; j < size; j++)
+                hashes[indices[j]] = group_hashes[j];
+            size = 0;
+        }
+    }
+
+    // The last keys are hashed one by one if they are too few to fill
+    // a vector, otherwise the group is completed with empty keys
+    if (size < ANY_HASH_BATCH_LANES) {
+        for (size_t j = 0; j < size; j++)
+            hashes[indices[j]] = any_hash_xxh32(group[j], group_lengths[j], seed);
+        return;
+    }
+
+    for (size_t j = size; j < ANY_HASH_BATCH_KEYS; j++) {
+        group[j] = group[0];
+        group_lengths[j] = 0;
+    }
+
+    group_kernel(group, group_lengths, seed, group_hashes);
+    for (size_t j = 0; j < size; j++)
+        hashes[indices[j]] = group_hashes[j];
+}
+
+#endif
+
+#ifndef ANY_HASH_NO_XXH64
+
+typedef void (*any_hash_xxh64_group_t)(const uint8_t *const *keys, const size_t *lengths,
+                                       any_hash64_t seed, any_hash64_t *hashes);
+
+static void any_hash_xxh64_group_scalar(const uint8_t *const *keys, const size_t *lengths,
+                                        any_hash64_t seed, any_hash64_t *hashes)
+{
+    for (size_t i = 0; i < ANY_HASH_BATCH_KEYS; i++)
+        hashes[i] = any_hash_xxh64(keys[i], lengths[i], seed);
+}
+
+#ifdef ANY_HASH_HAS_AVX512
+
+static const int64_t any_hash_batch_masks64[5][4] = {
+    {  0,  0,  0,  0 },
+    { -1,  0,  0,  0 },
+    { -1, -1,  0,  0 },
+    { -1, -1, -1,  0 },
+    { -1, -1, -1, -1 },
+};
+
+// AVX-512F has no 64 bit multiplication, it's done with three 32 bit ones
+ANY_HASH_TARGET("avx512f")
+static ANY_HASH_FORCE_INLINE __m512i any_hash_mul64_avx512(__m512i hash, any_hash64_t prime)
+{
+    const __m512i lo = _mm512_set1_epi64((long long)(prime & 0xffffffff));
+    const __m512i hi = _mm512_set1_epi64((long long)(prime >> 32));
+    const __m512i cross = _mm512_add_epi64(_mm512_mul_epu32(hash, hi), _mm512_mul_epu32(_mm512_srli_epi64(hash, 32), lo));
+    return _mm512_add_epi64(_mm512_mul_epu32(hash, lo), _mm512_slli_epi64(cross, 32));
+}
+
+ANY_HASH_TARGET("avx512f")
+static ANY_HASH_FORCE_INLINE __m512i any_hash_rotl64_avx512(__m512i hash, int bits)
+{
+    return _mm512_rolv_epi64(hash, _mm512_set1_epi64(bits));
+}
+
+ANY_HASH_TARGET("avx512f")
+static ANY_HASH_FORCE_INLINE __m512i any_hash_round64_avx512(__m512i hash, __m512i next)
+{
+    hash = _mm512_add_epi64(hash, any_hash_mul64_avx512(next, ANY_HASH_PRIME64_2));
+    return any_hash_mul64_avx512(any_hash_rotl64_avx512(hash, ANY_HASH_ROUND64), ANY_HASH_PRIME64_1);
+}
+
+ANY_HASH_TARGET("avx512f")
+static ANY_HASH_FORCE_INLINE __m512i any_hash_round64_merge_avx512(__m512i hash, __m512i next)
+{
+    hash = _mm512_xor_si512(hash, any_hash_round64_avx512(_mm512_setzero_si512(), next));
+    hash = any_hash_mul64_avx512(hash, ANY_HASH_PRIME64_1);
+    return _mm512_add_epi64(hash, _mm512_set1_epi64((long long)ANY_HASH_PRIME64_4));
+}
+
+// Pack the half word (if any) after the last words of a key in the low 32
+// bits and the last bytes in the high ones
+static inline uint64_t any_hash_batch_rest64(const uint8_t *key, size_t length)
+{
+    static const uint8_t empty[4] = { 0 };
+
+    const uint8_t *tail = key + (length & ~(size_t)7);
+    const size_t half = length & 4;
+
+    return ((uint64_t)any_hash_batch_bytes(tail + half, length & 3) << 32)
+         | any_hash_fetch32(half ? tail : empty, ANY_HASH_UNALIGNED);
+}
+
+// Load the first words at offset of eight keys and transpose them, see
+// any_hash_fetch32_avx2
+ANY_HASH_TARGET("avx512f")
+static ANY_HASH_FORCE_INLINE void any_hash_fetch64_avx512(__m512i *word, const uint8_t *const *keys,
+                                                          const size_t *offsets, const size_t *words)
+{
+    // The row i holds the keys 2i and 2i + 1
+    for (size_t i = 0; i < 4; i++) {
+        const __m256i lo = _mm256_maskload_epi64((const long long *)(keys[2 * i] + offsets[2 * i]),
+                                                 _mm256_loadu_si256((const __m256i *)any_hash_batch_masks64[words[2 * i]]));
+        const __m256i hi = _mm256_maskload_epi64((const long long *)(keys[2 * i + 1] + offsets[2 * i + 1]),
+                                                 _mm256_loadu_si256((const __m256i *)any_hash_batch_masks64[words[2 * i + 1]]));
+        word[i] = _mm512_inserti64x4(_mm512_castsi256_si512(lo), hi, 1);
+    }
+
+    const __m512i even = _mm512_set_epi64(13, 9, 5, 1, 12, 8, 4, 0);
+    const __m512i odd = _mm512_set_epi64(15, 11, 7, 3, 14, 10, 6, 2);
+
+    const __m512i t0 = _mm512_permutex2var_epi64(word[0], even, word[1]);
+    const __m512i t1 = _mm512_permutex2var_epi64(word[0], odd, word[1]);
+    const __m512i t2 = _mm512_permutex2var_epi64(word[2], even, word[3]);
+    const __m512i t3 = _mm512_permutex2var_epi64(word[2], odd, word[3]);
+
+    word[0] = _mm512_shuffle_i64x2(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    word[1] = _mm512_shuffle_i64x2(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    word[2] = _mm512_shuffle_i64x2(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    word[3] = _mm512_shuffle_i64x2(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+ANY_HASH_TARGET("avx512f")
+static ANY_HASH_FORCE_INLINE __m512i any_hash_lengths64_avx512(const size_t *lengths)
+{
+    return _mm512_set_epi64((long long)lengths[7], (long long)lengths[6], (long long)lengths[5], (long long)lengths[4],
+                            (long long)lengths[3], (long long)lengths[2], (long long)lengths[1], (long long)lengths[0]);
+}
+
+ANY_HASH_TARGET("avx512f")
+static void any_hash_xxh64_group_avx512(const uint8_t *const *keys, const size_t *lengths,
+                                        any_hash64_t seed, any_hash64_t *hashes)
+{
+    __m512i length[ANY_HASH_BATCH_WAYS];
+    __m512i st1[ANY_HASH_BATCH_WAYS], st2[ANY_HASH_BATCH_WAYS], st3[ANY_HASH_BATCH_WAYS], st4[ANY_HASH_BATCH_WAYS];
+    __m512i word[ANY_HASH_BATCH_WAYS][4];
+    size_t offsets[ANY_HASH_BATCH_KEYS];
+    size_t words[ANY_HASH_BATCH_KEYS];
+    size_t max = 0, tail = 0;
+
+    // See any_hash_xxh32_group_avx2
+    for (size_t i = 0; i < ANY_HASH_BATCH_KEYS; i++) {
+        max = lengths[i] > max ? lengths[i] : max;
+        tail |= lengths[i] & (ANY_HASH_DATALEN64 - 1);
+    }
+
+    for (size_t w = 0; w < ANY_HASH_BATCH_WAYS; w++) {
+        length[w] = any_hash_lengths64_avx512(lengths + w * ANY_HASH_BATCH_LANES);
+
+        st1[w] = _mm512_set1_epi64((long long)(seed + ANY_HASH_PRIME64_1 + ANY_HASH_PRIME64_2));
+        st2[w] = _mm512_set1_epi64((long long)(seed + ANY_HASH_PRIME64_2));
+        st3[w] = _mm512_set1_epi64((long long)seed);
+        st4[w] = _mm512_set1_epi64((long long)(seed - ANY_HASH_PRIME64_1));
+    }
+
+    for (size_t offset = 0; offset + ANY_HASH_DATALEN64 <= max; offset += ANY_HASH_DATALEN64) {
+        for (size_t i = 0; i < ANY_HASH_BATCH_KEYS; i++) {
+            offsets[i] = offset;
+            words[i] = offset + ANY_HASH_DATALEN64 <= lengths[i] ? 4 : 0;
+        }
+
+        const __m512i end = _mm512_set1_epi64((long long)(offset + ANY_HASH_DATALEN64 - 1));
+        for (size_t w = 0; w < ANY_HASH_BATCH_WAYS; w++) {
+            const size_t key = w * ANY_HASH_BATCH_LANES;
+            any_hash_fetch64_avx512(word[w], keys + key, offsets + key, words + key);
+
+            const __mmask8 active = _mm512_cmpgt_epu64_mask(length[w], end);
+            st1[w] = _mm512_mask_mov_epi64(st1[w], active, any_hash_round64_avx512(st1[w], word[w][0]));
+            st2[w] = _mm512_mask_mov_epi64(st2[w], active, any_hash_round64_avx512(st2[w], word[w][1]));
+            st3[w] = _mm512_mask_mov_epi64(st3[w], active, any_hash_round64_avx512(st3[w], word[w][2]));
+            st4[w] = _mm512_mask_mov_epi64(st4[w], active, any_hash_round64_avx512(st4[w], word[w][3]));
+        }
+    }
+
+    // The remaining words (at most 3) start after the stripes of each key
+    for (size_t i = 0; i < ANY_HASH_BATCH_KEYS; i++) {
+        offsets[i] = lengths[i] & ~(size_t)(ANY_HASH_DATALEN64 - 1);
+        words[i] = (lengths[i] & (ANY_HASH_DATALEN64 - 1)) / ANY_HASH_BYTES64;
+    }
+
+    __m512i hash[ANY_HASH_BATCH_WAYS];
+    for (size_t w = 0; w < ANY_HASH_BATCH_WAYS; w++) {
+        const size_t key = w * ANY_HASH_BATCH_LANES;
+        any_hash_fetch64_avx512(word[w], keys + key, offsets + key, words + key);
+
+        hash[w] = _mm512_add_epi64(_mm512_add_epi64(any_hash_rotl64_avx512(st1[w], ANY_HASH_ROTL1),
+                                                    any_hash_rotl64_avx512(st2[w], ANY_HASH_ROTL2)),
+                                   _mm512_add_epi64(any_hash_rotl64_avx512(st3[w], ANY_HASH_ROTL3),
+                                                    any_hash_rotl64_avx512(st4[w], ANY_HASH_ROTL4)));
+
+        if (max >= ANY_HASH_DATALEN64) {
+            hash[w] = any_hash_round64_merge_avx512(hash[w], st1[w]);
+            hash[w] = any_hash_round64_merge_avx512(hash[w], st2[w]);
+            hash[w] = any_hash_round64_merge_avx512(hash[w], st3[w]);
+            hash[w] = any_hash_round64_merge_avx512(hash[w], st4[w]);
+        }
+
+        const __mmask8 stripes = _mm512_cmpgt_epu64_mask(length[w], _mm512_set1_epi64(ANY_HASH_DATALEN64 - 1));
+        hash[w] = _mm512_mask_mov_epi64(_mm512_set1_epi64((long long)(seed + ANY_HASH_PRIME64_5)), stripes, hash[w]);
+        hash[w] = _mm512_add_epi64(hash[w], length[w]);
+    }
+
+    for (size_t n = 0; 8 * n + 7 < tail; n++) {
+        for (size_t w = 0; w < ANY_HASH_BATCH_WAYS; w++) {
+            const __m512i rest = _mm512_and_si512(length[w], _mm512_set1_epi64(ANY_HASH_DATALEN64 - 1));
+            const __mmask8 active = _mm512_cmpgt_epu64_mask(rest, _mm512_set1_epi64((long long)(8 * n + 7)));
+
+            __m512i next = _mm512_xor_si512(hash[w], any_hash_round64_avx512(_mm512_setzero_si512(), word[w][n]));
+            next = any_hash_mul64_avx512(any_hash_rotl64_avx512(next, ANY_HASH_PROC64_1), ANY_HASH_PRIME64_1);
+            next = _mm512_add_epi64(next, _mm512_set1_epi64((long long)ANY_HASH_PRIME64_4));
+            hash[w] = _mm512_mask_mov_epi64(hash[w], active, next);
+        }
+    }
+
+    // The last half word and bytes, packed in a single word
+    __m512i rest[ANY_HASH_BATCH_WAYS];
+    for (size_t w = 0; w < ANY_HASH_BATCH_WAYS; w++) {
+        const uint8_t *const *k = keys + w * ANY_HASH_BATCH_LANES;
+        const size_t *l = lengths + w * ANY_HASH_BATCH_LANES;
+        rest[w] = _mm512_set_epi64((long long)any_hash_batch_rest64(k[7], l[7]), (long long)any_hash_batch_rest64(k[6], l[6]),
+                                   (long long)any_hash_batch_rest64(k[5], l[5]), (long long)any_hash_batch_rest64(k[4], l[4]),
+                                   (long long)any_hash_batch_rest64(k[3], l[3]), (long long)any_hash_batch_rest64(k[2], l[2]),
+                                   (long long)any_hash_batch_rest64(k[1], l[1]), (long long)any_hash_batch_rest64(k[0], l[0]));
+    }
+
+    for (size_t w = 0; w < ANY_HASH_BATCH_WAYS && (tail & 4); w++) {
+        const __mmask8 active = _mm512_test_epi64_mask(length[w], _mm512_set1_epi64(4));
+
+        __m512i next = _mm512_and_si512(rest[w], _mm512_set1_epi64(0xffffffff));
+        next = _mm512_xor_si512(hash[w], any_hash_mul64_avx512(next, ANY_HASH_PRIME64_1));
+        next = any_hash_mul64_avx512(any_hash_rotl64_avx512(next, ANY_HASH_PROC64_2), ANY_HASH_PRIME64_2);
+        next = _mm512_add_epi64(next, _mm512_set1_epi64((long long)ANY_HASH_PRIME64_3));
+        hash[w] = _mm512_mask_mov_epi64(hash[w], active, next);
+    }
+
+    for (size_t n = 0; n < (tail & 3); n++) {
+        for (size_t w = 0; w < ANY_HASH_BATCH_WAYS; w++) {
+            const __m512i count = _mm512_and_si512(length[w], _mm512_set1_epi64(3));
+            const __mmask8 active = _mm512_cmpgt_epu64_mask(count, _mm512_set1_epi64((long long)n));
+            const __m512i byte = _mm512_and_si512(_mm512_srli_epi64(rest[w], (unsigned)(32 + 8 * n)), _mm512_set1_epi64(0xff));
+
+            __m512i next = _mm512_xor_si512(hash[w], any_hash_mul64_avx512(byte, ANY_HASH_PRIME64_5));
+            next = any_hash_mul64_avx512(any_hash_rotl64_avx512(next, ANY_HASH_PROC64_3), ANY_HASH_PRIME64_1);
+            hash[w] = _mm512_mask_mov_epi64(hash[w], active, next);
+        }
+    }
+
+    for (size_t w = 0; w < ANY_HASH_BATCH_WAYS; w++) {
+        __m512i value = hash[w];
+        value = _mm512_xor_si512(value, _mm512_srli_epi64(value, ANY_HASH_AV64_1));
+        value = any_hash_mul64_avx512(value, ANY_HASH_PRIME64_2);
+        value = _mm512_xor_si512(value, _mm512_srli_epi64(value, ANY_HASH_AV64_2));
+        value = any_hash_mul64_avx512(value, ANY_HASH_PRIME64_3);
+        value = _mm512_xor_si512(value, _mm512_srli_epi64(value, ANY_HASH_AV64_3));
+        _mm512_storeu_si512(hashes + w * ANY_HASH_BATCH_LANES, value);
+    }
+}
+
+#endif
+
+static void any_hash_xxh64_group_resolve(const uint8_t *const *keys, const size_t *lengths,
+                                         any_hash64_t seed, any_hash64_t *hashes);
+
+static any_hash_xxh64_group_t any_hash_xxh64_group = any_hash_xxh64_group_resolve;
+
+static void any_hash_xxh64_group_resolve(const uint8_t *const *keys, const size_t *lengths,
+                                         any_hash64_t seed, any_hash64_t *hashes)
+{
+    any_hash_init();
+    ANY_HASH_LOAD(&any_hash_xxh64_group)(keys, lengths, seed, hashes);
 }
 
-static any_hash64_t any_hash_round64(any_hash64_t hash, any_hash64_t next)
+void any_hash_xxh64_batch(const uint8_t **keys, const size_t *lengths, size_t count,
+                          any_hash64_t seed, any_hash64_t *hashes)
 {
-    hash += next * ANY_HASH_PRIME64_2;
-    hash = ANY_HASH_ROTL64(hash, ANY_HASH_ROUND64);
-    hash *= ANY_HASH_PRIME64_1;
-    return hash;
+    const uint8_t *group[ANY_HASH_BATCH_KEYS];
+    size_t group_lengths[ANY_HASH_BATCH_KEYS];
+    size_t indices[ANY_HASH_BATCH_KEYS];
+    any_hash64_t group_hashes[ANY_HASH_BATCH_KEYS];
+    size_t size = 0;
+
+    // Without a vectorized kernel the grouping is only overhead
+    const any_hash_xxh64_group_t group_kernel = ANY_HASH_LOAD(&any_hash_xxh64_group);
+    if (group_kernel == any_hash_xxh64_group_scalar) {
+        for (size_t i = 0; i < count; i++)
+            hashes[i] = any_hash_xxh64(keys[i], lengths[i], seed);
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (lengths[i] > ANY_HASH_BATCH_LIMIT) {
+            hashes[i] = any_hash_xxh64(keys[i], lengths[i], seed);
+            continue;
+        }
+
+        group[size] = keys[i];
+        group_lengths[size] = lengths[i];
+        indices[size++] = i;
+
+        if (size == ANY_HASH_BATCH_KEYS) {
+            group_kernel(group, group_lengths, seed, group_hashes);
+            for (size_t j = 0; j < size; j++)
+                hashes[indices[j]] = group_hashes[j];
+            size = 0;
+        }
+    }
+
+    // See any_hash_xxh32_batch
+    if (size < ANY_HASH_BATCH_LANES) {
+        for (size_t j = 0; j < size; j++)
+            hashes[indices[j]] = any_hash_xxh64(group[j], group_lengths[j], seed);
+        return;
+    }
+
+    for (size_t j = size; j < ANY_HASH_BATCH_KEYS; j++) {
+        group[j] = group[0];
+        group_lengths[j] = 0;
+    }
+
+    group_kernel(group, group_lengths, seed, group_hashes);
+    for (size_t j = 0; j < size; j++)
+        hashes[indices[j]] = group_hashes[j];
 }
 
-static any_hash64_t any_hash_round64_merge(any_hash64_t hash, any_hash64_t next)
+#endif
+
+#ifndef ANY_HASH_NO_FILE
+
+// File hashing
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// The size of the reads when a file can't be mapped
+#ifndef ANY_HASH_FILE_BUFFER
+#define ANY_HASH_FILE_BUFFER (1024 * 1024)
+#endif
+
+#define ANY_HASH_FILE_ALIGN 4096
+
+typedef void (*any_hash_file_update_t)(void *state, const uint8_t *data, size_t length);
+
+// Feed the contents of the file, from the current position, to a streaming state
+static bool any_hash_fd_update(int fd, void *state, any_hash_file_update_t update)
 {
-    hash ^= any_hash_round64(0, next);
-    hash = hash * ANY_HASH_PRIME64_1 + ANY_HASH_PRIME64_4;
-    return hash;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0
+        && (uintmax_t)st.st_size <= SIZE_MAX && lseek(fd, 0, SEEK_CUR) == 0) {
+        const size_t length = (size_t)st.st_size;
+
+        void *map = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+#ifdef POSIX_MADV_SEQUENTIAL
+            posix_madvise(map, length, POSIX_MADV_SEQUENTIAL);
+#endif
+            update(state, (const uint8_t *)map, length);
+            munmap(map, length);
+            return true;
+        }
+    }
+
+    // Pipes, special files (which may report a size of zero) and the files
+    // that can't be mapped are read in chunks
+    uint8_t *buffer = (uint8_t *)ANY_HASH_MALLOC(ANY_HASH_FILE_BUFFER + ANY_HASH_FILE_ALIGN);
+    if (buffer == NULL) {
+        errno = ENOMEM;
+        return false;
+    }
+
+    uint8_t *aligned = buffer + (ANY_HASH_FILE_ALIGN - (uintptr_t)buffer % ANY_HASH_FILE_ALIGN) % ANY_HASH_FILE_ALIGN;
+    bool success = true;
+
+    for (;;) {
+        const ssize_t size = read(fd, aligned, ANY_HASH_FILE_BUFFER);
+        if (size > 0)
+            update(state, aligned, (size_t)size);
+        else if (size == 0)
+            break;
+        else if (errno != EINTR) {
+            success = false;
+            break;
+        }
+    }
+
+    const int error = errno;
+    ANY_HASH_FREE(buffer);
+    errno = error;
+    return success;
 }
 
-any_hash64_t any_hash_xxh64(const uint8_t *data, size_t length, any_hash64_t seed)
+#ifndef ANY_HASH_NO_XXH32
+
+static void any_hash_xxh32_file_update(void *state, const uint8_t *data, size_t length)
 {
-    any_hash64_t hash;
-    const int_fast32_t align = (uintptr_t)data & ANY_HASH_ALIGN64;
+    any_hash_xxh32_update((any_hash_xxh32_state_t *)state, data, length);
+}
 
-    if (length >= ANY_HASH_DATALEN64) {
-        const uint8_t *const end = data + length - ANY_HASH_DATALEN64;
-
-        any_hash64_t st1 = seed + ANY_HASH_PRIME64_1 + ANY_HASH_PRIME64_2;
-        any_hash64_t st2 = seed + ANY_HASH_PRIME64_2;
-        any_hash64_t st3 = seed;
-        any_hash64_t st4 = seed - ANY_HASH_PRIME64_1;
-
-        do {
-            st1 = any_hash_round64(st1, any_hash_fetch64(data, align));
-            data += ANY_HASH_BYTES64;
-            st2 = any_hash_round64(st2, any_hash_fetch64(data, align));
-            data += ANY_HASH_BYTES64;
-            st3 = any_hash_round64(st3, any_hash_fetch64(data, align));
-            data += ANY_HASH_BYTES64;
-            st4 = any_hash_round64(st4, any_hash_fetch64(data, align));
-            data += ANY_HASH_BYTES64;
-        } while (data <= end);
-
-        hash = ANY_HASH_ROTL64(st1, ANY_HASH_ROTL1) + ANY_HASH_ROTL64(st2, ANY_HASH_ROTL2)
-             + ANY_HASH_ROTL64(st3, ANY_HASH_ROTL3) + ANY_HASH_ROTL64(st4, ANY_HASH_ROTL4);
-
-        hash = any_hash_round64_merge(hash, st1);
-        hash = any_hash_round64_merge(hash, st2);
-        hash = any_hash_round64_merge(hash, st3);
-        hash = any_hash_round64_merge(hash, st4);
-    } else
-        hash = seed + ANY_HASH_PRIME64_5;
+bool any_hash_fd_xxh32(int fd, any_hash32_t seed, any_hash32_t *hash)
+{
+    any_hash_xxh32_state_t state;
+    any_hash_xxh32_reset(&state, seed);
 
-    hash += length;
-    length &= (ANY_HASH_DATALEN64 - 1);
+    if (!any_hash_fd_update(fd, &state, any_hash_xxh32_file_update))
+        return false;
 
-    while (length >= 8) {
-        hash ^= any_hash_round64(0, any_hash_fetch64(data, align));
-        hash = ANY_HASH_ROTL64(hash, ANY_HASH_PROC64_1) * ANY_HASH_PRIME64_1 + ANY_HASH_PRIME64_4;
-        data += ANY_HASH_BYTES64;
-        length -= ANY_HASH_BYTES64;
+    *hash = any_hash_xxh32_digest(&state);
+    return true;
+}
+
+bool any_hash_file_xxh32(const char *path, any_hash32_t seed, any_hash32_t *hash)
+{
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    // Keep the errno of the hashing
+    const bool success = any_hash_fd_xxh32(fd, seed, hash);
+    const int error = errno;
+    close(fd);
+    errno = error;
+    return success;
+}
+
+#endif
+
+#ifndef ANY_HASH_NO_XXH64
+
+static void any_hash_xxh64_file_update(void *state, const uint8_t *data, size_t length)
+{
+    any_hash_xxh64_update((any_hash_xxh64_state_t *)state, data, length);
+}
+
+bool any_hash_fd_xxh64(int fd, any_hash64_t seed, any_hash64_t *hash)
+{
+    any_hash_xxh64_state_t state;
+    any_hash_xxh64_reset(&state, seed);
+
+    if (!any_hash_fd_update(fd, &state, any_hash_xxh64_file_update))
+        return false;
+
+    *hash = any_hash_xxh64_digest(&state);
+    return true;
+}
+
+bool any_hash_file_xxh64(const char *path, any_hash64_t seed, any_hash64_t *hash)
+{
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    // Keep the errno of the hashing
+    const bool success = any_hash_fd_xxh64(fd, seed, hash);
+    const int error = errno;
+    close(fd);
+    errno = error;
+    return success;
+}
+
+#endif
+
+#endif
+
+#ifndef ANY_HASH_NO_IOV
+
+// Scatter gather hashing
+
+#ifndef ANY_HASH_NO_XXH32
+
+any_hash32_t any_hash_xxh32_iov(const struct iovec *iov, int cnt, any_hash32_t seed)
+{
+    if (cnt == 1)
+        return any_hash_xxh32((const uint8_t *)iov[0].iov_base, iov[0].iov_len, seed);
+
+    any_hash_xxh32_state_t state;
+    any_hash_xxh32_reset(&state, seed);
+
+    for (int i = 0; i < cnt; i++)
+        any_hash_xxh32_update(&state, (const uint8_t *)iov[i].iov_base, iov[i].iov_len);
+
+    return any_hash_xxh32_digest(&state);
+}
+
+#endif
+
+#ifndef ANY_HASH_NO_XXH64
+
+any_hash64_t any_hash_xxh64_iov(const struct iovec *iov, int cnt, any_hash64_t seed)
+{
+    if (cnt == 1)
+        return any_hash_xxh64((const uint8_t *)iov[0].iov_base, iov[0].iov_len, seed);
+
+    any_hash_xxh64_state_t state;
+    any_hash_xxh64_reset(&state, seed);
+
+    for (int i = 0; i < cnt; i++)
+        any_hash_xxh64_update(&state, (const uint8_t *)iov[i].iov_base, iov[i].iov_len);
+
+    return any_hash_xxh64_digest(&state);
+}
+
+#endif
+
+#endif
+
+#if !defined(ANY_HASH_NO_XXH64) && !defined(ANY_HASH_NO_TREE)
+
+// Tree hashing
+
+// The leaves are hashed in rounds, so that their hashes fit on the stack.
+// This doesn't change the result, the leaf hashes are combined in order.
+#define ANY_HASH_TREE_ROUND 256
+
+#ifndef ANY_HASH_NO_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+struct any_hash_pool {
+#ifndef ANY_HASH_NO_THREADS
+    pthread_mutex_t mutex;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    pthread_t *threads;
+    size_t running;
+    size_t round;
+    bool stop;
+#endif
+    size_t workers;
+
+    // The leaves of the current round
+    const uint8_t *data;
+    size_t length;
+    any_hash64_t seed;
+    any_hash64_t *hashes;
+    size_t leaves;
+    size_t next;
+};
+
+// Take the next leaf of the round, or return false if there are none left
+static bool any_hash_pool_take(any_hash_pool_t *pool, size_t *leaf)
+{
+#ifndef ANY_HASH_NO_THREADS
+    if (pool->workers > 0)
+        pthread_mutex_lock(&pool->mutex);
+#endif
+
+    *leaf = pool->next;
+    if (pool->next < pool->leaves)
+        pool->next++;
+
+#ifndef ANY_HASH_NO_THREADS
+    if (pool->workers > 0)
+        pthread_mutex_unlock(&pool->mutex);
+#endif
+
+    return *leaf < pool->leaves;
+}
+
+static void any_hash_pool_work(any_hash_pool_t *pool)
+{
+    size_t leaf;
+    while (any_hash_pool_take(pool, &leaf)) {
+        const size_t offset = leaf * ANY_HASH_TREE_LEAF;
+        const size_t length = pool->length - offset < ANY_HASH_TREE_LEAF
+                            ? pool->length - offset
+                            : ANY_HASH_TREE_LEAF;
+
+        pool->hashes[leaf] = any_hash_xxh64(pool->data + offset, length, pool->seed);
     }
+}
 
-    while (length >= 4) {
-        hash ^= (any_hash64_t)(any_hash_fetch32(data, align)) * ANY_HASH_PRIME64_1;
-        hash = ANY_HASH_ROTL64(hash, ANY_HASH_PROC64_2) * ANY_HASH_PRIME64_2 + ANY_HASH_PRIME64_3;
-        data += ANY_HASH_BYTES32;
-        length -= ANY_HASH_BYTES32;
+#ifndef ANY_HASH_NO_THREADS
+
+// NOTE: The caller of any_hash_xxh64_tree waits for all the workers to
+//       finish a round before starting the next one, so no round is missed
+static void *any_hash_pool_worker(void *arg)
+{
+    any_hash_pool_t *pool = (any_hash_pool_t *)arg;
+    size_t round = 0;
+
+    pthread_mutex_lock(&pool->mutex);
+    for (;;) {
+        while (!pool->stop && pool->round == round)
+            pthread_cond_wait(&pool->start, &pool->mutex);
+
+        if (pool->stop)
+            break;
+
+        round = pool->round;
+        pthread_mutex_unlock(&pool->mutex);
+
+        any_hash_pool_work(pool);
+
+        pthread_mutex_lock(&pool->mutex);
+        if (--pool->running == 0)
+            pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+#endif
+
+any_hash_pool_t *any_hash_pool_new(size_t threads)
+{
+    any_hash_pool_t *pool = (any_hash_pool_t *)ANY_HASH_MALLOC(sizeof(any_hash_pool_t));
+    if (pool == NULL)
+        return NULL;
+
+    memset(pool, 0, sizeof(any_hash_pool_t));
+
+#ifndef ANY_HASH_NO_THREADS
+    if (threads == 0) {
+        const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? (size_t)cpus : 1;
+    }
+
+    if (threads <= 1)
+        return pool;
+
+    pool->threads = (pthread_t *)ANY_HASH_MALLOC(sizeof(pthread_t) * (threads - 1));
+    if (pool->threads == NULL) {
+        ANY_HASH_FREE(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    // If a thread can't be started the pool just uses less threads
+    while (pool->workers < threads - 1) {
+        if (pthread_create(&pool->threads[pool->workers], NULL, any_hash_pool_worker, pool) != 0)
+            break;
+        pool->workers++;
+    }
+#else
+    (void)threads;
+#endif
+
+    return pool;
+}
+
+void any_hash_pool_free(any_hash_pool_t *pool)
+{
+    if (pool == NULL)
+        return;
+
+#ifndef ANY_HASH_NO_THREADS
+    if (pool->threads != NULL) {
+        pthread_mutex_lock(&pool->mutex);
+        pool->stop = true;
+        pthread_cond_broadcast(&pool->start);
+        pthread_mutex_unlock(&pool->mutex);
+
+        for (size_t i = 0; i < pool->workers; i++)
+            pthread_join(pool->threads[i], NULL);
+
+        pthread_cond_destroy(&pool->done);
+        pthread_cond_destroy(&pool->start);
+        pthread_mutex_destroy(&pool->mutex);
+        ANY_HASH_FREE(pool->threads);
+    }
+#endif
+
+    ANY_HASH_FREE(pool);
+}
+
+any_hash64_t any_hash_xxh64_tree(any_hash_pool_t *pool, const uint8_t *data, size_t length, any_hash64_t seed)
+{
+    if (length <= ANY_HASH_TREE_LEAF)
+        return any_hash_xxh64(data, length, seed);
+
+    // Without a pool the caller hashes all the leaves
+    any_hash_pool_t serial;
+    if (pool == NULL) {
+        memset(&serial, 0, sizeof(any_hash_pool_t));
+        pool = &serial;
+    }
+
+    any_hash64_t hashes[ANY_HASH_TREE_ROUND];
+    any_hash_xxh64_state_t state;
+    any_hash_xxh64_reset(&state, seed);
+
+    const size_t leaves = (length + ANY_HASH_TREE_LEAF - 1) / ANY_HASH_TREE_LEAF;
+
+    for (size_t first = 0; first < leaves; first += ANY_HASH_TREE_ROUND) {
+        const size_t count = leaves - first < ANY_HASH_TREE_ROUND ? leaves - first : ANY_HASH_TREE_ROUND;
+
+        pool->data = data + first * ANY_HASH_TREE_LEAF;
+        pool->length = length - first * ANY_HASH_TREE_LEAF;
+        pool->seed = seed;
+        pool->hashes = hashes;
+        pool->leaves = count;
+        pool->next = 0;
+
+#ifndef ANY_HASH_NO_THREADS
+        if (pool->workers > 0) {
+            pthread_mutex_lock(&pool->mutex);
+            pool->round++;
+            pool->running = pool->workers;
+            pthread_cond_broadcast(&pool->start);
+            pthread_mutex_unlock(&pool->mutex);
+        }
+#endif
+
+        any_hash_pool_work(pool);
+
+#ifndef ANY_HASH_NO_THREADS
+        if (pool->workers > 0) {
+            pthread_mutex_lock(&pool->mutex);
+            while (pool->running > 0)
+                pthread_cond_wait(&pool->done, &pool->mutex);
+            pthread_mutex_unlock(&pool->mutex);
+        }
+#endif
+
+        for (size_t i = 0; i < count && !ANY_HASH_LITTLE_ENDIAN; i++)
+            hashes[i] = ANY_HASH_SWAP64(hashes[i]);
+
+        any_hash_xxh64_update(&state, (const uint8_t *)hashes, count * sizeof(any_hash64_t));
+    }
+
+    return any_hash_xxh64_digest(&state);
+}
+
+#endif
+
+#if !defined(ANY_HASH_NO_XXH64) && !defined(ANY_HASH_NO_CHUNKER)
+
+// Content defined chunking
+
+// The masks select bits from the top of the fingerprint, which depend on
+// the last 64 bytes. Before avg bytes the mask has two more bits than
+// log2(avg) and after it two less (the normalized chunking of FastCDC),
+// which makes the sizes gather around avg.
+static uint64_t any_hash_chunker_mask(int bits)
+{
+    if (bits < 1)
+        bits = 1;
+    if (bits > 63)
+        bits = 63;
+    return (~0ull << (64 - bits));
+}
+
+bool any_hash_chunker_init(any_hash_chunker_t *chunker, size_t min, size_t avg, size_t max, any_hash64_t seed)
+{
+    if (min == 0 || min > avg || avg > max)
+        return false;
+
+    int bits = 0;
+    while (((size_t)2 << bits) <= avg)
+        bits++;
+
+    for (int i = 0; i < 256; i++)
+        chunker->gear[i] = any_hash_xxh64_u64((uint64_t)i, seed);
+
+    chunker->mask_small = any_hash_chunker_mask(bits + 2);
+    chunker->mask_large = any_hash_chunker_mask(bits - 2);
+    chunker->min = min;
+    chunker->avg = avg;
+    chunker->max = max;
+    chunker->fingerprint = 0;
+    chunker->offset = 0;
+    chunker->length = 0;
+    chunker->seed = seed;
+    any_hash_xxh64_reset(&chunker->state, seed);
+    return true;
+}
+
+static void any_hash_chunker_emit(any_hash_chunker_t *chunker, any_hash_chunk_callback_t callback, void *user)
+{
+    callback(user, chunker->offset, chunker->length, any_hash_xxh64_digest(&chunker->state));
+
+    chunker->offset += chunker->length;
+    chunker->length = 0;
+    chunker->fingerprint = 0;
+    any_hash_xxh64_reset(&chunker->state, chunker->seed);
+}
+
+// Scan gear fingerprints from data[i] to data[end] for one that matches
+// the mask. Two bytes are rolled per step, and both fingerprints are
+// computed from the previous one, which halves the dependency chain.
+static inline bool any_hash_chunker_roll(const uint64_t *gear, uint64_t mask, const uint8_t *data,
+                                         size_t *i, size_t end, uint64_t *fingerprint)
+{
+    uint64_t fp = *fingerprint;
+    size_t j = *i;
+
+    for (; j + 2 <= end; j += 2) {
+        const uint64_t first = gear[data[j]];
+        const uint64_t second = (first << 1) + gear[data[j + 1]];
+        if (!(((fp << 1) + first) & mask)) {
+            *fingerprint = (fp << 1) + first;
+            *i = j + 1;
+            return true;
+        }
+        fp = (fp << 2) + second;
+        if (!(fp & mask)) {
+            *fingerprint = fp;
+            *i = j + 2;
+            return true;
+        }
+    }
+
+    if (j < end) {
+        fp = (fp << 1) + gear[data[j++]];
+        if (!(fp & mask)) {
+            *fingerprint = fp;
+            *i = j;
+            return true;
+        }
+    }
+
+    *fingerprint = fp;
+    *i = j;
+    return false;
+}
+
+// Scan the data for the end of the current chunk, returning the number of
+// bytes that belong to it (all of them if the chunk doesn't end in the data)
+static size_t any_hash_chunker_scan(any_hash_chunker_t *chunker, const uint8_t *data, size_t length, bool *cut)
+{
+    size_t position = chunker->length, i = 0;
+
+    // The first min bytes can't end the chunk, so they are skipped
+    if (position < chunker->min) {
+        i = chunker->min - position < length ? chunker->min - position : length;
+        position += i;
+    }
+
+    if (position < chunker->avg) {
+        const size_t end = chunker->avg - position < length - i ? i + chunker->avg - position : length;
+        position += end - i;
+        if (any_hash_chunker_roll(chunker->gear, chunker->mask_small, data, &i, end, &chunker->fingerprint)) {
+            *cut = true;
+            return i;
+        }
     }
 
+    const size_t end = chunker->max - position < length - i ? i + chunker->max - position : length;
+    if (any_hash_chunker_roll(chunker->gear, chunker->mask_large, data, &i, end, &chunker->fingerprint)) {
+        *cut = true;
+        return i;
+    }
+
+    *cut = chunker->length + i == chunker->max;
+    return i;
+}
+
+void any_hash_chunker_update(any_hash_chunker_t *chunker, const uint8_t *data, size_t length,
+                             any_hash_chunk_callback_t callback, void *user)
+{
     while (length > 0) {
-        hash ^= (*data++) * ANY_HASH_PRIME64_5;
-        hash = ANY_HASH_ROTL64(hash, ANY_HASH_PROC64_3) * ANY_HASH_PRIME64_1;
-        --length;
+        bool cut;
+        const size_t size = any_hash_chunker_scan(chunker, data, length, &cut);
+
+        any_hash_xxh64_update(&chunker->state, data, size);
+        chunker->length += size;
+
+        if (cut)
+            any_hash_chunker_emit(chunker, callback, user);
+
+        data += size;
+        length -= size;
     }
+}
 
-    return any_hash_avalanche64(hash);
+void any_hash_chunker_final(any_hash_chunker_t *chunker, any_hash_chunk_callback_t callback, void *user)
+{
+    if (chunker->length > 0)
+        any_hash_chunker_emit(chunker, callback, user);
+
+    chunker->offset = 0;
+}
+
+#endif
+
+// The environment variable read by any_hash_init
+#ifndef ANY_HASH_KERNEL_ENV
+#define ANY_HASH_KERNEL_ENV "ANY_HASH_KERNEL"
+#endif
+
+static const char *any_hash_kernel_strings[ANY_HASH_KERNEL_ALL] = {
+    "scalar",
+    "sse2",
+    "avx2",
+    "avx512",
+};
+
+// ANY_HASH_KERNEL_ALL means that the library is not initialized yet
+static any_hash_kernel_t any_hash_current_kernel = ANY_HASH_KERNEL_ALL;
+
+const char *any_hash_kernel_to_string(any_hash_kernel_t kernel)
+{
+    return kernel >= ANY_HASH_KERNEL_SCALAR && kernel < ANY_HASH_KERNEL_ALL
+        ? any_hash_kernel_strings[kernel] : "";
+}
+
+static bool any_hash_kernel_supported(any_hash_kernel_t kernel)
+{
+    switch (kernel) {
+        case ANY_HASH_KERNEL_SCALAR:
+            return true;
+#ifdef ANY_HASH_HAS_SSE2
+        case ANY_HASH_KERNEL_SSE2:
+            return ANY_HASH_CPU_SUPPORTS("sse2");
+#endif
+#ifdef ANY_HASH_HAS_AVX2
+        case ANY_HASH_KERNEL_AVX2:
+            return ANY_HASH_CPU_SUPPORTS("avx2");
+#endif
+#ifdef ANY_HASH_HAS_AVX512
+        case ANY_HASH_KERNEL_AVX512:
+            return ANY_HASH_CPU_SUPPORTS("avx512f");
+#endif
+        default:
+            return false;
+    }
+}
+
+bool any_hash_set_kernel(any_hash_kernel_t kernel)
+{
+    if (!any_hash_kernel_supported(kernel))
+        return false;
+
+#ifndef ANY_HASH_NO_XXH3
+    switch (kernel) {
+#ifdef ANY_HASH_HAS_SSE2
+        case ANY_HASH_KERNEL_SSE2:
+            ANY_HASH_STORE(&any_hash_xxh3_long, &any_hash_xxh3_long_sse2);
+            break;
+#endif
+#ifdef ANY_HASH_HAS_AVX2
+        case ANY_HASH_KERNEL_AVX2:
+            ANY_HASH_STORE(&any_hash_xxh3_long, &any_hash_xxh3_long_avx2);
+            break;
+#endif
+#ifdef ANY_HASH_HAS_AVX512
+        case ANY_HASH_KERNEL_AVX512:
+            ANY_HASH_STORE(&any_hash_xxh3_long, &any_hash_xxh3_long_avx512);
+            break;
+#endif
+        default:
+            ANY_HASH_STORE(&any_hash_xxh3_long, &any_hash_xxh3_long_scalar);
+            break;
+    }
+#endif
+
+#ifndef ANY_HASH_NO_XXH32
+    any_hash_xxh32_group_t group32 = any_hash_xxh32_group_scalar;
+#ifdef ANY_HASH_HAS_AVX2
+    // There is no 16 lanes version, AVX-512 uses the AVX2 one
+    if (kernel >= ANY_HASH_KERNEL_AVX2)
+        group32 = any_hash_xxh32_group_avx2;
+#endif
+    ANY_HASH_STORE(&any_hash_xxh32_group, group32);
+#endif
+
+#ifndef ANY_HASH_NO_XXH64
+    any_hash_xxh64_group_t group64 = any_hash_xxh64_group_scalar;
+#ifdef ANY_HASH_HAS_AVX512
+    if (kernel == ANY_HASH_KERNEL_AVX512)
+        group64 = any_hash_xxh64_group_avx512;
+#endif
+    ANY_HASH_STORE(&any_hash_xxh64_group, group64);
+#endif
+
+    ANY_HASH_STORE(&any_hash_current_kernel, kernel);
+    return true;
 }
 
+any_hash_kernel_t any_hash_init(void)
+{
+#ifdef ANY_HASH_DISPATCH
+    __builtin_cpu_init();
+#endif
+
+#ifndef ANY_HASH_NO_KERNEL_ENV
+    const char *env = getenv(ANY_HASH_KERNEL_ENV);
+    if (env != NULL) {
+        for (int kernel = ANY_HASH_KERNEL_SCALAR; kernel < ANY_HASH_KERNEL_ALL; kernel++) {
+            if (strcmp(any_hash_kernel_strings[kernel], env) == 0 && any_hash_set_kernel((any_hash_kernel_t)kernel))
+                return (any_hash_kernel_t)kernel;
+        }
+    }
+#endif
+
+#ifdef ANY_HASH_FORCE_KERNEL
+    if (any_hash_set_kernel(ANY_HASH_FORCE_KERNEL))
+        return ANY_HASH_FORCE_KERNEL;
 #endif
 
+    int kernel = ANY_HASH_KERNEL_ALL - 1;
+    while (!any_hash_set_kernel((any_hash_kernel_t)kernel))
+        kernel--;
+
+    return (any_hash_kernel_t)kernel;
+}
+
+any_hash_kernel_t any_hash_kernel(void)
+{
+    const any_hash_kernel_t kernel = ANY_HASH_LOAD(&any_hash_current_kernel);
+    return kernel == ANY_HASH_KERNEL_ALL ? any_hash_init() : kernel;
+}
+
 #endif
 
 // MIT License
@@ -0,0 +1,459 @@
+// any_hll
+//
+// A single-file library that provides a HyperLogLog cardinality estimator,
+// in the style of HyperLogLog++, built on any_hash.
+//
+// To use this library you should choose a suitable file to put the
+// implementation and define ANY_HLL_IMPLEMENT. For example
+//
+//    #define ANY_HLL_IMPLEMENT
+//    #include "any_hll.h"
+//
+// The keys are hashed with any_hash, so its implementation must be included
+// in some file of the project as well (not necessarily the same).
+//
+// Additionally, you can customize the library behavior by defining certain
+// macros in the file where you put the implementation. You can see which are
+// supported by reading the code guarded by ANY_HLL_IMPLEMENT.
+//
+// This library is licensed under the terms of the MIT license.
+// A copy of the license is included at the end of this file.
+//
+
+// How does it work?
+//
+// Every key is hashed with any_hash_xxh64: the first p bits of the hash
+// select one of the 2^p registers, which keeps the maximum number of leading
+// zeros (plus one) seen in the rest of the hash. The standard error of the
+// estimate is about 1.04 / sqrt(2^p), for example
+//
+//    precision | registers | memory | error
+//        10    |    1024   |  1 KB  | 3.25%
+//        12    |    4096   |  4 KB  | 1.63%
+//        14    |   16384   | 16 KB  | 0.81%
+//
+// Like in HyperLogLog++, a sketch starts with a sparse encoding: a list of
+// the 25 bit indexes of the keys (and their register values), which is
+// precise for small cardinalities and takes less memory. The list is turned
+// in the dense registers when it would take more memory than them.
+//
+// The estimate of the dense registers uses the improved estimator of Ertl
+// ("New cardinality estimation algorithms for HyperLogLog sketches"), which
+// is unbiased for small cardinalities without the empirical bias tables of
+// HyperLogLog++.
+//
+
+#ifndef ANY_HLL_INCLUDE
+#define ANY_HLL_INCLUDE
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "any_hash.h"
+
+#define ANY_HLL_MIN_PRECISION 4
+#define ANY_HLL_MAX_PRECISION 18
+
+// The registers are one byte each and NULL while the sketch is sparse.
+// Sketches with the same precision and seed can be merged.
+//
+typedef struct {
+    uint8_t *registers;
+    uint32_t *sparse;
+    size_t sparse_count;
+    size_t sparse_sorted;
+    int precision;
+    uint64_t seed;
+} any_hll_t;
+
+// Initialize an empty sketch with 2^precision registers. This function
+// returns false if the precision is not valid or the allocation fails.
+//
+bool any_hll_init(any_hll_t *hll, int precision, uint64_t seed);
+
+void any_hll_free(any_hll_t *hll);
+
+// Add a key. This function returns false only if the sketch had to be
+// turned dense and the allocation failed (the key is not added).
+//
+bool any_hll_add(any_hll_t *hll, const uint8_t *key, size_t length);
+
+// Add a key by its hash, which must be any_hash_xxh64 of the key with the
+// seed of the sketch (or any_hash_xxh64_u64 for integer keys).
+//
+bool any_hll_add_hash(any_hll_t *hll, uint64_t hash);
+
+// Estimate the number of distinct keys added to the sketch.
+//
+// NOTE: The sparse list is compacted, so the sketch is modified
+//
+double any_hll_count(any_hll_t *hll);
+
+// Merge other in hll, so that hll estimates the union of the keys of both.
+// This function returns false if the sketches have a different precision
+// or seed, or the allocation fails.
+//
+bool any_hll_merge(any_hll_t *hll, const any_hll_t *other);
+
+#endif
+
+#ifdef ANY_HLL_IMPLEMENT
+
+#include <string.h>
+#include <math.h>
+
+// The sketches are allocated with ANY_HLL_MALLOC and freed with ANY_HLL_FREE.
+// You can change allocation strategy by defining these macros in the
+// implementation file like so
+//
+//    #define ANY_HLL_IMPLEMENT
+//    #define ANY_HLL_MALLOC my_malloc
+//    #define ANY_HLL_FREE my_free
+//    #include "any_hll.h"
+//
+#ifndef ANY_HLL_MALLOC
+#include <stdlib.h>
+#define ANY_HLL_MALLOC malloc
+#define ANY_HLL_FREE free
+#endif
+
+// You can define ANY_HLL_NO_SSE2 to use the portable loops even if SSE2
+// is available.
+//
+#if !defined(ANY_HLL_NO_SSE2) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define ANY_HLL_SSE2
+#include <emmintrin.h>
+#endif
+
+// The sparse entries are the first 25 bits of the hash and the register
+// value for the precision of the sketch, in the lowest 6 bits
+#define ANY_HLL_SPARSE_PRECISION 25
+#define ANY_HLL_SPARSE_INDEX(entry) ((entry) >> 6)
+#define ANY_HLL_SPARSE_VALUE(entry) ((uint8_t)((entry) & 0x3f))
+
+#define ANY_HLL_REGISTERS(hll) ((size_t)1 << (hll)->precision)
+
+// The sparse list takes at most as much memory as the registers
+#define ANY_HLL_SPARSE_CAPACITY(hll) (ANY_HLL_REGISTERS(hll) / 4)
+
+#ifdef __GNUC__
+#define ANY_HLL_CLZ64(value) __builtin_clzll(value)
+#define ANY_HLL_POPCOUNT(value) __builtin_popcount(value)
+#else
+#define ANY_HLL_CLZ64(value) any_hll_clz64(value)
+#define ANY_HLL_POPCOUNT(value) any_hll_popcount(value)
+
+static inline int any_hll_clz64(uint64_t value)
+{
+    int bits = 0;
+    while (!(value & 0x8000000000000000ull)) {
+        value <<= 1;
+        bits++;
+    }
+    return bits;
+}
+
+static inline int any_hll_popcount(uint32_t value)
+{
+    int bits = 0;
+    for (; value != 0; value &= value - 1)
+        bits++;
+    return bits;
+}
+#endif
+
+// The number of leading zeros after the first precision bits, plus one
+static inline uint8_t any_hll_value(uint64_t hash, int precision)
+{
+    const uint64_t rest = hash << precision;
+    return rest == 0 ? (uint8_t)(64 - precision + 1) : (uint8_t)(ANY_HLL_CLZ64(rest) + 1);
+}
+
+static int any_hll_compare(const void *a, const void *b)
+{
+    const uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Sort the sparse list and keep only the highest value of every index
+// (which is the last one, since the value is in the lowest bits)
+static void any_hll_compact(any_hll_t *hll)
+{
+    if (hll->sparse_sorted == hll->sparse_count)
+        return;
+
+    qsort(hll->sparse, hll->sparse_count, sizeof(uint32_t), any_hll_compare);
+
+    size_t count = 0;
+    for (size_t i = 0; i < hll->sparse_count; i++) {
+        const uint32_t entry = hll->sparse[i];
+        if (count > 0 && ANY_HLL_SPARSE_INDEX(hll->sparse[count - 1]) == ANY_HLL_SPARSE_INDEX(entry))
+            hll->sparse[count - 1] = entry;
+        else
+            hll->sparse[count++] = entry;
+    }
+
+    hll->sparse_count = count;
+    hll->sparse_sorted = count;
+}
+
+static bool any_hll_densify(any_hll_t *hll)
+{
+    uint8_t *registers = (uint8_t *)ANY_HLL_MALLOC(ANY_HLL_REGISTERS(hll));
+    if (registers == NULL)
+        return false;
+
+    memset(registers, 0, ANY_HLL_REGISTERS(hll));
+
+    const int shift = ANY_HLL_SPARSE_PRECISION - hll->precision;
+    for (size_t i = 0; i < hll->sparse_count; i++) {
+        const uint32_t index = ANY_HLL_SPARSE_INDEX(hll->sparse[i]) >> shift;
+        const uint8_t value = ANY_HLL_SPARSE_VALUE(hll->sparse[i]);
+        if (registers[index] < value)
+            registers[index] = value;
+    }
+
+    ANY_HLL_FREE(hll->sparse);
+    hll->sparse = NULL;
+    hll->sparse_count = 0;
+    hll->sparse_sorted = 0;
+    hll->registers = registers;
+    return true;
+}
+
+// Add a sparse entry to the registers or to the sparse list, compacting the
+// list when it is full and turning it dense when the compaction doesn't
+// free at least half of it
+static bool any_hll_add_entry(any_hll_t *hll, uint32_t entry)
+{
+    if (hll->registers == NULL && hll->sparse_count == ANY_HLL_SPARSE_CAPACITY(hll)) {
+        any_hll_compact(hll);
+
+        if (hll->sparse_count > ANY_HLL_SPARSE_CAPACITY(hll) / 2 && !any_hll_densify(hll))
+            return false;
+    }
+
+    if (hll->registers != NULL) {
+        const size_t index = ANY_HLL_SPARSE_INDEX(entry) >> (ANY_HLL_SPARSE_PRECISION - hll->precision);
+        if (hll->registers[index] < ANY_HLL_SPARSE_VALUE(entry))
+            hll->registers[index] = ANY_HLL_SPARSE_VALUE(entry);
+        return true;
+    }
+
+    hll->sparse[hll->sparse_count++] = entry;
+    return true;
+}
+
+bool any_hll_init(any_hll_t *hll, int precision, uint64_t seed)
+{
+    if (precision < ANY_HLL_MIN_PRECISION || precision > ANY_HLL_MAX_PRECISION)
+        return false;
+
+    hll->precision = precision;
+    hll->seed = seed;
+    hll->registers = NULL;
+    hll->sparse_count = 0;
+    hll->sparse_sorted = 0;
+    hll->sparse = (uint32_t *)ANY_HLL_MALLOC(ANY_HLL_SPARSE_CAPACITY(hll) * sizeof(uint32_t));
+    return hll->sparse != NULL;
+}
+
+void any_hll_free(any_hll_t *hll)
+{
+    ANY_HLL_FREE(hll->registers);
+    ANY_HLL_FREE(hll->sparse);
+    hll->registers = NULL;
+    hll->sparse = NULL;
+    hll->sparse_count = 0;
+    hll->sparse_sorted = 0;
+}
+
+bool any_hll_add_hash(any_hll_t *hll, uint64_t hash)
+{
+    const uint8_t value = any_hll_value(hash, hll->precision);
+
+    if (hll->registers != NULL) {
+        const size_t index = hash >> (64 - hll->precision);
+        if (hll->registers[index] < value)
+            hll->registers[index] = value;
+        return true;
+    }
+
+    const uint32_t index = (uint32_t)(hash >> (64 - ANY_HLL_SPARSE_PRECISION));
+    return any_hll_add_entry(hll, index << 6 | value);
+}
+
+bool any_hll_add(any_hll_t *hll, const uint8_t *key, size_t length)
+{
+    return any_hll_add_hash(hll, any_hash_xxh64(key, length, hll->seed));
+}
+
+// The sum of 2^-register over all the registers (the denominator of the
+// harmonic mean) and the number of registers equal to zero
+#ifdef ANY_HLL_SSE2
+
+// The powers of two are built as floats, putting 127 - register in the
+// exponent. The float sums are flushed every 256 registers, so that they
+// never lose precision (the largest term is 1).
+static double any_hll_sum(const uint8_t *registers, size_t count, size_t *zeros)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_set1_epi32(127);
+    double sum = 0;
+    size_t empty = 0;
+
+    for (size_t start = 0; start < count; start += 256) {
+        const size_t end = count - start < 256 ? count : start + 256;
+        __m128 acc1 = _mm_setzero_ps(), acc2 = _mm_setzero_ps();
+        __m128 acc3 = _mm_setzero_ps(), acc4 = _mm_setzero_ps();
+
+        for (size_t i = start; i < end; i += 16) {
+            const __m128i bytes = _mm_loadu_si128((const __m128i *)(registers + i));
+            empty += ANY_HLL_POPCOUNT((uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, zero)));
+
+            const __m128i low = _mm_unpacklo_epi8(bytes, zero);
+            const __m128i high = _mm_unpackhi_epi8(bytes, zero);
+
+            const __m128i r1 = _mm_unpacklo_epi16(low, zero);
+            const __m128i r2 = _mm_unpackhi_epi16(low, zero);
+            const __m128i r3 = _mm_unpacklo_epi16(high, zero);
+            const __m128i r4 = _mm_unpackhi_epi16(high, zero);
+
+            acc1 = _mm_add_ps(acc1, _mm_castsi128_ps(_mm_slli_epi32(_mm_sub_epi32(bias, r1), 23)));
+            acc2 = _mm_add_ps(acc2, _mm_castsi128_ps(_mm_slli_epi32(_mm_sub_epi32(bias, r2), 23)));
+            acc3 = _mm_add_ps(acc3, _mm_castsi128_ps(_mm_slli_epi32(_mm_sub_epi32(bias, r3), 23)));
+            acc4 = _mm_add_ps(acc4, _mm_castsi128_ps(_mm_slli_epi32(_mm_sub_epi32(bias, r4), 23)));
+        }
+
+        float lanes[4];
+        _mm_storeu_ps(lanes, _mm_add_ps(_mm_add_ps(acc1, acc2), _mm_add_ps(acc3, acc4)));
+        sum += (double)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+
+    *zeros = empty;
+    return sum;
+}
+
+#else
+
+static double any_hll_sum(const uint8_t *registers, size_t count, size_t *zeros)
+{
+    double sum = 0;
+    size_t empty = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        sum += ldexp(1.0, -registers[i]);
+        empty += registers[i] == 0;
+    }
+
+    *zeros = empty;
+    return sum;
+}
+
+#endif
+
+// sigma(x) = x + sum(x^(2^k) 2^(k - 1)) for k >= 1, see Ertl
+static double any_hll_sigma(double x)
+{
+    double y = 1, z = x, previous;
+    do {
+        x *= x;
+        previous = z;
+        z += x * y;
+        y += y;
+    } while (z != previous);
+    return z;
+}
+
+double any_hll_count(any_hll_t *hll)
+{
+    if (hll->registers == NULL) {
+        // Linear counting over the 2^25 sparse indexes
+        any_hll_compact(hll);
+        const double buckets = (double)((uint32_t)1 << ANY_HLL_SPARSE_PRECISION);
+        return buckets * log(buckets / (buckets - (double)hll->sparse_count));
+    }
+
+    const size_t registers = ANY_HLL_REGISTERS(hll);
+    size_t zeros;
+    const double sum = any_hll_sum(hll->registers, registers, &zeros);
+    if (zeros == registers)
+        return 0;
+
+    // The registers equal to zero are counted through sigma instead of
+    // their 2^0 term. The term of the saturated registers (tau) is left
+    // out, since they need 2^(64 - precision) keys.
+    const double m = (double)registers;
+    const double alpha = 0.7213475204444817;
+    return alpha * m * m / (m * any_hll_sigma((double)zeros / m) + sum - (double)zeros);
+}
+
+#ifdef ANY_HLL_SSE2
+
+static void any_hll_max(uint8_t *registers, const uint8_t *other, size_t count)
+{
+    for (size_t i = 0; i < count; i += 16) {
+        const __m128i a = _mm_loadu_si128((const __m128i *)(registers + i));
+        const __m128i b = _mm_loadu_si128((const __m128i *)(other + i));
+        _mm_storeu_si128((__m128i *)(registers + i), _mm_max_epu8(a, b));
+    }
+}
+
+#else
+
+static void any_hll_max(uint8_t *registers, const uint8_t *other, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (registers[i] < other[i])
+            registers[i] = other[i];
+    }
+}
+
+#endif
+
+bool any_hll_merge(any_hll_t *hll, const any_hll_t *other)
+{
+    if (hll->precision != other->precision || hll->seed != other->seed)
+        return false;
+
+    if (other->registers != NULL) {
+        if (hll->registers == NULL && !any_hll_densify(hll))
+            return false;
+
+        any_hll_max(hll->registers, other->registers, ANY_HLL_REGISTERS(hll));
+        return true;
+    }
+
+    for (size_t i = 0; i < other->sparse_count; i++) {
+        if (!any_hll_add_entry(hll, other->sparse[i]))
+            return false;
+    }
+
+    return true;
+}
+
+#endif
+
+// MIT License
+//
+// Copyright (c) 2024 Federico Angelilli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
@@ -20,7 +20,19 @@
 #ifndef ANY_LOG_INCLUDE
 #define ANY_LOG_INCLUDE
 
+// The asynchronous mode needs POSIX 2008, which the strict C modes (like
+// -std=c11) hide unless it is requested. This works only if the header is
+// included before the system ones, otherwise define _POSIX_C_SOURCE to
+// 200809L yourself.
+#if defined(__STRICT_ANSI__) && (defined(__unix__) || defined(__APPLE__)) && !defined(ANY_LOG_NO_ASYNC) && \
+    !defined(_POSIX_C_SOURCE) && !defined(_XOPEN_SOURCE) && !defined(_GNU_SOURCE) && !defined(_DEFAULT_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
 
 // These values represent the decreasing urgency of a log invocation.
 //
@@ -97,22 +109,132 @@ typedef enum {
 // respectively. As this will work only if they are defined before every header
 // include, it is recommended to define this from the compiler.
 //
-#define log_error(...) any_log_format(ANY_LOG_ERROR, ANY_LOG_MODULE, ANY_LOG_FUNC, __VA_ARGS__)
-#define log_warn(...)  any_log_format(ANY_LOG_WARN, ANY_LOG_MODULE, ANY_LOG_FUNC, __VA_ARGS__)
-#define log_info(...)  any_log_format(ANY_LOG_INFO, ANY_LOG_MODULE, ANY_LOG_FUNC, __VA_ARGS__)
+// Every call site of log_[level] has its own static any_log_site_t, which
+// the binary mode uses to write the format string only once (see
+// any_log_init_binary) and the text mode to keep the prefix of the records
+// already formatted. A custom ANY_LOG_FORMAT_BEFORE can change from record to
+// record (like a counter or a timestamp), so it is formatted every time.
+//
+// With GCC or Clang on ELF targets the call sites are also registered in
+// the any_log_registry section, so that they can be listed and enabled or
+// disabled one by one at runtime (see any_log_sites_set). In this case
+// ANY_LOG_MODULE and ANY_LOG_FUNC must be constant, and the registry can be
+// removed by defining ANY_LOG_NO_REGISTRY.
+//
+// NOTE: The registry is not available in C++, where the sites of the inline
+//       functions and of the templates can't share the section with the
+//       other ones
+//
+// NOTE: With GCC and Clang the log macros are void expressions, like the
+//       call to any_log_format they were before the call sites. With the
+//       other compilers they are statements, so they can't be used in an
+//       expression (like (log_info("x"), 1))
+//
+#define log_error(...) ANY_LOG_SITE(ANY_LOG_ERROR, __VA_ARGS__)
+#define log_warn(...)  ANY_LOG_SITE(ANY_LOG_WARN, __VA_ARGS__)
+#define log_info(...)  ANY_LOG_SITE(ANY_LOG_INFO, __VA_ARGS__)
 
 #ifdef ANY_LOG_NO_DEBUG
 #define log_debug(...)
 #else
-#define log_debug(...) any_log_format(ANY_LOG_DEBUG, ANY_LOG_MODULE, ANY_LOG_FUNC, __VA_ARGS__)
+#define log_debug(...) ANY_LOG_SITE(ANY_LOG_DEBUG, __VA_ARGS__)
 #endif
 
 #ifdef ANY_LOG_NO_TRACE
 #define log_trace(...)
 #else
-#define log_trace(...) any_log_format(ANY_LOG_TRACE, ANY_LOG_MODULE, ANY_LOG_FUNC, __VA_ARGS__)
+#define log_trace(...) ANY_LOG_SITE(ANY_LOG_TRACE, __VA_ARGS__)
+#endif
+
+#if !defined(ANY_LOG_NO_REGISTRY) && (!(defined(__GNUC__) && defined(__ELF__)) || defined(__cplusplus))
+#define ANY_LOG_NO_REGISTRY
+#endif
+
+// The block of a call site, a statement expression where available
+#ifdef __GNUC__
+#define ANY_LOG_SITE_BLOCK(...) __extension__ ({ __VA_ARGS__ (void)0; })
+#else
+#define ANY_LOG_SITE_BLOCK(...) do { __VA_ARGS__ } while (0)
+#endif
+
+#ifdef ANY_LOG_NO_REGISTRY
+
+#define ANY_LOG_SITE(level, ...) \
+    ANY_LOG_SITE_BLOCK( \
+        static any_log_site_t any_log_site; \
+        if (any_log_site_enabled(&any_log_site, level, ANY_LOG_MODULE)) \
+            any_log_format_site(&any_log_site, level, ANY_LOG_MODULE, ANY_LOG_FUNC, __VA_ARGS__); \
+    )
+
+#else
+
+// The descriptors are aligned exactly to their type, so that the section
+// is an array of them
+#define ANY_LOG_SITE(level, ...) \
+    ANY_LOG_SITE_BLOCK( \
+        static any_log_site_t any_log_site; \
+        static const any_log_site_info_t any_log_site_info \
+            __attribute__((section("any_log_registry"), used, aligned(__alignof__(any_log_site_info_t)))) = \
+            { &any_log_site, __FILE__, ANY_LOG_MODULE, ANY_LOG_FUNC, __LINE__, level }; \
+        if (any_log_site_enabled(&any_log_site, level, ANY_LOG_MODULE)) \
+            any_log_format_site(&any_log_site, level, ANY_LOG_MODULE, ANY_LOG_FUNC, __VA_ARGS__); \
+    )
+
+#endif
+
+// The maximum number of arguments of a call site in the binary mode, the
+// sites with more are logged as text
+#ifndef ANY_LOG_SITE_ARGS
+#define ANY_LOG_SITE_ARGS 16
+#endif
+
+// The maximum length of the prefix kept by a call site, the longer prefixes
+// are formatted at every call
+#ifndef ANY_LOG_SITE_PREFIX_SIZE
+#define ANY_LOG_SITE_PREFIX_SIZE 128
 #endif
 
+// The state of a call site, which should be zero initialized.
+//
+// The level of the module of the site (see any_log_set_levels) is kept
+// until the levels change. The prefix is formatted again when
+// any_log_colors points to another table, so to change the colors assign a
+// different table instead of changing the strings of the current one.
+//
+typedef struct {
+    uint8_t state;
+    uint32_t generation;
+    uint8_t level;
+
+    uint32_t id;
+    uint32_t epoch;
+    uint8_t count;
+    uint8_t types[ANY_LOG_SITE_ARGS];
+
+    const char **colors;
+    uint32_t version;
+    uint16_t prefix_length;
+    char prefix[ANY_LOG_SITE_PREFIX_SIZE];
+} any_log_site_t;
+
+// The values of any_log_site_t.state, by default a call site is filtered
+// by the level of its module
+typedef enum {
+    ANY_LOG_SITE_DEFAULT,
+    ANY_LOG_SITE_ENABLED,
+    ANY_LOG_SITE_DISABLED,
+} any_log_site_state_t;
+
+// The registered description of a call site (see any_log_sites)
+typedef struct {
+    any_log_site_t *site;
+    const char *file;
+    const char *module;
+    const char *func;
+    int line;
+    any_log_level_t level;
+} any_log_site_info_t;
+
 // log_value_[level] provide structured logging.
 //
 // The logs will be filtered according to the global log level. See any_log_level.
@@ -176,6 +298,8 @@ typedef enum {
 //    #define ANY_LOG_VALUE_INT(key, value) "\"%s\": %d", key, value
 //    #define ANY_LOG_VALUE_HEX(key, value) "\"%s\": %u", key, value
 //    #define ANY_LOG_VALUE_LONG(key, value) "\"%s\": %ld", key, value
+//    #define ANY_LOG_VALUE_LLONG(key, value) "\"%s\": %lld", key, value
+//    #define ANY_LOG_VALUE_ULLONG(key, value) "\"%s\": %llu", key, value
 //    #define ANY_LOG_VALUE_PTR(key, value) "\"%s\": \"%p\"", key, value
 //    #define ANY_LOG_VALUE_DOUBLE(key, value) "\"%s\": %lf", key, value
 //    #define ANY_LOG_VALUE_STRING(key, value) "\"%s \": \"%s\"", key, value
@@ -217,6 +341,226 @@ typedef void (*any_log_formatter_t)(FILE *stream, ANY_LOG_VALUE_GENERIC_TYPE val
 
 #endif
 
+// log_pairs_[level] provide structured logging with typed pairs, instead of
+// the type specifiers of log_value_[level].
+//
+// Every pair is made with ANY_LOG_PAIR(key, value), which picks the format
+// from the type of the value at compile time (it needs C11). The pairs are
+// passed in an array, so a value of an unsupported type is a compile error
+// instead of garbage. For example
+//
+//    log_pairs_info("Created graphical context",
+//                   ANY_LOG_PAIR("width", width),
+//                   ANY_LOG_PAIR("window", window_handle),
+//                   ANY_LOG_PAIR("scale", scale_factor_dpi),
+//                   ANY_LOG_PAIR_BOOL("hidden", visibility == HIDDEN),
+//                   ANY_LOG_PAIR_GENERIC("widgets", widget_format, widgets),
+//                   ANY_LOG_PAIR("appname", "nice app"));
+//
+// The output is the same of log_value_[level], with these formats
+//
+//           type              | format
+//                             |
+// bool                        | ANY_LOG_VALUE_BOOL
+// char, short, int            | ANY_LOG_VALUE_INT
+// unsigned char, short, int   | ANY_LOG_VALUE_HEX
+// long                        | ANY_LOG_VALUE_LONG
+// long long                   | ANY_LOG_VALUE_LLONG
+// unsigned long, long long    | ANY_LOG_VALUE_ULLONG
+// float, double               | ANY_LOG_VALUE_DOUBLE
+// char * (0-terminated)       | ANY_LOG_VALUE_STRING
+// void *                      | ANY_LOG_VALUE_PTR
+//
+// The formats LLONG and ULLONG (by default "%lld" and "%#llx") are used
+// only by the pairs.
+//
+// NOTE: In C true, false and the comparisons are int, so use
+//       ANY_LOG_PAIR_BOOL for them. The other pointers must be cast to
+//       void *
+//
+typedef enum {
+    ANY_LOG_PAIR_TYPE_BOOL,
+    ANY_LOG_PAIR_TYPE_INT,
+    ANY_LOG_PAIR_TYPE_HEX,
+    ANY_LOG_PAIR_TYPE_LONG,
+    ANY_LOG_PAIR_TYPE_LLONG,
+    ANY_LOG_PAIR_TYPE_ULLONG,
+    ANY_LOG_PAIR_TYPE_PTR,
+    ANY_LOG_PAIR_TYPE_DOUBLE,
+    ANY_LOG_PAIR_TYPE_STRING,
+    ANY_LOG_PAIR_TYPE_GENERIC,
+} any_log_pair_type_t;
+
+typedef struct {
+    const char *key;
+    any_log_pair_type_t type;
+    union {
+        int i;
+        unsigned int u;
+        long l;
+        long long ll;
+        unsigned long long ull;
+        const void *p;
+        double f;
+        const char *s;
+#ifndef ANY_LOG_NO_GENERIC
+        struct {
+            any_log_formatter_t formatter;
+            ANY_LOG_VALUE_GENERIC_TYPE value;
+        } g;
+#endif
+    } value;
+} any_log_pair_t;
+
+static inline any_log_pair_t any_log_pair_bool(const char *key, bool value)
+{
+    any_log_pair_t pair;
+    pair.key = key;
+    pair.type = ANY_LOG_PAIR_TYPE_BOOL;
+    pair.value.i = value;
+    return pair;
+}
+
+static inline any_log_pair_t any_log_pair_int(const char *key, int value)
+{
+    any_log_pair_t pair;
+    pair.key = key;
+    pair.type = ANY_LOG_PAIR_TYPE_INT;
+    pair.value.i = value;
+    return pair;
+}
+
+static inline any_log_pair_t any_log_pair_hex(const char *key, unsigned int value)
+{
+    any_log_pair_t pair;
+    pair.key = key;
+    pair.type = ANY_LOG_PAIR_TYPE_HEX;
+    pair.value.u = value;
+    return pair;
+}
+
+static inline any_log_pair_t any_log_pair_long(const char *key, long value)
+{
+    any_log_pair_t pair;
+    pair.key = key;
+    pair.type = ANY_LOG_PAIR_TYPE_LONG;
+    pair.value.l = value;
+    return pair;
+}
+
+static inline any_log_pair_t any_log_pair_llong(const char *key, long long value)
+{
+    any_log_pair_t pair;
+    pair.key = key;
+    pair.type = ANY_LOG_PAIR_TYPE_LLONG;
+    pair.value.ll = value;
+    return pair;
+}
+
+static inline any_log_pair_t any_log_pair_ullong(const char *key, unsigned long long value)
+{
+    any_log_pair_t pair;
+    pair.key = key;
+    pair.type = ANY_LOG_PAIR_TYPE_ULLONG;
+    pair.value.ull = value;
+    return pair;
+}
+
+static inline any_log_pair_t any_log_pair_ptr(const char *key, const void *value)
+{
+    any_log_pair_t pair;
+    pair.key = key;
+    pair.type = ANY_LOG_PAIR_TYPE_PTR;
+    pair.value.p = value;
+    return pair;
+}
+
+static inline any_log_pair_t any_log_pair_double(const char *key, double value)
+{
+    any_log_pair_t pair;
+    pair.key = key;
+    pair.type = ANY_LOG_PAIR_TYPE_DOUBLE;
+    pair.value.f = value;
+    return pair;
+}
+
+static inline any_log_pair_t any_log_pair_string(const char *key, const char *value)
+{
+    any_log_pair_t pair;
+    pair.key = key;
+    pair.type = ANY_LOG_PAIR_TYPE_STRING;
+    pair.value.s = value;
+    return pair;
+}
+
+#ifndef ANY_LOG_NO_GENERIC
+
+static inline any_log_pair_t any_log_pair_generic(const char *key, any_log_formatter_t formatter,
+                                                  ANY_LOG_VALUE_GENERIC_TYPE value)
+{
+    any_log_pair_t pair;
+    pair.key = key;
+    pair.type = ANY_LOG_PAIR_TYPE_GENERIC;
+    pair.value.g.formatter = formatter;
+    pair.value.g.value = value;
+    return pair;
+}
+
+#define ANY_LOG_PAIR_GENERIC(key, formatter, value) \
+    any_log_pair_generic(key, ANY_LOG_FORMATTER(formatter), value)
+
+#endif
+
+#define ANY_LOG_PAIR_BOOL(key, value) any_log_pair_bool(key, value)
+
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+
+#define ANY_LOG_PAIR(key, value) \
+    _Generic((value), \
+        bool: any_log_pair_bool, \
+        char: any_log_pair_int, \
+        signed char: any_log_pair_int, \
+        short: any_log_pair_int, \
+        int: any_log_pair_int, \
+        unsigned char: any_log_pair_hex, \
+        unsigned short: any_log_pair_hex, \
+        unsigned int: any_log_pair_hex, \
+        long: any_log_pair_long, \
+        long long: any_log_pair_llong, \
+        unsigned long: any_log_pair_ullong, \
+        unsigned long long: any_log_pair_ullong, \
+        float: any_log_pair_double, \
+        double: any_log_pair_double, \
+        char *: any_log_pair_string, \
+        const char *: any_log_pair_string, \
+        void *: any_log_pair_ptr, \
+        const void *: any_log_pair_ptr)(key, value)
+
+#endif
+
+#define ANY_LOG_PAIRS(level, message, ...) \
+    do { \
+        const any_log_pair_t any_log_list[] = { __VA_ARGS__ }; \
+        any_log_pairs(level, ANY_LOG_MODULE, ANY_LOG_FUNC, message, any_log_list, \
+                      sizeof(any_log_list) / sizeof(any_log_pair_t)); \
+    } while (0)
+
+#define log_pairs_error(...) ANY_LOG_PAIRS(ANY_LOG_ERROR, __VA_ARGS__)
+#define log_pairs_warn(...)  ANY_LOG_PAIRS(ANY_LOG_WARN, __VA_ARGS__)
+#define log_pairs_info(...)  ANY_LOG_PAIRS(ANY_LOG_INFO, __VA_ARGS__)
+
+#ifdef ANY_LOG_NO_DEBUG
+#define log_pairs_debug(...)
+#else
+#define log_pairs_debug(...) ANY_LOG_PAIRS(ANY_LOG_DEBUG, __VA_ARGS__)
+#endif
+
+#ifdef ANY_LOG_NO_TRACE
+#define log_pairs_trace(...)
+#else
+#define log_pairs_trace(...) ANY_LOG_PAIRS(ANY_LOG_TRACE, __VA_ARGS__)
+#endif
+
 #ifdef __GNUC__
 #define ANY_LOG_ATTRIBUTE(...) __attribute__((__VA_ARGS__))
 #else
@@ -247,6 +591,201 @@ extern any_log_level_t any_log_level;
 //
 void any_log_init(FILE *stream, any_log_level_t level);
 
+// Set the levels of some modules (the values of ANY_LOG_MODULE) from a
+// string, where each module name is followed by its level and '*' stands
+// for all the other modules (it sets any_log_level). For example
+//
+//    any_log_set_levels("net=trace,db=warn,*=info");
+//
+// The modules are matched exactly and keep their level until the next
+// call, which replaces all of them (an empty string removes them). This
+// function returns false, without changing the levels, if the string is
+// malformed or has a level that is not in any_log_level_strings.
+//
+bool any_log_set_levels(const char *spec);
+
+// Return the level of a module, which is any_log_level if the module has
+// not been given one.
+//
+any_log_level_t any_log_module_level(const char *module);
+
+// Return the call sites registered by the program (or by the shared
+// library that contains the implementation) and store their number in
+// count. The state of a site can be read from its any_log_site_t.
+//
+// NOTE: Without the registry (see ANY_LOG_NO_REGISTRY) there are no sites
+//
+const any_log_site_info_t *any_log_sites(size_t *count);
+
+// Set the state of the call sites that match a pattern and return their
+// number. The pattern is matched against the module, the function, the
+// file and the file followed by ':' and the line of every site, and it can
+// contain the wildcards '*' (any string) and '?' (any character). For
+// example
+//
+//    any_log_sites_set("net", ANY_LOG_SITE_DISABLED);
+//    any_log_sites_set("*parser.c:42", ANY_LOG_SITE_ENABLED);
+//    any_log_sites_set("*", ANY_LOG_SITE_DEFAULT);
+//
+// An enabled site logs at every level, so log_trace and log_debug can be
+// left in a program and turned on when needed. A disabled site does not
+// log and does not evaluate its arguments.
+//
+size_t any_log_sites_set(const char *pattern, any_log_site_state_t state);
+
+// Incremented at every change of the module levels, the call sites keep
+// the level of their module until it changes.
+//
+extern uint32_t any_log_generation;
+
+// NOTE: You should never call the functions below directly!
+//       They are used by the log_[level] macros.
+
+void any_log_site_update(any_log_site_t *site, const char *module);
+
+// The value of any_log_site_t.level for the modules that use any_log_level
+#define ANY_LOG_SITE_LEVEL_GLOBAL 0xFF
+
+#ifdef __GNUC__
+#define ANY_LOG_LOAD_ACQUIRE(pointer) __atomic_load_n(pointer, __ATOMIC_ACQUIRE)
+#define ANY_LOG_LOAD_RELAXED(pointer) __atomic_load_n(pointer, __ATOMIC_RELAXED)
+#else
+#define ANY_LOG_LOAD_ACQUIRE(pointer) (*(pointer))
+#define ANY_LOG_LOAD_RELAXED(pointer) (*(pointer))
+#endif
+
+// Return true if a call site logs the records of the given level. The
+// filtered calls load the state and the generation of the site, the global
+// generation and the level of the site (and any_log_level for the modules
+// without a level), and compare them. The disabled sites only load their
+// state
+static inline bool any_log_site_enabled(any_log_site_t *site, any_log_level_t level, const char *module)
+{
+    const uint8_t state = ANY_LOG_LOAD_RELAXED(&site->state);
+    if (state != ANY_LOG_SITE_DEFAULT)
+        return state == ANY_LOG_SITE_ENABLED;
+
+    if (ANY_LOG_LOAD_ACQUIRE(&site->generation) != ANY_LOG_LOAD_RELAXED(&any_log_generation))
+        any_log_site_update(site, module);
+
+    const unsigned threshold = ANY_LOG_LOAD_RELAXED(&site->level);
+    return (unsigned)level <= (threshold == ANY_LOG_SITE_LEVEL_GLOBAL
+                               ? (unsigned)ANY_LOG_LOAD_RELAXED(&any_log_level) : threshold);
+}
+
+// The asynchronous mode and the per-thread buffers where every record is
+// formatted before being written need POSIX 2008 (threads and open_memstream), as
+// reported by _POSIX_VERSION, and the atomic builtins of GCC and Clang. You
+// can disable them by defining ANY_LOG_NO_ASYNC.
+//
+#if defined(__unix__) && !defined(ANY_LOG_NO_ASYNC)
+#include <unistd.h>
+#endif
+
+#if !defined(__GNUC__) || !defined(__APPLE__) && \
+    !(defined(__unix__) && defined(_POSIX_VERSION) && _POSIX_VERSION >= 200809L)
+#ifndef ANY_LOG_NO_ASYNC
+#define ANY_LOG_NO_ASYNC
+#endif
+#endif
+
+#ifndef ANY_LOG_NO_ASYNC
+
+// These values represent what a log call does when the queue of the
+// asynchronous mode is full.
+//
+// block: wait for the writer thread to make space
+//
+// drop: discard the record
+//
+// count: discard the record and write how many were discarded to the log,
+//        as soon as there is space again
+//
+typedef enum {
+    ANY_LOG_BLOCK,
+    ANY_LOG_DROP,
+    ANY_LOG_COUNT,
+} any_log_overflow_t;
+
+// Start the asynchronous mode. After this call the log functions format
+// each record in a buffer of the calling thread (of ANY_LOG_RECORD_SIZE
+// bytes, only in this mode longer records are truncated) and queue it in a
+// lock-free ring of capacity bytes, without taking locks or doing I/O. A
+// writer thread takes the records from the ring and writes them to the file
+// descriptor of any_log_stream, many at a time. For example
+//
+//    any_log_init(stderr, ANY_LOG_INFO);
+//    any_log_async_start(1 << 20, ANY_LOG_DROP);
+//
+//    ...
+//
+//    any_log_async_stop();
+//
+// This function returns false if the mode is already started, if
+// any_log_stream has no file descriptor or if the thread can't be created.
+//
+// NOTE: The writer bypasses the buffer of any_log_stream, so avoid writing
+//       to it directly while the mode is started
+//
+bool any_log_async_start(size_t capacity, any_log_overflow_t overflow);
+
+// Write the queued records, stop the writer thread and go back to logging
+// synchronously. It is also called at exit.
+//
+// NOTE: No other thread should be logging while the mode is stopped
+//
+void any_log_async_stop(void);
+
+// Return the number of records discarded because the ring was full.
+//
+size_t any_log_dropped(void);
+
+#endif
+
+// The binary mode needs the same support of the asynchronous mode, you can
+// disable it by defining ANY_LOG_NO_BINARY.
+//
+#if defined(ANY_LOG_NO_ASYNC) && !defined(ANY_LOG_NO_BINARY)
+#define ANY_LOG_NO_BINARY
+#endif
+
+#ifndef ANY_LOG_NO_BINARY
+
+// Like any_log_init, but log_[level] writes binary records instead of text:
+// the first time a call site is used the record of its level, module,
+// function and format string, then for each call only the id of the site,
+// a timestamp and the bytes of the arguments (strings are copied), without
+// formatting them. The other log functions and the call sites that can't be
+// encoded (with %n, %ls or more than ANY_LOG_SITE_ARGS arguments) write text
+// records. For example
+//
+//    any_log_init_binary(fopen("app.log", "wb"), ANY_LOG_DEBUG);
+//
+// Use the tool any_logdecode (or any_log_decode) to read the log. It can be
+// combined with the asynchronous mode, call any_log_init_binary before
+// any_log_async_start.
+//
+// NOTE: The log can only be decoded by a program built for a machine with
+//       the same byte order, and the long double arguments are decoded as
+//       double
+//
+void any_log_init_binary(FILE *stream, any_log_level_t level);
+
+// Decode a binary log and write it to stream as text, with the format of
+// the text mode and, if timestamps is true, the time of each record (local
+// time, with nanoseconds) at the start of the line. Return false if the
+// log is malformed, after writing the records before the error.
+//
+bool any_log_decode(const void *data, size_t length, FILE *stream, bool timestamps);
+
+#endif
+
+// Wait until every record logged so far has been written. In the
+// asynchronous mode it waits for the writer thread, otherwise it flushes
+// any_log_stream. log_panic calls it before terminating the program.
+//
+void any_log_flush(void);
+
 // An array containing the strings corresponding to the log levels.
 //
 // Can be modified in the implementation by defining the macros ANY_LOG_[level]_STRING.
@@ -300,10 +839,19 @@ ANY_LOG_ATTRIBUTE(nonnull(4))
 void any_log_format(any_log_level_t level, const char *module,
                     const char *func, const char *format, ...);
 
+ANY_LOG_ATTRIBUTE(format(printf, 5, 6))
+ANY_LOG_ATTRIBUTE(nonnull(1, 5))
+void any_log_format_site(any_log_site_t *site, any_log_level_t level, const char *module,
+                         const char *func, const char *format, ...);
+
 ANY_LOG_ATTRIBUTE(nonnull(4))
 void any_log_value(any_log_level_t level, const char *module,
                    const char *func, const char *message, ...);
 
+ANY_LOG_ATTRIBUTE(nonnull(4, 5))
+void any_log_pairs(any_log_level_t level, const char *module, const char *func,
+                   const char *message, const any_log_pair_t *pairs, size_t count);
+
 ANY_LOG_ATTRIBUTE(noreturn)
 ANY_LOG_ATTRIBUTE(format(printf, 5, 6))
 ANY_LOG_ATTRIBUTE(nonnull(1, 4))
@@ -333,116 +881,981 @@ FILE *any_log_stream = NULL;
 
 any_log_level_t any_log_level = ANY_LOG_LEVEL_DEFAULT;
 
+#ifndef ANY_LOG_NO_BINARY
+
+// Set by any_log_init_binary, which also increments the epoch so that every
+// call site writes its record again in the new log
+static int any_log_binary_on;
+static uint32_t any_log_binary_epoch;
+
+#endif
+
 // Utility function to initialize the library
 void any_log_init(FILE *stream, any_log_level_t level)
 {
     any_log_stream = stream;
     any_log_level = level;
-}
 
-// Log level strings
-#ifndef ANY_LOG_PANIC_STRING
-#define ANY_LOG_PANIC_STRING "panic"
-#endif
-#ifndef ANY_LOG_ERROR_STRING
-#define ANY_LOG_ERROR_STRING "error"
+#ifndef ANY_LOG_NO_BINARY
+    any_log_binary_on = 0;
 #endif
-#ifndef ANY_LOG_WARN_STRING
-#define ANY_LOG_WARN_STRING "warn"
+}
+
+#ifndef ANY_LOG_NO_ASYNC
+
+#include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+
+// The size of the buffer where each thread formats its records. The longer
+// records are formatted again on a stream that grows, in the asynchronous
+// mode they are truncated (and end with a newline)
+#ifndef ANY_LOG_RECORD_SIZE
+#define ANY_LOG_RECORD_SIZE 4096
 #endif
-#ifndef ANY_LOG_INFO_STRING
-#define ANY_LOG_INFO_STRING "info"
+
+// The writer thread collects the records in a buffer of this size and
+// writes them with a single call
+#ifndef ANY_LOG_WRITE_SIZE
+#define ANY_LOG_WRITE_SIZE (64 * 1024)
 #endif
-#ifndef ANY_LOG_DEBUG_STRING
-#define ANY_LOG_DEBUG_STRING "debug"
+
+// How long the writer thread sleeps when the ring is empty (at most, it is
+// woken up by the log calls)
+#ifndef ANY_LOG_WRITER_SLEEP_MS
+#define ANY_LOG_WRITER_SLEEP_MS 100
 #endif
-#ifndef ANY_LOG_TRACE_STRING
-#define ANY_LOG_TRACE_STRING "trace"
+
+// Every record in the ring starts with its length plus one (zero means not
+// published yet, also for the empty records), which is written last and
+// cleared by the writer, and is padded to a multiple of 8 bytes (so that
+// the lengths don't wrap around the end of the ring)
+#define ANY_LOG_RECORD_HEADER 4
+#define ANY_LOG_RECORD_ALIGN(length) (((length) + ANY_LOG_RECORD_HEADER + 7) & ~(size_t)7)
+
+// In the binary mode the text records start with a tag, a timestamp and
+// their length (see any_log_binary_text)
+#define ANY_LOG_BINARY_TEXT_HEADER 13
+
+// The writer thread must be able to collect any record
+#if ANY_LOG_RECORD_SIZE + ANY_LOG_BINARY_TEXT_HEADER > ANY_LOG_WRITE_SIZE
+#error "ANY_LOG_WRITE_SIZE must be at least ANY_LOG_RECORD_SIZE + ANY_LOG_BINARY_TEXT_HEADER"
 #endif
 
-const char *any_log_level_strings[ANY_LOG_ALL] = {
-    ANY_LOG_PANIC_STRING,
-    ANY_LOG_ERROR_STRING,
-    ANY_LOG_WARN_STRING,
-    ANY_LOG_INFO_STRING ,
-    ANY_LOG_DEBUG_STRING,
-    ANY_LOG_TRACE_STRING,
-};
+// The text is formatted after enough space for the header of the binary
+// mode, so that it can be added without copying the text. The stream
+// writes to data, which grows to the longest record
+typedef struct {
+    FILE *stream;
+    char *data;
+    size_t size;
+    char buffer[ANY_LOG_BINARY_TEXT_HEADER + ANY_LOG_RECORD_SIZE];
+} any_log_record_t;
+
+typedef struct {
+    // Written by the producers and by the writer thread, on separate lines
+    uint64_t head;
+    char pad1[64 - sizeof(uint64_t)];
+    uint64_t tail;
+    char pad2[64 - sizeof(uint64_t)];
+
+    uint8_t *ring;
+    size_t capacity;
+    any_log_overflow_t overflow;
+    int fd;
+
+    uint64_t written;
+    uint64_t dropped;
+    uint64_t reported;
+    int sleeping;
+    int running;
+
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+} any_log_async_t;
+
+static any_log_async_t any_log_async;
+
+// Checked by every log call, it is set only while the writer thread runs
+static int any_log_async_on;
+
+// The key frees the buffer of a thread when it exits, the thread local
+// pointer is faster to read
+static pthread_key_t any_log_record_key;
+static pthread_once_t any_log_record_once = PTHREAD_ONCE_INIT;
+static __thread any_log_record_t *any_log_record_local;
+
+static void any_log_record_free(void *data)
+{
+    any_log_record_t *record = (any_log_record_t *)data;
+    fclose(record->stream);
+    free(record->data);
+    free(record);
 
-const char *any_log_level_to_string(any_log_level_t level)
+    // It runs in the exiting thread, which could still log a record
+    any_log_record_local = NULL;
+}
+
+static void any_log_record_init(void)
 {
-    return level >= ANY_LOG_PANIC && level <= ANY_LOG_TRACE
-        ? any_log_level_strings[level] : "";
+    pthread_key_create(&any_log_record_key, any_log_record_free);
 }
 
-any_log_level_t any_log_level_from_string(const char *string)
+// Return the buffer of the calling thread, or NULL if it can't be created
+static any_log_record_t *any_log_record_get(void)
 {
-    for (int level = ANY_LOG_PANIC; level < ANY_LOG_ALL; level++) {
-        if (strcmp(any_log_level_strings[level], string) == 0)
-            return (any_log_level_t)level;
+    any_log_record_t *record = any_log_record_local;
+    if (record == NULL) {
+        pthread_once(&any_log_record_once, any_log_record_init);
+
+        record = (any_log_record_t *)malloc(sizeof(any_log_record_t));
+        if (record == NULL)
+            return NULL;
+
+        record->stream = open_memstream(&record->data, &record->size);
+        if (record->stream == NULL) {
+            free(record);
+            return NULL;
+        }
+
+        pthread_setspecific(any_log_record_key, record);
+        any_log_record_local = record;
     }
 
-    return ANY_LOG_ALL;
+    return record;
 }
 
-// These colors related variables are provided just to provide a uniform
-// interface for setting the colors. If you decide to change the default
-// log format macros, feel free to ignore all this variables.
-//
-const char **any_log_colors = any_log_colors_default;
+// Return the stream of the buffer of the calling thread, rewound, or NULL
+// if it can't be created
+static FILE *any_log_record_begin(void)
+{
+    any_log_record_t *record = any_log_record_get();
+    if (record == NULL)
+        return NULL;
 
-// Log colors indexed by log level, with the addition of special colors
-// for func, module and reset sequence.
-//
-#ifndef ANY_LOG_PANIC_COLOR
-#define ANY_LOG_PANIC_COLOR "\x1b[1;91m"
-#endif
-#ifndef ANY_LOG_ERROR_COLOR
-#define ANY_LOG_ERROR_COLOR "\x1b[1;31m"
-#endif
-#ifndef ANY_LOG_WARN_COLOR
-#define ANY_LOG_WARN_COLOR "\x1b[1;33m"
-#endif
-#ifndef ANY_LOG_INFO_COLOR
-#define ANY_LOG_INFO_COLOR "\x1b[1;96m"
-#endif
-#ifndef ANY_LOG_DEBUG_COLOR
-#define ANY_LOG_DEBUG_COLOR "\x1b[1;37m"
-#endif
-#ifndef ANY_LOG_TRACE_COLOR
-#define ANY_LOG_TRACE_COLOR "\x1b[1;90m"
-#endif
-#ifndef ANY_LOG_RESET_COLOR
-#define ANY_LOG_RESET_COLOR "\x1b[0m"
-#endif
-#ifndef ANY_LOG_MODULE_COLOR
-#define ANY_LOG_MODULE_COLOR ""
-#endif
-#ifndef ANY_LOG_FUNC_COLOR
-#define ANY_LOG_FUNC_COLOR "\x1b[1m"
-#endif
+    // Like the buffer, the stream keeps space for the header of the binary
+    // mode before the text
+    static const char header[ANY_LOG_BINARY_TEXT_HEADER] = {0};
 
-const char *any_log_colors_default[ANY_LOG_ALL + 3] = {
-    ANY_LOG_PANIC_COLOR,
-    ANY_LOG_ERROR_COLOR,
-    ANY_LOG_WARN_COLOR,
-    ANY_LOG_INFO_COLOR ,
-    ANY_LOG_DEBUG_COLOR,
-    ANY_LOG_TRACE_COLOR,
-    ANY_LOG_RESET_COLOR,
-    ANY_LOG_MODULE_COLOR,
-    ANY_LOG_FUNC_COLOR
-};
+    rewind(record->stream);
+    fwrite(header, 1, sizeof(header), record->stream);
+    return record->stream;
+}
 
-const char *any_log_colors_disabled[ANY_LOG_ALL + 3] = {
-    "", "", "", "", "", "", "",
-};
+// Return the bytes formatted on the stream of the buffer of the calling
+// thread
+static char *any_log_record_data(FILE *stream, size_t *length)
+{
+    any_log_record_t *record = any_log_record_local;
+
+    fflush(stream);
+    long position = ftell(stream);
+    *length = position > ANY_LOG_BINARY_TEXT_HEADER ? (size_t)position - ANY_LOG_BINARY_TEXT_HEADER : 0;
+
+    return record->data + ANY_LOG_BINARY_TEXT_HEADER;
+}
+
+// Format at the end of the length bytes of text in a buffer, return the
+// new length (at most ANY_LOG_RECORD_SIZE - 1, the last byte is kept for
+// the terminator)
+static size_t any_log_record_vprint(char *text, size_t length, const char *format, va_list args)
+{
+    const int n = vsnprintf(text + length, ANY_LOG_RECORD_SIZE - length, format, args);
+    length += n > 0 ? (size_t)n : 0;
+    return length < ANY_LOG_RECORD_SIZE - 1 ? length : ANY_LOG_RECORD_SIZE - 1;
+}
+
+static size_t any_log_record_print(char *text, size_t length, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    length = any_log_record_vprint(text, length, format, args);
+    va_end(args);
+    return length;
+}
+
+#ifndef ANY_LOG_NO_BINARY
+
+// The timestamps are in nanoseconds since the epoch
+static uint64_t any_log_time(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+// The tags of the records of the binary mode
+#define ANY_LOG_BINARY_HEADER 'H'
+#define ANY_LOG_BINARY_SITE 'S'
+#define ANY_LOG_BINARY_RECORD 'R'
+#define ANY_LOG_BINARY_TEXT 'T'
+
+// Write the header of a text record of length bytes in the bytes before it
+static void any_log_binary_text(char *text, size_t length)
+{
+    const uint64_t time = any_log_time();
+    const uint32_t size = (uint32_t)length;
+
+    text[-ANY_LOG_BINARY_TEXT_HEADER] = ANY_LOG_BINARY_TEXT;
+    memcpy(text - ANY_LOG_BINARY_TEXT_HEADER + 1, &time, sizeof(time));
+    memcpy(text - ANY_LOG_BINARY_TEXT_HEADER + 9, &size, sizeof(size));
+}
+
+#endif
+
+static void any_log_async_wake(void)
+{
+    if (__atomic_load_n(&any_log_async.sleeping, __ATOMIC_SEQ_CST)) {
+        pthread_mutex_lock(&any_log_async.mutex);
+        pthread_cond_signal(&any_log_async.wake);
+        pthread_mutex_unlock(&any_log_async.mutex);
+    }
+}
+
+// Copy between a linear buffer and the ring, wrapping around its end
+static void any_log_ring_copy(uint8_t *to, const uint8_t *from, size_t length, size_t offset, bool into_ring)
+{
+    uint8_t *ring = any_log_async.ring;
+    const size_t first = length < any_log_async.capacity - offset ? length : any_log_async.capacity - offset;
+
+    if (into_ring) {
+        memcpy(ring + offset, from, first);
+        memcpy(ring, from + first, length - first);
+    } else {
+        memcpy(to, ring + offset, first);
+        memcpy(to + first, ring, length - first);
+    }
+}
+
+// Queue a record, the producers reserve their space by moving the head and
+// then publish the record by writing its length
+static void any_log_async_push(const char *data, size_t length)
+{
+    any_log_async_t *async = &any_log_async;
+    const size_t size = ANY_LOG_RECORD_ALIGN(length);
+    uint64_t head = __atomic_load_n(&async->head, __ATOMIC_RELAXED);
+
+    for (;;) {
+        const uint64_t tail = __atomic_load_n(&async->tail, __ATOMIC_ACQUIRE);
+
+        if (head + size - tail > async->capacity) {
+            if (async->overflow != ANY_LOG_BLOCK) {
+                __atomic_add_fetch(&async->dropped, 1, __ATOMIC_RELAXED);
+                return;
+            }
+
+            any_log_async_wake();
+            sched_yield();
+            head = __atomic_load_n(&async->head, __ATOMIC_RELAXED);
+            continue;
+        }
+
+        if (__atomic_compare_exchange_n(&async->head, &head, head + size, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            break;
+    }
+
+    const size_t offset = (size_t)(head & (async->capacity - 1));
+    any_log_ring_copy(NULL, (const uint8_t *)data, length,
+                      (offset + ANY_LOG_RECORD_HEADER) & (async->capacity - 1), true);
+
+    __atomic_store_n((uint32_t *)(async->ring + offset), (uint32_t)length + 1, __ATOMIC_SEQ_CST);
+    any_log_async_wake();
+}
+
+static void any_log_write_all(int fd, const char *data, size_t length)
+{
+    while (length > 0) {
+        const ssize_t n = write(fd, data, length);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return;
+
+        data += n;
+        length -= (size_t)n;
+    }
+}
+
+// Move the published records from the tail of the ring to the buffer,
+// clearing their space, and return the number of bytes
+static size_t any_log_async_collect(char *buffer, size_t size)
+{
+    any_log_async_t *async = &any_log_async;
+    uint64_t tail = async->tail;
+    size_t length = 0;
+
+    // Report the records dropped so far
+    const uint64_t dropped = __atomic_load_n(&async->dropped, __ATOMIC_RELAXED);
+    if (async->overflow == ANY_LOG_COUNT && dropped != async->reported) {
+#ifndef ANY_LOG_NO_BINARY
+        const size_t header = any_log_binary_on ? ANY_LOG_BINARY_TEXT_HEADER : 0;
+#else
+        const size_t header = 0;
+#endif
+        length = (size_t)snprintf(buffer + header, size - header, "any_log: %llu records dropped\n",
+                                  (unsigned long long)(dropped - async->reported));
+        async->reported = dropped;
+
+#ifndef ANY_LOG_NO_BINARY
+        if (header > 0)
+            any_log_binary_text(buffer + header, length);
+#endif
+        length += header;
+    }
+
+    for (;;) {
+        const size_t offset = (size_t)(tail & (async->capacity - 1));
+        const uint32_t published = __atomic_load_n((uint32_t *)(async->ring + offset), __ATOMIC_SEQ_CST);
+        const size_t record = (size_t)published - 1;
+
+        if (published == 0 || length + record > size)
+            break;
+
+        const size_t space = ANY_LOG_RECORD_ALIGN(record);
+        any_log_ring_copy((uint8_t *)buffer + length, NULL, record,
+                          (offset + ANY_LOG_RECORD_HEADER) & (async->capacity - 1), false);
+
+        // The space is cleared, so that its bytes are not taken for lengths
+        // when the ring wraps around
+        const size_t first = space < async->capacity - offset ? space : async->capacity - offset;
+        memset(async->ring + offset, 0, first);
+        memset(async->ring, 0, space - first);
+
+        length += record;
+        tail += space;
+    }
+
+    __atomic_store_n(&async->tail, tail, __ATOMIC_RELEASE);
+    return length;
+}
+
+static void *any_log_async_writer(void *data)
+{
+    any_log_async_t *async = &any_log_async;
+    char *buffer = (char *)data;
+
+    for (;;) {
+        const size_t length = any_log_async_collect(buffer, ANY_LOG_WRITE_SIZE);
+
+        if (length > 0) {
+            any_log_write_all(async->fd, buffer, length);
+
+            pthread_mutex_lock(&async->mutex);
+            async->written = async->tail;
+            pthread_cond_broadcast(&async->done);
+            pthread_mutex_unlock(&async->mutex);
+            continue;
+        }
+
+        pthread_mutex_lock(&async->mutex);
+        async->written = async->tail;
+        pthread_cond_broadcast(&async->done);
+
+        if (!async->running && async->tail == __atomic_load_n(&async->head, __ATOMIC_ACQUIRE)) {
+            pthread_mutex_unlock(&async->mutex);
+            break;
+        }
+
+        // The flag is set before checking the ring again, so that a record
+        // published after the check sees it and wakes the thread up
+        __atomic_store_n(&async->sleeping, 1, __ATOMIC_SEQ_CST);
+        const size_t offset = (size_t)(async->tail & (async->capacity - 1));
+
+        if (__atomic_load_n((uint32_t *)(async->ring + offset), __ATOMIC_SEQ_CST) == 0 && async->running) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += ANY_LOG_WRITER_SLEEP_MS * 1000000L;
+            deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+            pthread_cond_timedwait(&async->wake, &async->mutex, &deadline);
+        }
+
+        __atomic_store_n(&async->sleeping, 0, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&async->mutex);
+    }
+
+    free(buffer);
+    return NULL;
+}
+
+bool any_log_async_start(size_t capacity, any_log_overflow_t overflow)
+{
+    any_log_async_t *async = &any_log_async;
+
+    if (__atomic_load_n(&any_log_async_on, __ATOMIC_ACQUIRE) || any_log_stream == NULL)
+        return false;
+
+    fflush(any_log_stream);
+    const int fd = fileno(any_log_stream);
+    if (fd < 0)
+        return false;
+
+    // The ring must hold at least a few records of the maximum size
+    size_t size = 8 * ANY_LOG_RECORD_SIZE;
+    while (size < capacity)
+        size *= 2;
+
+    uint8_t *ring = (uint8_t *)calloc(size, 1);
+    char *buffer = (char *)malloc(ANY_LOG_WRITE_SIZE);
+
+    if (ring == NULL || buffer == NULL) {
+        free(ring);
+        free(buffer);
+        return false;
+    }
+
+    async->head = 0;
+    async->tail = 0;
+    async->ring = ring;
+    async->capacity = size;
+    async->overflow = overflow;
+    async->fd = fd;
+    async->written = 0;
+    async->dropped = 0;
+    async->reported = 0;
+    async->sleeping = 0;
+    async->running = 1;
+
+    pthread_mutex_init(&async->mutex, NULL);
+    pthread_cond_init(&async->wake, NULL);
+    pthread_cond_init(&async->done, NULL);
+
+    if (pthread_create(&async->thread, NULL, any_log_async_writer, buffer) != 0) {
+        pthread_mutex_destroy(&async->mutex);
+        pthread_cond_destroy(&async->wake);
+        pthread_cond_destroy(&async->done);
+        free(ring);
+        free(buffer);
+        return false;
+    }
+
+    static bool registered = false;
+    if (!registered)
+        registered = atexit(any_log_async_stop) == 0;
+
+    __atomic_store_n(&any_log_async_on, 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+void any_log_async_stop(void)
+{
+    any_log_async_t *async = &any_log_async;
+
+    if (!__atomic_load_n(&any_log_async_on, __ATOMIC_ACQUIRE))
+        return;
+
+    __atomic_store_n(&any_log_async_on, 0, __ATOMIC_RELEASE);
+
+    pthread_mutex_lock(&async->mutex);
+    async->running = 0;
+    pthread_cond_signal(&async->wake);
+    pthread_mutex_unlock(&async->mutex);
+
+    pthread_join(async->thread, NULL);
+    pthread_mutex_destroy(&async->mutex);
+    pthread_cond_destroy(&async->wake);
+    pthread_cond_destroy(&async->done);
+
+    free(async->ring);
+    async->ring = NULL;
+}
+
+size_t any_log_dropped(void)
+{
+    return (size_t)__atomic_load_n(&any_log_async.dropped, __ATOMIC_RELAXED);
+}
+
+#endif
+
+void any_log_flush(void)
+{
+#ifndef ANY_LOG_NO_ASYNC
+    any_log_async_t *async = &any_log_async;
+
+    if (__atomic_load_n(&any_log_async_on, __ATOMIC_ACQUIRE)) {
+        const uint64_t head = __atomic_load_n(&async->head, __ATOMIC_ACQUIRE);
+
+        pthread_mutex_lock(&async->mutex);
+        while (async->written < head) {
+            pthread_cond_signal(&async->wake);
+            pthread_cond_wait(&async->done, &async->mutex);
+        }
+        pthread_mutex_unlock(&async->mutex);
+        return;
+    }
+#endif
+
+    if (any_log_stream != NULL)
+        fflush(any_log_stream);
+}
+
+#ifndef ANY_LOG_NO_ASYNC
+
+// Write a whole record, queueing it in the asynchronous mode
+static void any_log_write(const void *data, size_t length)
+{
+    if (__atomic_load_n(&any_log_async_on, __ATOMIC_ACQUIRE))
+        any_log_async_push((const char *)data, length);
+    else
+        fwrite(data, 1, length, any_log_stream);
+}
+
+#endif
+
+// Every log function formats its record on the stream returned by
+// any_log_begin and then calls any_log_end.
+//
+// The record is formatted in the buffer of the calling thread and written
+// to any_log_stream with a single fwrite, so that the records of different
+// threads don't interleave and the lock of the stream is taken only once
+// (for unbuffered streams, like stderr, this is a single write). Without
+// the buffers (see ANY_LOG_NO_ASYNC) the record is formatted directly on
+// any_log_stream.
+static FILE *any_log_begin(void)
+{
+#ifndef ANY_LOG_NO_ASYNC
+    FILE *stream = any_log_record_begin();
+    if (stream != NULL)
+        return stream;
+#endif
+
+    return any_log_stream;
+}
+
+#ifndef ANY_LOG_NO_ASYNC
+
+// Write the text formatted in the buffer of the calling thread. In the
+// asynchronous mode a record too long for the ring is truncated, ending
+// with a newline
+static void any_log_record_write(char *text, size_t length)
+{
+    if (length >= ANY_LOG_RECORD_SIZE - 1 && __atomic_load_n(&any_log_async_on, __ATOMIC_ACQUIRE)) {
+        length = ANY_LOG_RECORD_SIZE - 1;
+        text[length - 1] = '\n';
+    }
+
+#ifndef ANY_LOG_NO_BINARY
+    if (any_log_binary_on) {
+        any_log_binary_text(text, length);
+        text -= ANY_LOG_BINARY_TEXT_HEADER;
+        length += ANY_LOG_BINARY_TEXT_HEADER;
+    }
+#endif
+
+    any_log_write(text, length);
+}
+
+#endif
+
+static void any_log_end(FILE *stream)
+{
+#ifndef ANY_LOG_NO_ASYNC
+    if (stream != any_log_stream) {
+        size_t length;
+        char *text = any_log_record_data(stream, &length);
+        any_log_record_write(text, length);
+    }
+#else
+    (void)stream;
+#endif
+}
+
+// Log level strings
+#ifndef ANY_LOG_PANIC_STRING
+#define ANY_LOG_PANIC_STRING "panic"
+#endif
+#ifndef ANY_LOG_ERROR_STRING
+#define ANY_LOG_ERROR_STRING "error"
+#endif
+#ifndef ANY_LOG_WARN_STRING
+#define ANY_LOG_WARN_STRING "warn"
+#endif
+#ifndef ANY_LOG_INFO_STRING
+#define ANY_LOG_INFO_STRING "info"
+#endif
+#ifndef ANY_LOG_DEBUG_STRING
+#define ANY_LOG_DEBUG_STRING "debug"
+#endif
+#ifndef ANY_LOG_TRACE_STRING
+#define ANY_LOG_TRACE_STRING "trace"
+#endif
+
+const char *any_log_level_strings[ANY_LOG_ALL] = {
+    ANY_LOG_PANIC_STRING,
+    ANY_LOG_ERROR_STRING,
+    ANY_LOG_WARN_STRING,
+    ANY_LOG_INFO_STRING ,
+    ANY_LOG_DEBUG_STRING,
+    ANY_LOG_TRACE_STRING,
+};
+
+const char *any_log_level_to_string(any_log_level_t level)
+{
+    return level >= ANY_LOG_PANIC && level <= ANY_LOG_TRACE
+        ? any_log_level_strings[level] : "";
+}
+
+any_log_level_t any_log_level_from_string(const char *string)
+{
+    for (int level = ANY_LOG_PANIC; level < ANY_LOG_ALL; level++) {
+        if (strcmp(any_log_level_strings[level], string) == 0)
+            return (any_log_level_t)level;
+    }
+
+    return ANY_LOG_ALL;
+}
+
+// The levels of the modules are in an open addressing hash table, which is
+// replaced by any_log_set_levels
+typedef struct {
+    uint32_t hash;
+    uint8_t level;
+    char *module;
+} any_log_module_t;
+
+static any_log_module_t *any_log_modules;
+static size_t any_log_modules_capacity;
+
+// The generation of the sites starts from 0, so that they look up their
+// level the first time
+uint32_t any_log_generation = 1;
+
+#ifndef ANY_LOG_NO_ASYNC
+static pthread_mutex_t any_log_modules_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define ANY_LOG_MODULES_LOCK() pthread_mutex_lock(&any_log_modules_mutex)
+#define ANY_LOG_MODULES_UNLOCK() pthread_mutex_unlock(&any_log_modules_mutex)
+#else
+#define ANY_LOG_MODULES_LOCK()
+#define ANY_LOG_MODULES_UNLOCK()
+#endif
+
+// FNV-1a of the first length bytes of a module name
+static uint32_t any_log_module_hash(const char *module, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++)
+        hash = (hash ^ (uint8_t)module[i]) * 16777619u;
+    return hash;
+}
+
+// Return the slot of a module in a table, which is empty if it is missing
+static any_log_module_t *any_log_module_find(any_log_module_t *modules, size_t capacity,
+                                             const char *module, size_t length, uint32_t hash)
+{
+    for (size_t i = hash & (capacity - 1);; i = (i + 1) & (capacity - 1)) {
+        any_log_module_t *slot = &modules[i];
+        if (slot->module == NULL ||
+            (slot->hash == hash && strncmp(slot->module, module, length) == 0 && slot->module[length] == '\0'))
+            return slot;
+    }
+}
+
+static void any_log_modules_free(any_log_module_t *modules, size_t capacity)
+{
+    for (size_t i = 0; i < capacity; i++)
+        free(modules[i].module);
+    free(modules);
+}
+
+// Return the level of a module with the lock held, or
+// ANY_LOG_SITE_LEVEL_GLOBAL if it has none
+static unsigned any_log_module_lookup(const char *module)
+{
+    if (any_log_modules == NULL || module == NULL)
+        return ANY_LOG_SITE_LEVEL_GLOBAL;
+
+    const size_t length = strlen(module);
+    const any_log_module_t *slot = any_log_module_find(any_log_modules, any_log_modules_capacity, module,
+                                                       length, any_log_module_hash(module, length));
+    return slot->module != NULL ? slot->level : ANY_LOG_SITE_LEVEL_GLOBAL;
+}
+
+bool any_log_set_levels(const char *spec)
+{
+    // Every entry has at least two characters and a separator
+    size_t capacity = 4;
+    while (capacity < strlen(spec))
+        capacity *= 2;
+
+    any_log_module_t *modules = (any_log_module_t *)calloc(capacity, sizeof(any_log_module_t));
+    if (modules == NULL)
+        return false;
+
+    any_log_level_t global = any_log_level;
+    bool valid = true, empty = true;
+
+    for (const char *entry = spec; valid && *entry != '\0';) {
+        const char *end = strchr(entry, ',');
+        if (end == NULL)
+            end = entry + strlen(entry);
+
+        // Trim the spaces of the module and of the level
+        const char *equal = (const char *)memchr(entry, '=', (size_t)(end - entry));
+        const char *module = entry, *module_end = equal != NULL ? equal : entry;
+        const char *name = equal != NULL ? equal + 1 : entry, *name_end = end;
+
+        while (module < module_end && isspace((unsigned char)*module))
+            module++;
+        while (module_end > module && isspace((unsigned char)module_end[-1]))
+            module_end--;
+        while (name < name_end && isspace((unsigned char)*name))
+            name++;
+        while (name_end > name && isspace((unsigned char)name_end[-1]))
+            name_end--;
+
+        char level_name[32];
+        const size_t name_length = (size_t)(name_end - name);
+        any_log_level_t level = ANY_LOG_ALL;
+
+        if (name_length < sizeof(level_name)) {
+            memcpy(level_name, name, name_length);
+            level_name[name_length] = '\0';
+            level = any_log_level_from_string(level_name);
+        }
+
+        const size_t length = (size_t)(module_end - module);
+
+        if (equal == NULL && name_length == 0) {
+            // An empty entry is allowed, like in "net=trace,"
+        } else if (level == ANY_LOG_ALL || (equal != NULL && length == 0)) {
+            valid = false;
+        } else if (equal == NULL || (length == 1 && module[0] == '*')) {
+            global = level;
+        } else {
+            const uint32_t hash = any_log_module_hash(module, length);
+            any_log_module_t *slot = any_log_module_find(modules, capacity, module, length, hash);
+
+            if (slot->module == NULL) {
+                slot->module = (char *)malloc(length + 1);
+                valid = slot->module != NULL;
+                if (valid) {
+                    memcpy(slot->module, module, length);
+                    slot->module[length] = '\0';
+                }
+            }
+
+            slot->hash = hash;
+            slot->level = (uint8_t)level;
+            empty = false;
+        }
+
+        entry = *end == ',' ? end + 1 : end;
+    }
+
+    if (!valid) {
+        any_log_modules_free(modules, capacity);
+        return false;
+    }
+
+    if (empty) {
+        any_log_modules_free(modules, capacity);
+        modules = NULL;
+        capacity = 0;
+    }
+
+    ANY_LOG_MODULES_LOCK();
+
+    any_log_module_t *old = any_log_modules;
+    const size_t old_capacity = any_log_modules_capacity;
+
+    any_log_modules_capacity = capacity;
+
+    // The log calls read them without the lock
+#ifdef __GNUC__
+    __atomic_store_n(&any_log_modules, modules, __ATOMIC_RELEASE);
+    __atomic_store_n(&any_log_level, global, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&any_log_generation, 1, __ATOMIC_RELEASE);
+#else
+    any_log_modules = modules;
+    any_log_level = global;
+    any_log_generation++;
+#endif
+
+    ANY_LOG_MODULES_UNLOCK();
+
+    if (old != NULL)
+        any_log_modules_free(old, old_capacity);
+
+    return true;
+}
+
+any_log_level_t any_log_module_level(const char *module)
+{
+    ANY_LOG_MODULES_LOCK();
+    const unsigned level = any_log_module_lookup(module);
+    ANY_LOG_MODULES_UNLOCK();
+
+    return level == ANY_LOG_SITE_LEVEL_GLOBAL ? any_log_level : (any_log_level_t)level;
+}
+
+void any_log_site_update(any_log_site_t *site, const char *module)
+{
+    ANY_LOG_MODULES_LOCK();
+
+#ifdef __GNUC__
+    __atomic_store_n(&site->level, (uint8_t)any_log_module_lookup(module), __ATOMIC_RELAXED);
+    __atomic_store_n(&site->generation, any_log_generation, __ATOMIC_RELEASE);
+#else
+    site->level = (uint8_t)any_log_module_lookup(module);
+    site->generation = any_log_generation;
+#endif
+
+    ANY_LOG_MODULES_UNLOCK();
+}
+
+#ifndef ANY_LOG_NO_REGISTRY
+
+// The bounds of the any_log_registry section, which are defined by the linker.
+// They are weak for the programs without sites and hidden so that every
+// shared library sees its own sites.
+extern const any_log_site_info_t __start_any_log_registry[] __attribute__((weak, visibility("hidden")));
+extern const any_log_site_info_t __stop_any_log_registry[] __attribute__((weak, visibility("hidden")));
+
+#endif
+
+const any_log_site_info_t *any_log_sites(size_t *count)
+{
+#ifndef ANY_LOG_NO_REGISTRY
+    if (__start_any_log_registry != NULL) {
+        *count = (size_t)(__stop_any_log_registry - __start_any_log_registry);
+        return __start_any_log_registry;
+    }
+#endif
+
+    *count = 0;
+    return NULL;
+}
+
+// Match a string with the wildcards '*' and '?', by going back to the last
+// '*' at every mismatch
+static bool any_log_match(const char *pattern, const char *string)
+{
+    const char *star = NULL, *next = NULL;
+
+    while (*string != '\0') {
+        if (*pattern == '*') {
+            star = pattern++;
+            next = string;
+        } else if (*pattern == '?' || *pattern == *string) {
+            pattern++;
+            string++;
+        } else if (star != NULL) {
+            pattern = star + 1;
+            string = ++next;
+        } else {
+            return false;
+        }
+    }
+
+    while (*pattern == '*')
+        pattern++;
+
+    return *pattern == '\0';
+}
+
+size_t any_log_sites_set(const char *pattern, any_log_site_state_t state)
+{
+    size_t count, matched = 0;
+    const any_log_site_info_t *sites = any_log_sites(&count);
+
+    for (size_t i = 0; i < count; i++) {
+        const any_log_site_info_t *info = &sites[i];
+        bool match = any_log_match(pattern, info->module) || any_log_match(pattern, info->func) ||
+                     any_log_match(pattern, info->file);
+
+        if (!match) {
+            char location[512];
+            snprintf(location, sizeof(location), "%s:%d", info->file, info->line);
+            match = any_log_match(pattern, location);
+        }
+
+        if (match) {
+#ifdef __GNUC__
+            __atomic_store_n(&info->site->state, (uint8_t)state, __ATOMIC_RELAXED);
+#else
+            info->site->state = (uint8_t)state;
+#endif
+            matched++;
+        }
+    }
+
+    return matched;
+}
+
+// The level check of the functions without a call site, which look up the
+// module only when some modules have a level
+static bool any_log_module_enabled(any_log_level_t level, const char *module)
+{
+    if (ANY_LOG_LOAD_ACQUIRE(&any_log_modules) == NULL)
+        return level <= ANY_LOG_LOAD_RELAXED(&any_log_level);
+
+    return level <= any_log_module_level(module);
+}
+
+// These colors related variables are provided just to provide a uniform
+// interface for setting the colors. If you decide to change the default
+// log format macros, feel free to ignore all this variables.
+//
+const char **any_log_colors = any_log_colors_default;
+
+// Log colors indexed by log level, with the addition of special colors
+// for func, module and reset sequence.
+//
+#ifndef ANY_LOG_PANIC_COLOR
+#define ANY_LOG_PANIC_COLOR "\x1b[1;91m"
+#endif
+#ifndef ANY_LOG_ERROR_COLOR
+#define ANY_LOG_ERROR_COLOR "\x1b[1;31m"
+#endif
+#ifndef ANY_LOG_WARN_COLOR
+#define ANY_LOG_WARN_COLOR "\x1b[1;33m"
+#endif
+#ifndef ANY_LOG_INFO_COLOR
+#define ANY_LOG_INFO_COLOR "\x1b[1;96m"
+#endif
+#ifndef ANY_LOG_DEBUG_COLOR
+#define ANY_LOG_DEBUG_COLOR "\x1b[1;37m"
+#endif
+#ifndef ANY_LOG_TRACE_COLOR
+#define ANY_LOG_TRACE_COLOR "\x1b[1;90m"
+#endif
+#ifndef ANY_LOG_RESET_COLOR
+#define ANY_LOG_RESET_COLOR "\x1b[0m"
+#endif
+#ifndef ANY_LOG_MODULE_COLOR
+#define ANY_LOG_MODULE_COLOR ""
+#endif
+#ifndef ANY_LOG_FUNC_COLOR
+#define ANY_LOG_FUNC_COLOR "\x1b[1m"
+#endif
+
+const char *any_log_colors_default[ANY_LOG_ALL + 3] = {
+    ANY_LOG_PANIC_COLOR,
+    ANY_LOG_ERROR_COLOR,
+    ANY_LOG_WARN_COLOR,
+    ANY_LOG_INFO_COLOR ,
+    ANY_LOG_DEBUG_COLOR,
+    ANY_LOG_TRACE_COLOR,
+    ANY_LOG_RESET_COLOR,
+    ANY_LOG_MODULE_COLOR,
+    ANY_LOG_FUNC_COLOR
+};
+
+const char *any_log_colors_disabled[ANY_LOG_ALL + 3] = {
+    "", "", "", "", "", "", "", "", "",
+};
 
 // Format for any_log_format (used at the start)
 #ifndef ANY_LOG_FORMAT_BEFORE
 #define ANY_LOG_FORMAT_BEFORE(level, module, func) \
     "[%s%s%s %s%s%s] %s%s%s: ", any_log_colors[ANY_LOG_ALL + 1], module, any_log_colors[ANY_LOG_ALL], any_log_colors[ANY_LOG_ALL + 2], \
     func, any_log_colors[ANY_LOG_ALL], any_log_colors[level], any_log_level_strings[level], any_log_colors[ANY_LOG_ALL]
+#define ANY_LOG_FORMAT_BEFORE_DEFAULT
 #endif
 
 // Format for any_log_format (used at the end)
@@ -450,27 +1863,741 @@ const char *any_log_colors_disabled[ANY_LOG_ALL + 3] = {
 #define ANY_LOG_FORMAT_AFTER(level, module, func) "\n"
 #endif
 
+#if !defined(ANY_LOG_NO_ASYNC) && defined(ANY_LOG_FORMAT_BEFORE_DEFAULT)
+
+// The value of any_log_site_t.prefix_length when the prefix is too long
+#define ANY_LOG_SITE_PREFIX_NONE 0xFFFF
+
+// Copy the prefix kept by a site to text and return its length, or
+// format it there (keeping it if possible) when it was formatted with other
+// colors.
+//
+// The version of the site is odd while a thread formats the prefix, the
+// other threads copy the prefix only if the version is even and doesn't
+// change during the copy (like a seqlock), otherwise they format it.
+static size_t any_log_site_prefix(any_log_site_t *site, char *text, any_log_level_t level,
+                                  const char *module, const char *func)
+{
+    const uint32_t version = __atomic_load_n(&site->version, __ATOMIC_ACQUIRE);
+    const char **colors = any_log_colors;
+
+    if (version % 2 == 0 && __atomic_load_n(&site->colors, __ATOMIC_RELAXED) == colors) {
+        const size_t length = site->prefix_length;
+        if (length != ANY_LOG_SITE_PREFIX_NONE) {
+            memcpy(text, site->prefix, length);
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&site->version, __ATOMIC_RELAXED) == version)
+                return length;
+        }
+    }
+
+    const size_t length = any_log_record_print(text, 0, ANY_LOG_FORMAT_BEFORE(level, module, func));
+
+    uint32_t expected = version;
+    if (version % 2 == 0 && __atomic_load_n(&site->colors, __ATOMIC_RELAXED) != colors &&
+        __atomic_compare_exchange_n(&site->version, &expected, version + 1, false,
+                                    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        // The odd version must be visible before the prefix changes
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+
+        if (length < ANY_LOG_SITE_PREFIX_SIZE) {
+            memcpy(site->prefix, text, length);
+            site->prefix_length = (uint16_t)length;
+        } else {
+            site->prefix_length = ANY_LOG_SITE_PREFIX_NONE;
+        }
+
+        __atomic_store_n(&site->colors, colors, __ATOMIC_RELAXED);
+        __atomic_store_n(&site->version, version + 2, __ATOMIC_RELEASE);
+    }
+
+    (void)module;
+    (void)func;
+    return length;
+}
+
+#endif
+
+// Format a record, with the prefix kept by the site if it is not NULL
+static void any_log_vformat(any_log_site_t *site, any_log_level_t level, const char *module,
+                            const char *func, const char *format, va_list args)
+{
+    va_list copy;
+    va_copy(copy, args);
+
+#ifndef ANY_LOG_NO_ASYNC
+    // The record is formatted in the buffer without its stream, which is
+    // slower than snprintf
+    any_log_record_t *record = any_log_record_get();
+    if (record != NULL) {
+        char *text = record->buffer + ANY_LOG_BINARY_TEXT_HEADER;
+#ifdef ANY_LOG_FORMAT_BEFORE_DEFAULT
+        size_t length = site != NULL
+            ? any_log_site_prefix(site, text, level, module, func)
+            : any_log_record_print(text, 0, ANY_LOG_FORMAT_BEFORE(level, module, func));
+#else
+        size_t length = any_log_record_print(text, 0, ANY_LOG_FORMAT_BEFORE(level, module, func));
+#endif
+        length = any_log_record_vprint(text, length, format, args);
+        length = any_log_record_print(text, length, ANY_LOG_FORMAT_AFTER(level, module, func));
+
+        // A record that fills the buffer is formatted again on the stream
+        if (length < ANY_LOG_RECORD_SIZE - 1) {
+            any_log_record_write(text, length);
+            va_end(copy);
+            return;
+        }
+    }
+#endif
+
+    FILE *stream = any_log_begin();
+    (void)site;
+
+    fprintf(stream, ANY_LOG_FORMAT_BEFORE(level, module, func));
+    vfprintf(stream, format, copy);
+    fprintf(stream, ANY_LOG_FORMAT_AFTER(level, module, func));
+    any_log_end(stream);
+    va_end(copy);
+
+    // NOTE: Suppress compiler warning if the user customizes the format string
+    //       and doesn't use these values in it
+    (void)module;
+    (void)func;
+}
+
 void any_log_format(any_log_level_t level, const char *module,
                     const char *func, const char *format, ...)
 {
-    if (level > any_log_level)
+    if (!any_log_module_enabled(level, module))
         return;
 
-    fprintf(any_log_stream, ANY_LOG_FORMAT_BEFORE(level, module, func));
+    va_list args;
+    va_start(args, format);
+    any_log_vformat(NULL, level, module, func, format, args);
+    va_end(args);
+}
+
+#ifndef ANY_LOG_NO_BINARY
+
+// The size of the header of the binary log (tag, magic, version and a value
+// for checking the byte order)
+#define ANY_LOG_BINARY_FILE_HEADER 13
+#define ANY_LOG_BINARY_VERSION 1
+#define ANY_LOG_BINARY_ORDER 0x01020304u
+
+// The size of the header of the site records (tag, id, level and the
+// lengths of module, function and format)
+#define ANY_LOG_BINARY_SITE_HEADER 12
+
+// The size of the header of the log records (tag, id, timestamp and the
+// length of the arguments)
+#define ANY_LOG_BINARY_RECORD_HEADER 17
+
+// The value of any_log_site_t.count for the sites logged as text
+#define ANY_LOG_SITE_TEXT 0xFF
+
+// The maximum length of a conversion specification, after replacing the
+// asterisks with their values
+#define ANY_LOG_SPEC_SIZE 64
+
+// The types of the arguments, as they are read by va_arg. The integers are
+// stored in 8 bytes, the long doubles as doubles and the strings as their
+// length (4 bytes) followed by their bytes.
+enum {
+    ANY_LOG_ARG_NONE,
+    ANY_LOG_ARG_INT,
+    ANY_LOG_ARG_LONG,
+    ANY_LOG_ARG_LLONG,
+    ANY_LOG_ARG_SIZE,
+    ANY_LOG_ARG_INTMAX,
+    ANY_LOG_ARG_PTRDIFF,
+    ANY_LOG_ARG_DOUBLE,
+    ANY_LOG_ARG_LDOUBLE,
+    ANY_LOG_ARG_PTR,
+    ANY_LOG_ARG_STRING,
+    // A string with the precision given by the previous argument
+    ANY_LOG_ARG_STRING_STAR,
+};
+
+typedef struct {
+    const char *end;
+    int type;
+    int stars;
+} any_log_spec_t;
+
+// Parse the conversion specification starting at the '%' of format and
+// return false if the binary mode doesn't support it. The strings with a
+// fixed precision are not supported since they can be not terminated and
+// their precision is not stored in the site.
+static bool any_log_spec_parse(const char *format, any_log_spec_t *spec)
+{
+    const char *p = format + 1;
+    bool precision_star = false, precision = false;
+
+    spec->stars = 0;
+
+    while (*p != '\0' && strchr("-+ #0'", *p) != NULL)
+        p++;
+
+    if (*p == '*') {
+        spec->stars++;
+        p++;
+    } else {
+        while (isdigit((unsigned char)*p))
+            p++;
+    }
+
+    if (*p == '.') {
+        precision = true;
+        p++;
+        if (*p == '*') {
+            spec->stars++;
+            precision_star = true;
+            p++;
+        } else {
+            while (isdigit((unsigned char)*p))
+                p++;
+        }
+    }
+
+    // Length modifiers
+    char modifier = '\0';
+    if (p[0] == 'h' && p[1] == 'h') {
+        modifier = 'H';
+        p += 2;
+    } else if (p[0] == 'l' && p[1] == 'l') {
+        modifier = 'q';
+        p += 2;
+    } else if (*p != '\0' && strchr("hljztL", *p) != NULL) {
+        modifier = *p++;
+    }
+
+    const char conversion = *p;
+    if (conversion == '\0')
+        return false;
+
+    spec->end = p + 1;
+
+    if (spec->end - format + spec->stars * 10 >= ANY_LOG_SPEC_SIZE)
+        return false;
+
+    switch (conversion) {
+    case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+        switch (modifier) {
+        case '\0': case 'H': case 'h': spec->type = ANY_LOG_ARG_INT; return true;
+        case 'l': spec->type = ANY_LOG_ARG_LONG; return true;
+        case 'q': spec->type = ANY_LOG_ARG_LLONG; return true;
+        case 'z': spec->type = ANY_LOG_ARG_SIZE; return true;
+        case 'j': spec->type = ANY_LOG_ARG_INTMAX; return true;
+        case 't': spec->type = ANY_LOG_ARG_PTRDIFF; return true;
+        default: return false;
+        }
+    case 'c':
+        spec->type = ANY_LOG_ARG_INT;
+        return modifier == '\0' || modifier == 'l';
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+        spec->type = modifier == 'L' ? ANY_LOG_ARG_LDOUBLE : ANY_LOG_ARG_DOUBLE;
+        return modifier == '\0' || modifier == 'l' || modifier == 'L';
+    case 'p':
+        spec->type = ANY_LOG_ARG_PTR;
+        return modifier == '\0';
+    case 's':
+        spec->type = precision_star ? ANY_LOG_ARG_STRING_STAR : ANY_LOG_ARG_STRING;
+        return modifier == '\0' && (!precision || precision_star);
+    case '%':
+        spec->type = ANY_LOG_ARG_NONE;
+        return spec->end == format + 2;
+    default:
+        return false;
+    }
+}
+
+// Find the types of the arguments of a format string
+static void any_log_site_parse(any_log_site_t *site, const char *format)
+{
+    int count = 0;
+
+    for (const char *p = format; *p != '\0';) {
+        if (*p != '%') {
+            p++;
+            continue;
+        }
+
+        any_log_spec_t spec;
+        if (!any_log_spec_parse(p, &spec) || count + spec.stars + 1 > ANY_LOG_SITE_ARGS) {
+            site->count = ANY_LOG_SITE_TEXT;
+            return;
+        }
+
+        for (int i = 0; i < spec.stars; i++)
+            site->types[count++] = ANY_LOG_ARG_INT;
+        if (spec.type != ANY_LOG_ARG_NONE)
+            site->types[count++] = (uint8_t)spec.type;
+
+        p = spec.end;
+    }
+
+    site->count = (uint8_t)count;
+}
+
+static pthread_mutex_t any_log_site_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t any_log_site_count;
+
+// Assign an id to a site the first time it is used and write its record
+// once in every log
+static void any_log_site_register(any_log_site_t *site, any_log_level_t level, const char *module,
+                                  const char *func, const char *format)
+{
+    const size_t lengths[3] = { strlen(module), strlen(func), strlen(format) };
+
+    pthread_mutex_lock(&any_log_site_mutex);
+
+    if (site->id == 0) {
+        any_log_site_parse(site, format);
+        if (ANY_LOG_BINARY_SITE_HEADER + lengths[0] + lengths[1] + lengths[2] > ANY_LOG_RECORD_SIZE)
+            site->count = ANY_LOG_SITE_TEXT;
+
+        site->id = ++any_log_site_count;
+    }
+
+    if (site->epoch != any_log_binary_epoch && site->count != ANY_LOG_SITE_TEXT) {
+        uint8_t record[ANY_LOG_RECORD_SIZE];
+
+        record[0] = ANY_LOG_BINARY_SITE;
+        memcpy(record + 1, &site->id, 4);
+        record[5] = (uint8_t)level;
+
+        size_t length = ANY_LOG_BINARY_SITE_HEADER;
+        const char *strings[3] = { module, func, format };
+
+        for (int i = 0; i < 3; i++) {
+            const uint16_t size = (uint16_t)lengths[i];
+            memcpy(record + 6 + 2 * i, &size, 2);
+            memcpy(record + length, strings[i], lengths[i]);
+            length += lengths[i];
+        }
+
+        any_log_write(record, length);
+    }
+
+    __atomic_store_n(&site->epoch, any_log_binary_epoch, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&any_log_site_mutex);
+}
+
+// Write the record of a call, copying the arguments as they are
+static void any_log_binary_record(const any_log_site_t *site, va_list args)
+{
+    uint8_t record[ANY_LOG_RECORD_SIZE];
+    size_t length = ANY_LOG_BINARY_RECORD_HEADER;
+    int star = -1;
+
+    for (int i = 0; i < site->count; i++) {
+        int64_t integer;
+        double real;
+        uint64_t pointer;
+
+        switch (site->types[i]) {
+        case ANY_LOG_ARG_INT:
+            integer = va_arg(args, int);
+            star = (int)integer;
+            memcpy(record + length, &integer, 8);
+            break;
+        case ANY_LOG_ARG_LONG:
+            integer = va_arg(args, long);
+            memcpy(record + length, &integer, 8);
+            break;
+        case ANY_LOG_ARG_LLONG:
+            integer = va_arg(args, long long);
+            memcpy(record + length, &integer, 8);
+            break;
+        case ANY_LOG_ARG_SIZE:
+            integer = (int64_t)va_arg(args, size_t);
+            memcpy(record + length, &integer, 8);
+            break;
+        case ANY_LOG_ARG_INTMAX:
+            integer = (int64_t)va_arg(args, intmax_t);
+            memcpy(record + length, &integer, 8);
+            break;
+        case ANY_LOG_ARG_PTRDIFF:
+            integer = (int64_t)va_arg(args, ptrdiff_t);
+            memcpy(record + length, &integer, 8);
+            break;
+        case ANY_LOG_ARG_DOUBLE:
+            real = va_arg(args, double);
+            memcpy(record + length, &real, 8);
+            break;
+        case ANY_LOG_ARG_LDOUBLE:
+            real = (double)va_arg(args, long double);
+            memcpy(record + length, &real, 8);
+            break;
+        case ANY_LOG_ARG_PTR:
+            pointer = (uint64_t)(uintptr_t)va_arg(args, void *);
+            memcpy(record + length, &pointer, 8);
+            break;
+        default: {
+            const char *string = va_arg(args, const char *);
+            if (string == NULL)
+                string = "(null)";
+
+            size_t size = site->types[i] == ANY_LOG_ARG_STRING_STAR && star >= 0
+                ? strnlen(string, (size_t)star) : strlen(string);
+
+            // Truncate the string to leave space for the other arguments
+            const size_t space = ANY_LOG_RECORD_SIZE - length - 4 - (size_t)(site->count - i - 1) * 12;
+            if (size > space)
+                size = space;
+
+            const uint32_t size32 = (uint32_t)size;
+            memcpy(record + length, &size32, 4);
+            memcpy(record + length + 4, string, size);
+            length += 4 + size - 8;
+            break;
+        }
+        }
+
+        length += 8;
+    }
+
+    const uint64_t time = any_log_time();
+    const uint32_t size = (uint32_t)(length - ANY_LOG_BINARY_RECORD_HEADER);
+
+    record[0] = ANY_LOG_BINARY_RECORD;
+    memcpy(record + 1, &site->id, 4);
+    memcpy(record + 5, &time, 8);
+    memcpy(record + 13, &size, 4);
+
+    any_log_write(record, length);
+}
+
+void any_log_init_binary(FILE *stream, any_log_level_t level)
+{
+    any_log_init(stream, level);
+
+    uint8_t header[ANY_LOG_BINARY_FILE_HEADER] = {
+        ANY_LOG_BINARY_HEADER, 'A', 'N', 'Y', '_', 'L', 'O', 'G', ANY_LOG_BINARY_VERSION
+    };
+    const uint32_t order = ANY_LOG_BINARY_ORDER;
+    memcpy(header + 9, &order, 4);
+    any_log_write(header, sizeof(header));
+
+    pthread_mutex_lock(&any_log_site_mutex);
+    any_log_binary_epoch++;
+    pthread_mutex_unlock(&any_log_site_mutex);
+
+    any_log_binary_on = 1;
+}
+
+#endif
+
+void any_log_format_site(any_log_site_t *site, any_log_level_t level, const char *module,
+                         const char *func, const char *format, ...)
+{
+    if (!any_log_site_enabled(site, level, module))
+        return;
 
     va_list args;
     va_start(args, format);
-    vfprintf(any_log_stream, format, args);
+
+#ifndef ANY_LOG_NO_BINARY
+    if (any_log_binary_on) {
+        if (__atomic_load_n(&site->epoch, __ATOMIC_ACQUIRE) != any_log_binary_epoch)
+            any_log_site_register(site, level, module, func, format);
+
+        if (site->count != ANY_LOG_SITE_TEXT) {
+            any_log_binary_record(site, args);
+            va_end(args);
+            return;
+        }
+    }
+#endif
+
+    any_log_vformat(site, level, module, func, format, args);
     va_end(args);
+}
 
-    fprintf(any_log_stream, ANY_LOG_FORMAT_AFTER(level, module, func));
+#ifndef ANY_LOG_NO_BINARY
 
-    // NOTE: Suppress compiler warning if the user customizes the format string
-    //       and doesn't use these values in it
-    (void)module;
-    (void)func;
+typedef struct {
+    any_log_level_t level;
+    const char *module;
+    const char *func;
+    const char *format;
+    size_t lengths[3];
+} any_log_decode_site_t;
+
+// Print the timestamp of a record
+static void any_log_decode_time(FILE *stream, uint64_t time)
+{
+    const time_t seconds = (time_t)(time / 1000000000u);
+    struct tm tm;
+    char buffer[32];
+
+    localtime_r(&seconds, &tm);
+    strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &tm);
+    fprintf(stream, "%s.%09u ", buffer, (unsigned)(time % 1000000000u));
+}
+
+// Print the message of a log record, with the arguments in args. Return
+// false if the arguments don't match the format
+static bool any_log_decode_message(FILE *stream, const char *format, size_t length,
+                                   const uint8_t *args, size_t size)
+{
+    // The format is not terminated in the log
+    char *text = (char *)malloc(length + 1);
+    char *string = (char *)malloc(ANY_LOG_RECORD_SIZE + 1);
+    bool valid = text != NULL && string != NULL;
+
+    if (valid) {
+        memcpy(text, format, length);
+        text[length] = '\0';
+    }
+
+    const uint8_t *end = args + size;
+    const char *p = text;
+
+    while (valid && *p != '\0') {
+        if (*p != '%') {
+            fputc(*p++, stream);
+            continue;
+        }
+
+        any_log_spec_t spec;
+        if (!any_log_spec_parse(p, &spec)) {
+            valid = false;
+            break;
+        }
+
+        // Replace the asterisks with their values
+        char conversion[ANY_LOG_SPEC_SIZE];
+        size_t n = 0;
+
+        for (const char *q = p; q < spec.end; q++) {
+            if (*q != '*') {
+                conversion[n++] = *q;
+                continue;
+            }
+
+            int64_t value;
+            if (end - args < 8) {
+                valid = false;
+                break;
+            }
+            memcpy(&value, args, 8);
+            args += 8;
+
+            // A negative precision is like no precision
+            if (value < 0 && n > 0 && conversion[n - 1] == '.')
+                n--;
+            else
+                n += (size_t)snprintf(conversion + n, sizeof(conversion) - n, "%d", (int)value);
+        }
+        conversion[n] = '\0';
+
+        if (!valid)
+            break;
+
+        int64_t integer = 0;
+        double real = 0;
+        uint64_t pointer = 0;
+
+        if (spec.type == ANY_LOG_ARG_STRING || spec.type == ANY_LOG_ARG_STRING_STAR) {
+            uint32_t string_length;
+            if (end - args < 4) {
+                valid = false;
+                break;
+            }
+            memcpy(&string_length, args, 4);
+            if (string_length > ANY_LOG_RECORD_SIZE || (size_t)(end - args - 4) < string_length) {
+                valid = false;
+                break;
+            }
+            memcpy(string, args + 4, string_length);
+            string[string_length] = '\0';
+            args += 4 + string_length;
+        } else if (spec.type != ANY_LOG_ARG_NONE) {
+            if (end - args < 8) {
+                valid = false;
+                break;
+            }
+            memcpy(&integer, args, 8);
+            memcpy(&real, args, 8);
+            memcpy(&pointer, args, 8);
+            args += 8;
+        }
+
+        switch (spec.type) {
+        case ANY_LOG_ARG_NONE: fputc('%', stream); break;
+        case ANY_LOG_ARG_INT: fprintf(stream, conversion, (int)integer); break;
+        case ANY_LOG_ARG_LONG: fprintf(stream, conversion, (long)integer); break;
+        case ANY_LOG_ARG_LLONG: fprintf(stream, conversion, (long long)integer); break;
+        case ANY_LOG_ARG_SIZE: fprintf(stream, conversion, (size_t)integer); break;
+        case ANY_LOG_ARG_INTMAX: fprintf(stream, conversion, (intmax_t)integer); break;
+        case ANY_LOG_ARG_PTRDIFF: fprintf(stream, conversion, (ptrdiff_t)integer); break;
+        case ANY_LOG_ARG_DOUBLE: fprintf(stream, conversion, real); break;
+        case ANY_LOG_ARG_LDOUBLE: fprintf(stream, conversion, (long double)real); break;
+        case ANY_LOG_ARG_PTR: fprintf(stream, conversion, (void *)(uintptr_t)pointer); break;
+        default: fprintf(stream, conversion, string); break;
+        }
+
+        p = spec.end;
+    }
+
+    free(text);
+    free(string);
+    return valid && args == end;
+}
+
+bool any_log_decode(const void *data, size_t length, FILE *stream, bool timestamps)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    any_log_decode_site_t *sites = NULL;
+    size_t site_count = 0;
+    bool valid = length >= ANY_LOG_BINARY_FILE_HEADER && bytes[0] == ANY_LOG_BINARY_HEADER;
+
+    // The sites are collected first, since with many threads the record of
+    // a site can follow the records that use it
+    for (size_t i = 0; valid && i < length;) {
+        const size_t left = length - i;
+        const uint8_t tag = bytes[i];
+        uint32_t size;
+
+        if (tag == ANY_LOG_BINARY_HEADER) {
+            uint32_t order;
+            if (left < ANY_LOG_BINARY_FILE_HEADER)
+                break;
+            memcpy(&order, bytes + i + 9, 4);
+            valid = memcmp(bytes + i + 1, "ANY_LOG", 7) == 0
+                && bytes[i + 8] == ANY_LOG_BINARY_VERSION && order == ANY_LOG_BINARY_ORDER;
+            i += ANY_LOG_BINARY_FILE_HEADER;
+        } else if (tag == ANY_LOG_BINARY_SITE) {
+            uint32_t id;
+            uint16_t lengths[3];
+            if (left < ANY_LOG_BINARY_SITE_HEADER)
+                break;
+            memcpy(&id, bytes + i + 1, 4);
+            memcpy(lengths, bytes + i + 6, 6);
+
+            const size_t total = ANY_LOG_BINARY_SITE_HEADER + (size_t)lengths[0] + lengths[1] + lengths[2];
+            if (left < total || id == 0 || bytes[i + 5] >= ANY_LOG_ALL) {
+                valid = false;
+                break;
+            }
+
+            if (id > site_count) {
+                any_log_decode_site_t *grown = (any_log_decode_site_t *)
+                    realloc(sites, (size_t)id * 2 * sizeof(any_log_decode_site_t));
+                if (grown == NULL) {
+                    valid = false;
+                    break;
+                }
+                memset(grown + site_count, 0, ((size_t)id * 2 - site_count) * sizeof(any_log_decode_site_t));
+                sites = grown;
+                site_count = (size_t)id * 2;
+            }
+
+            any_log_decode_site_t *site = &sites[id - 1];
+            const char *strings = (const char *)bytes + i + ANY_LOG_BINARY_SITE_HEADER;
+            site->level = (any_log_level_t)bytes[i + 5];
+            site->module = strings;
+            site->func = strings + lengths[0];
+            site->format = strings + lengths[0] + lengths[1];
+            for (int j = 0; j < 3; j++)
+                site->lengths[j] = lengths[j];
+
+            i += total;
+        } else if (tag == ANY_LOG_BINARY_RECORD) {
+            if (left < ANY_LOG_BINARY_RECORD_HEADER)
+                break;
+            memcpy(&size, bytes + i + 13, 4);
+            i += ANY_LOG_BINARY_RECORD_HEADER + (size_t)size;
+        } else if (tag == ANY_LOG_BINARY_TEXT) {
+            if (left < ANY_LOG_BINARY_TEXT_HEADER)
+                break;
+            memcpy(&size, bytes + i + 9, 4);
+            i += ANY_LOG_BINARY_TEXT_HEADER + (size_t)size;
+        } else {
+            valid = false;
+        }
+    }
+
+    // A record cut at the end of the log (like after a crash) is ignored
+    for (size_t i = 0; valid && i < length;) {
+        const size_t left = length - i;
+        const uint8_t tag = bytes[i];
+        uint64_t time;
+        uint32_t id, size;
+
+        if (tag == ANY_LOG_BINARY_HEADER) {
+            i += ANY_LOG_BINARY_FILE_HEADER;
+        } else if (tag == ANY_LOG_BINARY_SITE) {
+            uint16_t lengths[3];
+            if (left < ANY_LOG_BINARY_SITE_HEADER)
+                break;
+            memcpy(lengths, bytes + i + 6, 6);
+            i += ANY_LOG_BINARY_SITE_HEADER + (size_t)lengths[0] + lengths[1] + lengths[2];
+        } else if (tag == ANY_LOG_BINARY_RECORD) {
+            if (left < ANY_LOG_BINARY_RECORD_HEADER)
+                break;
+            memcpy(&id, bytes + i + 1, 4);
+            memcpy(&time, bytes + i + 5, 8);
+            memcpy(&size, bytes + i + 13, 4);
+            if (left - ANY_LOG_BINARY_RECORD_HEADER < size)
+                break;
+
+            if (id == 0 || id > site_count || sites[id - 1].format == NULL) {
+                valid = false;
+                break;
+            }
+
+            const any_log_decode_site_t *site = &sites[id - 1];
+            const any_log_level_t level = site->level;
+            const int module_length = (int)site->lengths[0], func_length = (int)site->lengths[1];
+
+            // The module and the function are not terminated in the log
+            char *strings = (char *)malloc(site->lengths[0] + site->lengths[1] + 2);
+            if (strings == NULL) {
+                valid = false;
+                break;
+            }
+            snprintf(strings, site->lengths[0] + 1, "%.*s", module_length, site->module);
+            snprintf(strings + site->lengths[0] + 1, site->lengths[1] + 1, "%.*s", func_length, site->func);
+            const char *module = strings, *func = strings + site->lengths[0] + 1;
+
+            if (timestamps)
+                any_log_decode_time(stream, time);
+
+            fprintf(stream, ANY_LOG_FORMAT_BEFORE(level, module, func));
+            valid = any_log_decode_message(stream, site->format, site->lengths[2],
+                                           bytes + i + ANY_LOG_BINARY_RECORD_HEADER, size);
+            fprintf(stream, ANY_LOG_FORMAT_AFTER(level, module, func));
+
+            (void)level;
+            (void)module;
+            (void)func;
+            free(strings);
+            i += ANY_LOG_BINARY_RECORD_HEADER + (size_t)size;
+        } else {
+            if (left < ANY_LOG_BINARY_TEXT_HEADER)
+                break;
+            memcpy(&time, bytes + i + 1, 8);
+            memcpy(&size, bytes + i + 9, 4);
+            if (left - ANY_LOG_BINARY_TEXT_HEADER < size)
+                break;
+
+            if (timestamps)
+                any_log_decode_time(stream, time);
+
+            fwrite(bytes + i + ANY_LOG_BINARY_TEXT_HEADER, 1, size, stream);
+            i += ANY_LOG_BINARY_TEXT_HEADER + (size_t)size;
+        }
+    }
+
+    free(sites);
+    return valid;
 }
 
+#endif
+
 // This is used in the parsing of the type specifier from the key
 //
 // NOTE: It must be a character
@@ -495,21 +2622,38 @@ void any_log_format(any_log_level_t level, const char *module,
 // NOTE: C automatically promotes boolean types to int
 #ifndef ANY_LOG_VALUE_BOOL
 #define ANY_LOG_VALUE_BOOL(key, value) "%s=%s", key, (value ? "true" : "false")
+#define ANY_LOG_VALUE_BOOL_DEFAULT
 #endif
 
 // Format for pairs with an int value
 #ifndef ANY_LOG_VALUE_INT
 #define ANY_LOG_VALUE_INT(key, value) "%s=%d", key, value
+#define ANY_LOG_VALUE_INT_DEFAULT
 #endif
 
 // Format for pairs with an unsinged int value (hex by default)
 #ifndef ANY_LOG_VALUE_HEX
 #define ANY_LOG_VALUE_HEX(key, value) "%s=%#x", key, value
+#define ANY_LOG_VALUE_HEX_DEFAULT
 #endif
 
 // Format for pairs with a long int value
 #ifndef ANY_LOG_VALUE_LONG
 #define ANY_LOG_VALUE_LONG(key, value) "%s=%ld", key, value
+#define ANY_LOG_VALUE_LONG_DEFAULT
+#endif
+
+// Format for pairs with a long long int value (only ANY_LOG_PAIR)
+#ifndef ANY_LOG_VALUE_LLONG
+#define ANY_LOG_VALUE_LLONG(key, value) "%s=%lld", key, value
+#define ANY_LOG_VALUE_LLONG_DEFAULT
+#endif
+
+// Format for pairs with an unsigned long or unsigned long long value (hex
+// by default, only ANY_LOG_PAIR)
+#ifndef ANY_LOG_VALUE_ULLONG
+#define ANY_LOG_VALUE_ULLONG(key, value) "%s=%#llx", key, value
+#define ANY_LOG_VALUE_ULLONG_DEFAULT
 #endif
 
 // Format for pairs with a pointer value
@@ -525,6 +2669,7 @@ void any_log_format(any_log_level_t level, const char *module,
 // Format for pairs with a string value
 #ifndef ANY_LOG_VALUE_STRING
 #define ANY_LOG_VALUE_STRING(key, value) "%s=\"%s\"", key, value
+#define ANY_LOG_VALUE_STRING_DEFAULT
 #endif
 
 #ifndef ANY_LOG_NO_GENERIC
@@ -549,15 +2694,18 @@ void any_log_format(any_log_level_t level, const char *module,
 // This is used as a separator between different pairs
 #ifndef ANY_LOG_VALUE_PAIR_SEP
 #define ANY_LOG_VALUE_PAIR_SEP ", "
+#define ANY_LOG_VALUE_PAIR_SEP_DEFAULT
 #endif
 
 void any_log_value(any_log_level_t level, const char *module,
                    const char *func, const char *message, ...)
 {
-    if (level > any_log_level)
+    if (!any_log_module_enabled(level, module))
         return;
 
-    fprintf(any_log_stream, ANY_LOG_VALUE_BEFORE(level, module, func, message));
+    FILE *stream = any_log_begin();
+
+    fprintf(stream, ANY_LOG_VALUE_BEFORE(level, module, func, message));
 
     va_list args;
     va_start(args, message);
@@ -571,45 +2719,45 @@ void any_log_value(any_log_level_t level, const char *module,
             switch (tolower(key[-2])) {
                 case 'b': {
                     int value = va_arg(args, int);
-                    fprintf(any_log_stream, ANY_LOG_VALUE_BOOL(key, value));
+                    fprintf(stream, ANY_LOG_VALUE_BOOL(key, value));
                     break;
                 }
 
                 case 'd':
                 case 'i': {
                     int value = va_arg(args, int);
-                    fprintf(any_log_stream, ANY_LOG_VALUE_INT(key, value));
+                    fprintf(stream, ANY_LOG_VALUE_INT(key, value));
                     break;
                 }
 
                 case 'x':
                 case 'u': {
                     unsigned int value = va_arg(args, unsigned int);
-                    fprintf(any_log_stream, ANY_LOG_VALUE_HEX(key, value));
+                    fprintf(stream, ANY_LOG_VALUE_HEX(key, value));
                     break;
                 }
 
                 case 'l': {
                     long int value = va_arg(args, long int);
-                    fprintf(any_log_stream, ANY_LOG_VALUE_LONG(key, value));
+                    fprintf(stream, ANY_LOG_VALUE_LONG(key, value));
                     break;
                 }
 
                 case 'p': {
                     void *value = va_arg(args, void *);
-                    fprintf(any_log_stream, ANY_LOG_VALUE_PTR(key, value));
+                    fprintf(stream, ANY_LOG_VALUE_PTR(key, value));
                     break;
                 }
 
                 case 'f': {
                     double value = va_arg(args, double);
-                    fprintf(any_log_stream, ANY_LOG_VALUE_DOUBLE(key, value));
+                    fprintf(stream, ANY_LOG_VALUE_DOUBLE(key, value));
                     break;
                 }
 
                 case 's': {
                     char *value = va_arg(args, char *);
-                    fprintf(any_log_stream, ANY_LOG_VALUE_STRING(key, value));
+                    fprintf(stream, ANY_LOG_VALUE_STRING(key, value));
                     break;
                 }
 
@@ -617,7 +2765,7 @@ void any_log_value(any_log_level_t level, const char *module,
                 case 'g': {
                     any_log_formatter_t formatter = va_arg(args, any_log_formatter_t);
                     ANY_LOG_VALUE_GENERIC_TYPE value = va_arg(args, ANY_LOG_VALUE_GENERIC_TYPE);
-                    ANY_LOG_VALUE_GENERIC(key, any_log_stream, formatter, value);
+                    ANY_LOG_VALUE_GENERIC(key, stream, formatter, value);
                     break;
                 }
 #endif
@@ -627,18 +2775,280 @@ void any_log_value(any_log_level_t level, const char *module,
         } else {
 tdefault:
             ANY_LOG_VALUE_DEFAULT_TYPE value = va_arg(args, ANY_LOG_VALUE_DEFAULT_TYPE);
-            fprintf(any_log_stream, ANY_LOG_VALUE_DEFAULT(key, value));
+            fprintf(stream, ANY_LOG_VALUE_DEFAULT(key, value));
         }
 
         key = va_arg(args, char *);
         if (key == NULL)
             break;
 
-        fprintf(any_log_stream, ANY_LOG_VALUE_PAIR_SEP);
+        fprintf(stream, ANY_LOG_VALUE_PAIR_SEP);
     }
 
     va_end(args);
-    fprintf(any_log_stream, ANY_LOG_VALUE_AFTER(level, module, func, message));
+    fprintf(stream, ANY_LOG_VALUE_AFTER(level, module, func, message));
+    any_log_end(stream);
+
+    (void)module;
+    (void)func;
+    (void)message;
+}
+
+#if !defined(ANY_LOG_NO_ASYNC) && (defined(ANY_LOG_VALUE_BOOL_DEFAULT) || defined(ANY_LOG_VALUE_INT_DEFAULT) || \
+    defined(ANY_LOG_VALUE_HEX_DEFAULT) || defined(ANY_LOG_VALUE_LONG_DEFAULT) || \
+    defined(ANY_LOG_VALUE_LLONG_DEFAULT) || defined(ANY_LOG_VALUE_ULLONG_DEFAULT) || \
+    defined(ANY_LOG_VALUE_STRING_DEFAULT) || defined(ANY_LOG_VALUE_PAIR_SEP_DEFAULT))
+
+// Append bytes to the length bytes of text in a buffer, like
+// any_log_record_print
+static size_t any_log_record_append(char *text, size_t length, const char *data, size_t size)
+{
+    if (size > ANY_LOG_RECORD_SIZE - 1 - length)
+        size = ANY_LOG_RECORD_SIZE - 1 - length;
+
+    memcpy(text + length, data, size);
+    return length + size;
+}
+
+#endif
+
+#if !defined(ANY_LOG_NO_ASYNC) && (defined(ANY_LOG_VALUE_INT_DEFAULT) || defined(ANY_LOG_VALUE_HEX_DEFAULT) || \
+    defined(ANY_LOG_VALUE_LONG_DEFAULT) || defined(ANY_LOG_VALUE_LLONG_DEFAULT) || \
+    defined(ANY_LOG_VALUE_ULLONG_DEFAULT))
+
+// Append an integer in base 10 or 16 (with the prefix 0x, like %#x), like
+// any_log_record_print
+static size_t any_log_record_integer(char *text, size_t length, unsigned long long value, bool negative, int base)
+{
+    char digits[24];
+    size_t n = sizeof(digits);
+
+    do {
+        digits[--n] = "0123456789abcdef"[value % (unsigned)base];
+        value /= (unsigned)base;
+    } while (value != 0);
+
+    if (base == 16 && !(n == sizeof(digits) - 1 && digits[n] == '0')) {
+        digits[--n] = 'x';
+        digits[--n] = '0';
+    }
+
+    if (negative)
+        digits[--n] = '-';
+
+    return any_log_record_append(text, length, digits + n, sizeof(digits) - n);
+}
+
+#endif
+
+#if !defined(ANY_LOG_NO_ASYNC) && (defined(ANY_LOG_VALUE_BOOL_DEFAULT) || defined(ANY_LOG_VALUE_INT_DEFAULT) || \
+    defined(ANY_LOG_VALUE_HEX_DEFAULT) || defined(ANY_LOG_VALUE_LONG_DEFAULT) || \
+    defined(ANY_LOG_VALUE_LLONG_DEFAULT) || defined(ANY_LOG_VALUE_ULLONG_DEFAULT) || \
+    defined(ANY_LOG_VALUE_STRING_DEFAULT))
+
+// Append the key of a pair with the default formats
+static size_t any_log_record_pair_key(char *text, size_t length, const char *key)
+{
+    length = any_log_record_append(text, length, key, strlen(key));
+    return any_log_record_append(text, length, "=", 1);
+}
+
+#endif
+
+// Format a pair with the format of its type, on a stream or in the buffer
+// of the calling thread
+#ifndef ANY_LOG_NO_ASYNC
+#define ANY_LOG_PAIR_PRINT(format) \
+    (stream != NULL ? (void)fprintf(stream, format) : (void)(length = any_log_record_print(text, length, format)))
+#else
+#define ANY_LOG_PAIR_PRINT(format) fprintf(stream, format)
+#endif
+
+void any_log_pairs(any_log_level_t level, const char *module, const char *func,
+                   const char *message, const any_log_pair_t *pairs, size_t count)
+{
+    if (!any_log_module_enabled(level, module))
+        return;
+
+    FILE *stream = NULL;
+
+#ifndef ANY_LOG_NO_ASYNC
+    // Without custom types the pairs are formatted in the buffer without its
+    // stream, which is faster
+    any_log_record_t *record = any_log_record_get();
+    char *text = record != NULL ? record->buffer + ANY_LOG_BINARY_TEXT_HEADER : NULL;
+    size_t length = 0;
+
+    for (size_t i = 0; i < count && text != NULL; i++) {
+        if (pairs[i].type == ANY_LOG_PAIR_TYPE_GENERIC)
+            text = NULL;
+    }
+
+    if (text == NULL)
+        stream = any_log_begin();
+
+format:
+#else
+    stream = any_log_begin();
+#endif
+
+    ANY_LOG_PAIR_PRINT(ANY_LOG_VALUE_BEFORE(level, module, func, message));
+
+    for (size_t i = 0; i < count; i++) {
+        const char *key = pairs[i].key;
+
+        // With the default formats the values are appended without printf
+        // in the buffer
+#ifndef ANY_LOG_NO_ASYNC
+        const bool fast = stream == NULL;
+        (void)fast;
+#endif
+
+        if (i > 0) {
+#if defined(ANY_LOG_VALUE_PAIR_SEP_DEFAULT) && !defined(ANY_LOG_NO_ASYNC)
+            if (fast)
+                length = any_log_record_append(text, length, ", ", 2);
+            else
+#endif
+            ANY_LOG_PAIR_PRINT(ANY_LOG_VALUE_PAIR_SEP);
+        }
+
+        switch (pairs[i].type) {
+            case ANY_LOG_PAIR_TYPE_BOOL: {
+                int value = pairs[i].value.i;
+#if defined(ANY_LOG_VALUE_BOOL_DEFAULT) && !defined(ANY_LOG_NO_ASYNC)
+                if (fast) {
+                    length = any_log_record_pair_key(text, length, key);
+                    length = value ? any_log_record_append(text, length, "true", 4)
+                                   : any_log_record_append(text, length, "false", 5);
+                    break;
+                }
+#endif
+                ANY_LOG_PAIR_PRINT(ANY_LOG_VALUE_BOOL(key, value));
+                break;
+            }
+
+            case ANY_LOG_PAIR_TYPE_INT: {
+                int value = pairs[i].value.i;
+#if defined(ANY_LOG_VALUE_INT_DEFAULT) && !defined(ANY_LOG_NO_ASYNC)
+                if (fast) {
+                    length = any_log_record_pair_key(text, length, key);
+                    length = any_log_record_integer(text, length, value < 0 ? 0ull - (unsigned long long)value : (unsigned long long)value, value < 0, 10);
+                    break;
+                }
+#endif
+                ANY_LOG_PAIR_PRINT(ANY_LOG_VALUE_INT(key, value));
+                break;
+            }
+
+            case ANY_LOG_PAIR_TYPE_HEX: {
+                unsigned int value = pairs[i].value.u;
+#if defined(ANY_LOG_VALUE_HEX_DEFAULT) && !defined(ANY_LOG_NO_ASYNC)
+                if (fast) {
+                    length = any_log_record_pair_key(text, length, key);
+                    length = any_log_record_integer(text, length, value, false, 16);
+                    break;
+                }
+#endif
+                ANY_LOG_PAIR_PRINT(ANY_LOG_VALUE_HEX(key, value));
+                break;
+            }
+
+            case ANY_LOG_PAIR_TYPE_LONG: {
+                long int value = pairs[i].value.l;
+#if defined(ANY_LOG_VALUE_LONG_DEFAULT) && !defined(ANY_LOG_NO_ASYNC)
+                if (fast) {
+                    length = any_log_record_pair_key(text, length, key);
+                    length = any_log_record_integer(text, length, value < 0 ? 0ull - (unsigned long long)value : (unsigned long long)value, value < 0, 10);
+                    break;
+                }
+#endif
+                ANY_LOG_PAIR_PRINT(ANY_LOG_VALUE_LONG(key, value));
+                break;
+            }
+
+            case ANY_LOG_PAIR_TYPE_LLONG: {
+                long long value = pairs[i].value.ll;
+#if defined(ANY_LOG_VALUE_LLONG_DEFAULT) && !defined(ANY_LOG_NO_ASYNC)
+                if (fast) {
+                    length = any_log_record_pair_key(text, length, key);
+                    length = any_log_record_integer(text, length, value < 0 ? 0ull - (unsigned long long)value : (unsigned long long)value, value < 0, 10);
+                    break;
+                }
+#endif
+                ANY_LOG_PAIR_PRINT(ANY_LOG_VALUE_LLONG(key, value));
+                break;
+            }
+
+            case ANY_LOG_PAIR_TYPE_ULLONG: {
+                unsigned long long value = pairs[i].value.ull;
+#if defined(ANY_LOG_VALUE_ULLONG_DEFAULT) && !defined(ANY_LOG_NO_ASYNC)
+                if (fast) {
+                    length = any_log_record_pair_key(text, length, key);
+                    length = any_log_record_integer(text, length, value, false, 16);
+                    break;
+                }
+#endif
+                ANY_LOG_PAIR_PRINT(ANY_LOG_VALUE_ULLONG(key, value));
+                break;
+            }
+
+            case ANY_LOG_PAIR_TYPE_PTR: {
+                void *value = (void *)pairs[i].value.p;
+                ANY_LOG_PAIR_PRINT(ANY_LOG_VALUE_PTR(key, value));
+                break;
+            }
+
+            case ANY_LOG_PAIR_TYPE_DOUBLE: {
+                double value = pairs[i].value.f;
+                ANY_LOG_PAIR_PRINT(ANY_LOG_VALUE_DOUBLE(key, value));
+                break;
+            }
+
+            case ANY_LOG_PAIR_TYPE_STRING: {
+                char *value = (char *)pairs[i].value.s;
+#if defined(ANY_LOG_VALUE_STRING_DEFAULT) && !defined(ANY_LOG_NO_ASYNC)
+                if (fast && value != NULL) {
+                    length = any_log_record_pair_key(text, length, key);
+                    length = any_log_record_append(text, length, "\"", 1);
+                    length = any_log_record_append(text, length, value, strlen(value));
+                    length = any_log_record_append(text, length, "\"", 1);
+                    break;
+                }
+#endif
+                ANY_LOG_PAIR_PRINT(ANY_LOG_VALUE_STRING(key, value));
+                break;
+            }
+
+#ifndef ANY_LOG_NO_GENERIC
+            case ANY_LOG_PAIR_TYPE_GENERIC: {
+                any_log_formatter_t formatter = pairs[i].value.g.formatter;
+                ANY_LOG_VALUE_GENERIC_TYPE value = pairs[i].value.g.value;
+                ANY_LOG_VALUE_GENERIC(key, stream, formatter, value);
+                break;
+            }
+#endif
+            default:
+                break;
+        }
+    }
+
+    ANY_LOG_PAIR_PRINT(ANY_LOG_VALUE_AFTER(level, module, func, message));
+
+#ifndef ANY_LOG_NO_ASYNC
+    if (stream == NULL) {
+        // A record that fills the buffer is formatted again on the stream
+        if (length >= ANY_LOG_RECORD_SIZE - 1) {
+            stream = any_log_begin();
+            goto format;
+        }
+
+        any_log_record_write(text, length);
+        return;
+    }
+#endif
+
+    any_log_end(stream);
 
     (void)module;
     (void)func;
@@ -676,14 +3086,20 @@ tdefault:
 void any_log_panic(const char *file, int line, const char *module,
                    const char *func, const char *format, ...)
 {
-    fprintf(any_log_stream, ANY_LOG_PANIC_BEFORE(file, line, module, func));
+    FILE *stream = any_log_begin();
+
+    fprintf(stream, ANY_LOG_PANIC_BEFORE(file, line, module, func));
 
     va_list args;
     va_start(args, format);
-    vfprintf(any_log_stream, format, args);
+    vfprintf(stream, format, args);
     va_end(args);
 
-    fprintf(any_log_stream, ANY_LOG_PANIC_AFTER(file, line, module, func));
+    fprintf(stream, ANY_LOG_PANIC_AFTER(file, line, module, func));
+    any_log_end(stream);
+
+    // Make sure that the record is written before terminating
+    any_log_flush();
 
     (void)module;
     (void)func;
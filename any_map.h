@@ -0,0 +1,604 @@
+// any_map
+//
+// A single-file library that provides an open addressing hash map in the
+// style of the Swiss tables, with string and integer keys, built on any_hash.
+//
+// To use this library you should choose a suitable file to put the
+// implementation and define ANY_MAP_IMPLEMENT. For example
+//
+//    #define ANY_HASH_IMPLEMENT
+//    #include "any_hash.h"
+//
+//    #define ANY_MAP_IMPLEMENT
+//    #include "any_map.h"
+//
+// The keys are hashed with any_hash, so its implementation must be included
+// in some file of the project as well (not necessarily the same).
+//
+// Additionally, you can customize the library behavior by defining certain
+// macros in the file where you put the implementation. You can see which are
+// supported by reading the code guarded by ANY_MAP_IMPLEMENT.
+//
+// This library is licensed under the terms of the MIT license.
+// A copy of the license is included at the end of this file.
+//
+
+// How does it work?
+//
+// Every slot of the table has a control byte, that is either empty (0x80)
+// or holds the lowest 7 bits of the hash of the key in the slot. A lookup
+// compares 16 control bytes at once with the ones of the key (with SSE2,
+// if available) and compares the keys only for the slots that match, which
+// are almost always the right one.
+//
+// The slots are probed linearly from the position given by the hash, so a
+// key is always found before the first empty slot. This allows to delete the
+// keys by moving back the following ones of the cluster, instead of leaving
+// tombstones that slow down the lookups and require rehashing the table.
+//
+// The table grows when it is 7/8 full.
+//
+
+#ifndef ANY_MAP_INCLUDE
+#define ANY_MAP_INCLUDE
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "any_hash.h"
+
+// The string keys are not copied, they must outlive the map (or their
+// removal from it). The hash of the key is kept in the slot, so that the
+// table can grow without hashing the keys again.
+//
+typedef struct {
+    const char *key;
+    size_t length;
+    uint64_t hash;
+    void *value;
+} any_map_str_slot_t;
+
+typedef struct {
+    uint8_t *ctrl;
+    any_map_str_slot_t *slots;
+    size_t capacity;
+    size_t count;
+    uint64_t seed;
+} any_map_str_t;
+
+// Initialize an empty map, the seed is used for hashing the keys.
+// No memory is allocated until the first key is inserted.
+//
+void any_map_str_init(any_map_str_t *map, uint64_t seed);
+
+void any_map_str_free(any_map_str_t *map);
+
+// Make room for count keys, so that they can be inserted without growing
+// the table. This function returns false if the allocation fails.
+//
+bool any_map_str_reserve(any_map_str_t *map, size_t count);
+
+// Insert a key or replace its value. This function returns false if
+// the allocation fails.
+//
+bool any_map_str_put(any_map_str_t *map, const char *key, size_t length, void *value);
+
+// Find a key and store its value in value (if not NULL).
+// This function returns false if the key is not in the map.
+//
+bool any_map_str_get(const any_map_str_t *map, const char *key, size_t length, void **value);
+
+// Remove a key, returning false if it was not in the map.
+//
+bool any_map_str_remove(any_map_str_t *map, const char *key, size_t length);
+
+// Iterate over the slots of the map, in no particular order. For example
+//
+//    size_t iter = 0;
+//    any_map_str_slot_t *slot;
+//
+//    while ((slot = any_map_str_next(&map, &iter)) != NULL)
+//        printf("%.*s\n", (int)slot->length, slot->key);
+//
+// NOTE: Removing a key moves the following ones, so the map must not be
+//       modified during the iteration
+//
+any_map_str_slot_t *any_map_str_next(const any_map_str_t *map, size_t *iter);
+
+typedef struct {
+    uint64_t key;
+    void *value;
+} any_map_int_slot_t;
+
+typedef struct {
+    uint8_t *ctrl;
+    any_map_int_slot_t *slots;
+    size_t capacity;
+    size_t count;
+    uint64_t seed;
+} any_map_int_t;
+
+// The same functions of the string map, for integer keys.
+// The keys are hashed with any_hash_xxh64_u64.
+//
+void any_map_int_init(any_map_int_t *map, uint64_t seed);
+
+void any_map_int_free(any_map_int_t *map);
+
+bool any_map_int_reserve(any_map_int_t *map, size_t count);
+
+bool any_map_int_put(any_map_int_t *map, uint64_t key, void *value);
+
+bool any_map_int_get(const any_map_int_t *map, uint64_t key, void **value);
+
+bool any_map_int_remove(any_map_int_t *map, uint64_t key);
+
+any_map_int_slot_t *any_map_int_next(const any_map_int_t *map, size_t *iter);
+
+#endif
+
+#ifdef ANY_MAP_IMPLEMENT
+
+#include <string.h>
+
+// The tables are allocated with ANY_MAP_MALLOC and freed with ANY_MAP_FREE.
+// You can change allocation strategy by defining these macros in the
+// implementation file like so
+//
+//    #define ANY_MAP_IMPLEMENT
+//    #define ANY_MAP_MALLOC my_malloc
+//    #define ANY_MAP_FREE my_free
+//    #include "any_map.h"
+//
+#ifndef ANY_MAP_MALLOC
+#include <stdlib.h>
+#define ANY_MAP_MALLOC malloc
+#define ANY_MAP_FREE free
+#endif
+
+// You can define ANY_MAP_NO_SSE2 to use the portable group matching
+// even if SSE2 is available.
+//
+#if !defined(ANY_MAP_NO_SSE2) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define ANY_MAP_SSE2
+#include <emmintrin.h>
+#endif
+
+#define ANY_MAP_EMPTY 0x80
+#define ANY_MAP_GROUP 16
+#define ANY_MAP_MIN_CAPACITY 16
+
+// The bits of the hash used for the control bytes, the others give the
+// position of the key
+#define ANY_MAP_H2(hash) ((uint8_t)((hash) & 0x7f))
+#define ANY_MAP_H1(hash) ((size_t)((hash) >> 7))
+
+#define ANY_MAP_MAX_LOAD(capacity) ((capacity) - (capacity) / 8)
+
+#ifdef __GNUC__
+#define ANY_MAP_CTZ(mask) __builtin_ctz(mask)
+#else
+#define ANY_MAP_CTZ(mask) any_map_ctz(mask)
+
+static inline int any_map_ctz(uint32_t mask)
+{
+    int bits = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        bits++;
+    }
+    return bits;
+}
+#endif
+
+// Compare a group of control bytes, returning a bit for each one that is
+// equal to h2 (or is empty)
+#ifdef ANY_MAP_SSE2
+
+static inline uint32_t any_map_match(const uint8_t *ctrl, uint8_t h2)
+{
+    const __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)h2)));
+}
+
+// Only the empty control bytes have the high bit set
+static inline uint32_t any_map_match_empty(const uint8_t *ctrl)
+{
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+}
+
+#else
+
+static inline uint32_t any_map_match(const uint8_t *ctrl, uint8_t h2)
+{
+    uint32_t mask = 0;
+    for (int i = 0; i < ANY_MAP_GROUP; i++)
+        mask |= (uint32_t)(ctrl[i] == h2) << i;
+    return mask;
+}
+
+static inline uint32_t any_map_match_empty(const uint8_t *ctrl)
+{
+    uint32_t mask = 0;
+    for (int i = 0; i < ANY_MAP_GROUP; i++)
+        mask |= (uint32_t)(ctrl[i] >> 7) << i;
+    return mask;
+}
+
+#endif
+
+// The first control bytes are cloned after the end of the table, so that
+// a group can be loaded from any position without wrapping around
+static inline void any_map_set_ctrl(uint8_t *ctrl, size_t capacity, size_t index, uint8_t h2)
+{
+    ctrl[index] = h2;
+    if (index < ANY_MAP_GROUP - 1)
+        ctrl[capacity + index] = h2;
+}
+
+// Find the first empty slot from the position of the hash
+static inline size_t any_map_find_empty(const uint8_t *ctrl, size_t capacity, uint64_t hash)
+{
+    const size_t mask = capacity - 1;
+    size_t pos = ANY_MAP_H1(hash) & mask;
+
+    for (;;) {
+        const uint32_t empty = any_map_match_empty(ctrl + pos);
+        if (empty != 0)
+            return (pos + ANY_MAP_CTZ(empty)) & mask;
+
+        pos = (pos + ANY_MAP_GROUP) & mask;
+    }
+}
+
+// The smallest power of two capacity that holds count keys
+static size_t any_map_capacity(size_t count)
+{
+    size_t capacity = ANY_MAP_MIN_CAPACITY;
+    while (ANY_MAP_MAX_LOAD(capacity) < count) {
+        if (capacity > SIZE_MAX / 4)
+            return 0;
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+// The slots and the control bytes are allocated in a single block
+static void *any_map_alloc(size_t capacity, size_t slot_size, uint8_t **ctrl)
+{
+    if (capacity > (SIZE_MAX - ANY_MAP_GROUP) / (slot_size + 1))
+        return NULL;
+
+    uint8_t *slots = (uint8_t *)ANY_MAP_MALLOC(capacity * slot_size + capacity + ANY_MAP_GROUP);
+    if (slots == NULL)
+        return NULL;
+
+    *ctrl = slots + capacity * slot_size;
+    memset(*ctrl, ANY_MAP_EMPTY, capacity + ANY_MAP_GROUP);
+    return slots;
+}
+
+// String keys
+
+static inline bool any_map_str_equal(const any_map_str_slot_t *slot, const char *key,
+                                     size_t length, uint64_t hash)
+{
+    return slot->hash == hash && slot->length == length && memcmp(slot->key, key, length) == 0;
+}
+
+// Return the index of the key or SIZE_MAX if it is not in the map
+static size_t any_map_str_find(const any_map_str_t *map, const char *key, size_t length, uint64_t hash)
+{
+    if (map->count == 0)
+        return SIZE_MAX;
+
+    const size_t mask = map->capacity - 1;
+    const uint8_t h2 = ANY_MAP_H2(hash);
+    size_t pos = ANY_MAP_H1(hash) & mask;
+
+    for (;;) {
+        uint32_t match = any_map_match(map->ctrl + pos, h2);
+        while (match != 0) {
+            const size_t index = (pos + ANY_MAP_CTZ(match)) & mask;
+            if (any_map_str_equal(&map->slots[index], key, length, hash))
+                return index;
+            match &= match - 1;
+        }
+
+        if (any_map_match_empty(map->ctrl + pos) != 0)
+            return SIZE_MAX;
+
+        pos = (pos + ANY_MAP_GROUP) & mask;
+    }
+}
+
+static bool any_map_str_resize(any_map_str_t *map, size_t capacity)
+{
+    uint8_t *ctrl;
+    any_map_str_slot_t *slots = (any_map_str_slot_t *)any_map_alloc(capacity, sizeof(any_map_str_slot_t), &ctrl);
+    if (slots == NULL)
+        return false;
+
+    for (size_t i = 0; i < map->capacity; i++) {
+        if (map->ctrl[i] & ANY_MAP_EMPTY)
+            continue;
+
+        const uint64_t hash = map->slots[i].hash;
+        const size_t index = any_map_find_empty(ctrl, capacity, hash);
+        any_map_set_ctrl(ctrl, capacity, index, ANY_MAP_H2(hash));
+        slots[index] = map->slots[i];
+    }
+
+    ANY_MAP_FREE(map->slots);
+    map->ctrl = ctrl;
+    map->slots = slots;
+    map->capacity = capacity;
+    return true;
+}
+
+void any_map_str_init(any_map_str_t *map, uint64_t seed)
+{
+    map->ctrl = NULL;
+    map->slots = NULL;
+    map->capacity = 0;
+    map->count = 0;
+    map->seed = seed;
+}
+
+void any_map_str_free(any_map_str_t *map)
+{
+    ANY_MAP_FREE(map->slots);
+    any_map_str_init(map, map->seed);
+}
+
+bool any_map_str_reserve(any_map_str_t *map, size_t count)
+{
+    if (count <= ANY_MAP_MAX_LOAD(map->capacity))
+        return true;
+
+    const size_t capacity = any_map_capacity(count);
+    return capacity != 0 && any_map_str_resize(map, capacity);
+}
+
+bool any_map_str_put(any_map_str_t *map, const char *key, size_t length, void *value)
+{
+    const uint64_t hash = any_hash_xxh64((const uint8_t *)key, length, map->seed);
+
+    size_t index = any_map_str_find(map, key, length, hash);
+    if (index != SIZE_MAX) {
+        map->slots[index].value = value;
+        return true;
+    }
+
+    if (!any_map_str_reserve(map, map->count + 1))
+        return false;
+
+    index = any_map_find_empty(map->ctrl, map->capacity, hash);
+    any_map_set_ctrl(map->ctrl, map->capacity, index, ANY_MAP_H2(hash));
+    map->slots[index].key = key;
+    map->slots[index].length = length;
+    map->slots[index].hash = hash;
+    map->slots[index].value = value;
+    map->count++;
+    return true;
+}
+
+bool any_map_str_get(const any_map_str_t *map, const char *key, size_t length, void **value)
+{
+    const uint64_t hash = any_hash_xxh64((const uint8_t *)key, length, map->seed);
+
+    const size_t index = any_map_str_find(map, key, length, hash);
+    if (index == SIZE_MAX)
+        return false;
+
+    if (value != NULL)
+        *value = map->slots[index].value;
+    return true;
+}
+
+bool any_map_str_remove(any_map_str_t *map, const char *key, size_t length)
+{
+    const uint64_t hash = any_hash_xxh64((const uint8_t *)key, length, map->seed);
+
+    size_t index = any_map_str_find(map, key, length, hash);
+    if (index == SIZE_MAX)
+        return false;
+
+    // Move back the keys of the cluster that can take the free slot, that
+    // is the ones whose position is not between the free slot and theirs
+    const size_t mask = map->capacity - 1;
+    for (size_t next = (index + 1) & mask; !(map->ctrl[next] & ANY_MAP_EMPTY); next = (next + 1) & mask) {
+        const size_t home = ANY_MAP_H1(map->slots[next].hash) & mask;
+        if (((next - home) & mask) >= ((next - index) & mask)) {
+            any_map_set_ctrl(map->ctrl, map->capacity, index, map->ctrl[next]);
+            map->slots[index] = map->slots[next];
+            index = next;
+        }
+    }
+
+    any_map_set_ctrl(map->ctrl, map->capacity, index, ANY_MAP_EMPTY);
+    map->count--;
+    return true;
+}
+
+any_map_str_slot_t *any_map_str_next(const any_map_str_t *map, size_t *iter)
+{
+    for (size_t i = *iter; i < map->capacity; i++) {
+        if (!(map->ctrl[i] & ANY_MAP_EMPTY)) {
+            *iter = i + 1;
+            return &map->slots[i];
+        }
+    }
+
+    *iter = map->capacity;
+    return NULL;
+}
+
+// Integer keys
+
+// Return the index of the key or SIZE_MAX if it is not in the map
+static size_t any_map_int_find(const any_map_int_t *map, uint64_t key, uint64_t hash)
+{
+    if (map->count == 0)
+        return SIZE_MAX;
+
+    const size_t mask = map->capacity - 1;
+    const uint8_t h2 = ANY_MAP_H2(hash);
+    size_t pos = ANY_MAP_H1(hash) & mask;
+
+    for (;;) {
+        uint32_t match = any_map_match(map->ctrl + pos, h2);
+        while (match != 0) {
+            const size_t index = (pos + ANY_MAP_CTZ(match)) & mask;
+            if (map->slots[index].key == key)
+                return index;
+            match &= match - 1;
+        }
+
+        if (any_map_match_empty(map->ctrl + pos) != 0)
+            return SIZE_MAX;
+
+        pos = (pos + ANY_MAP_GROUP) & mask;
+    }
+}
+
+static bool any_map_int_resize(any_map_int_t *map, size_t capacity)
+{
+    uint8_t *ctrl;
+    any_map_int_slot_t *slots = (any_map_int_slot_t *)any_map_alloc(capacity, sizeof(any_map_int_slot_t), &ctrl);
+    if (slots == NULL)
+        return false;
+
+    for (size_t i = 0; i < map->capacity; i++) {
+        if (map->ctrl[i] & ANY_MAP_EMPTY)
+            continue;
+
+        const uint64_t hash = any_hash_xxh64_u64(map->slots[i].key, map->seed);
+        const size_t index = any_map_find_empty(ctrl, capacity, hash);
+        any_map_set_ctrl(ctrl, capacity, index, ANY_MAP_H2(hash));
+        slots[index] = map->slots[i];
+    }
+
+    ANY_MAP_FREE(map->slots);
+    map->ctrl = ctrl;
+    map->slots = slots;
+    map->capacity = capacity;
+    return true;
+}
+
+void any_map_int_init(any_map_int_t *map, uint64_t seed)
+{
+    map->ctrl = NULL;
+    map->slots = NULL;
+    map->capacity = 0;
+    map->count = 0;
+    map->seed = seed;
+}
+
+void any_map_int_free(any_map_int_t *map)
+{
+    ANY_MAP_FREE(map->slots);
+    any_map_int_init(map, map->seed);
+}
+
+bool any_map_int_reserve(any_map_int_t *map, size_t count)
+{
+    if (count <= ANY_MAP_MAX_LOAD(map->capacity))
+        return true;
+
+    const size_t capacity = any_map_capacity(count);
+    return capacity != 0 && any_map_int_resize(map, capacity);
+}
+
+bool any_map_int_put(any_map_int_t *map, uint64_t key, void *value)
+{
+    const uint64_t hash = any_hash_xxh64_u64(key, map->seed);
+
+    size_t index = any_map_int_find(map, key, hash);
+    if (index != SIZE_MAX) {
+        map->slots[index].value = value;
+        return true;
+    }
+
+    if (!any_map_int_reserve(map, map->count + 1))
+        return false;
+
+    index = any_map_find_empty(map->ctrl, map->capacity, hash);
+    any_map_set_ctrl(map->ctrl, map->capacity, index, ANY_MAP_H2(hash));
+    map->slots[index].key = key;
+    map->slots[index].value = value;
+    map->count++;
+    return true;
+}
+
+bool any_map_int_get(const any_map_int_t *map, uint64_t key, void **value)
+{
+    const size_t index = any_map_int_find(map, key, any_hash_xxh64_u64(key, map->seed));
+    if (index == SIZE_MAX)
+        return false;
+
+    if (value != NULL)
+        *value = map->slots[index].value;
+    return true;
+}
+
+bool any_map_int_remove(any_map_int_t *map, uint64_t key)
+{
+    size_t index = any_map_int_find(map, key, any_hash_xxh64_u64(key, map->seed));
+    if (index == SIZE_MAX)
+        return false;
+
+    // See any_map_str_remove
+    const size_t mask = map->capacity - 1;
+    for (size_t next = (index + 1) & mask; !(map->ctrl[next] & ANY_MAP_EMPTY); next = (next + 1) & mask) {
+        const size_t home = ANY_MAP_H1(any_hash_xxh64_u64(map->slots[next].key, map->seed)) & mask;
+        if (((next - home) & mask) >= ((next - index) & mask)) {
+            any_map_set_ctrl(map->ctrl, map->capacity, index, map->ctrl[next]);
+            map->slots[index] = map->slots[next];
+            index = next;
+        }
+    }
+
+    any_map_set_ctrl(map->ctrl, map->capacity, index, ANY_MAP_EMPTY);
+    map->count--;
+    return true;
+}
+
+any_map_int_slot_t *any_map_int_next(const any_map_int_t *map, size_t *iter)
+{
+    for (size_t i = *iter; i < map->capacity; i++) {
+        if (!(map->ctrl[i] & ANY_MAP_EMPTY)) {
+            *iter = i + 1;
+            return &map->slots[i];
+        }
+    }
+
+    *iter = map->capacity;
+    return NULL;
+}
+
+#endif
+
+// MIT License
+//
+// Copyright (c) 2024 Federico Angelilli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
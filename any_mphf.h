@@ -0,0 +1,541 @@
+// any_mphf
+//
+// A single-file library that provides a minimal perfect hash function for
+// static sets of keys, built with the CHD algorithm on any_hash.
+//
+// To use this library you should choose a suitable file to put the
+// implementation and define ANY_MPHF_IMPLEMENT. For example
+//
+//    #define ANY_MPHF_IMPLEMENT
+//    #include "any_mphf.h"
+//
+// The keys are hashed with any_hash, so its implementation must be included
+// in some file of the project as well (not necessarily the same).
+//
+// Additionally, you can customize the library behavior by defining certain
+// macros in the file where you put the implementation. You can see which are
+// supported by reading the code guarded by ANY_MPHF_IMPLEMENT.
+//
+// This library is licensed under the terms of the MIT license.
+// A copy of the license is included at the end of this file.
+//
+
+// How does it work?
+//
+// A minimal perfect hash function maps the n keys of a set known in advance
+// to the indexes from 0 to n - 1, without collisions. A lookup then costs a
+// hash and a single key comparison, with no probing and no empty slots, which
+// fits the sets fixed at build time, like the keys of a config file or the
+// symbols of a language.
+//
+// The keys are hashed with any_hash_xxh64 and split in buckets of about
+// ANY_MPHF_BUCKET_SIZE keys. The buckets are placed from the largest, and for
+// each one the builder searches a displacement (d0, d1) such that the slots
+// (f1 + d0 * f2 + d1) mod n of its keys are all free (Belazzougui, Botelho
+// and Dietzfelbinger, "Hash, displace, and compress"). Only the displacements
+// are needed to compute the index of a key, 32 bits per bucket.
+//
+// The table also keeps the keys, in the order of their indexes, so that keys
+// outside the set can be rejected and the index of a key can be mapped back
+// to it.
+//
+
+#ifndef ANY_MPHF_INCLUDE
+#define ANY_MPHF_INCLUDE
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "any_hash.h"
+
+// The size of the header of a serialized table
+#define ANY_MPHF_HEADER 64
+
+typedef struct {
+    const uint8_t *displacements;
+    const uint8_t *offsets;
+    const uint8_t *keys;
+    uint64_t count;
+    uint64_t buckets;
+    uint64_t seed;
+    void *memory;
+} any_mphf_t;
+
+// Build the table of count keys. This function returns false if a key is
+// repeated, if the keys take 4 GiB or more, or if the allocation fails.
+//
+// If two keys have the same hash the table is built with another seed, so
+// the seed of the table may differ from the given one.
+//
+bool any_mphf_build(any_mphf_t *mphf, const uint8_t **keys, const size_t *lengths, size_t count, uint64_t seed);
+
+// Free the table (it does nothing for loaded tables).
+//
+void any_mphf_free(any_mphf_t *mphf);
+
+// Return the index in [0, count) of a key of the set. For keys outside the
+// set the index is arbitrary, use any_mphf_find to reject them.
+//
+size_t any_mphf_index(const any_mphf_t *mphf, const uint8_t *key, size_t length);
+
+// Return the index of a key, or SIZE_MAX if the key is not in the set.
+// For example
+//
+//    static const char *names[] = { "debug", "info", "warn", "error" };
+//    int levels[4];
+//
+//    any_mphf_build(&mphf, (const uint8_t **)names, lengths, 4, 0);
+//    for (int i = 0; i < 4; i++)
+//        levels[any_mphf_index(&mphf, (const uint8_t *)names[i], lengths[i])] = i;
+//
+//    size_t index = any_mphf_find(&mphf, (const uint8_t *)name, strlen(name));
+//    int level = index != SIZE_MAX ? levels[index] : -1;
+//
+size_t any_mphf_find(const any_mphf_t *mphf, const uint8_t *key, size_t length);
+
+// Return the key with the given index, storing its length in length.
+//
+const uint8_t *any_mphf_key(const any_mphf_t *mphf, size_t index, size_t *length);
+
+// Serialization
+//
+// A serialized table is a header of ANY_MPHF_HEADER bytes (the magic
+// "ANY_MPHF", the version and the parameters of the table) followed by the
+// displacements, the offsets of the keys and the keys, all in little endian.
+// The table is used in place, so it can be mapped from a file or embedded in
+// the program as a C array, for example with
+//
+//    xxd -i keys.mphf > keys.h
+//
+// and then
+//
+//    #include "keys.h"
+//
+//    any_mphf_t mphf;
+//    any_mphf_load(&mphf, keys_mphf, keys_mphf_len);
+//
+size_t any_mphf_serialized_size(const any_mphf_t *mphf);
+
+void any_mphf_serialize(const any_mphf_t *mphf, uint8_t *buffer);
+
+// Make a table that uses data in place, without copying it. This function
+// returns false if data is not a valid serialized table.
+//
+bool any_mphf_load(any_mphf_t *mphf, const uint8_t *data, size_t size);
+
+#endif
+
+#ifdef ANY_MPHF_IMPLEMENT
+
+#include <string.h>
+
+// The tables are allocated with ANY_MPHF_MALLOC and freed with ANY_MPHF_FREE.
+// You can change allocation strategy by defining these macros in the
+// implementation file like so
+//
+//    #define ANY_MPHF_IMPLEMENT
+//    #define ANY_MPHF_MALLOC my_malloc
+//    #define ANY_MPHF_FREE my_free
+//    #include "any_mphf.h"
+//
+#ifndef ANY_MPHF_MALLOC
+#include <stdlib.h>
+#define ANY_MPHF_MALLOC malloc
+#define ANY_MPHF_FREE free
+#endif
+
+// The average number of keys in a bucket. Larger buckets make the table
+// smaller and the build slower.
+#ifndef ANY_MPHF_BUCKET_SIZE
+#define ANY_MPHF_BUCKET_SIZE 5
+#endif
+
+// The number of seeds tried when two keys have the same hash
+#define ANY_MPHF_ATTEMPTS 16
+
+#define ANY_MPHF_MAGIC "ANY_MPHF"
+#define ANY_MPHF_VERSION 1
+
+static inline void any_mphf_store32(uint8_t *buffer, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        buffer[i] = (uint8_t)(value >> (8 * i));
+}
+
+static inline void any_mphf_store64(uint8_t *buffer, uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+        buffer[i] = (uint8_t)(value >> (8 * i));
+}
+
+static inline uint32_t any_mphf_load32(const uint8_t *buffer)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++)
+        value |= (uint32_t)buffer[i] << (8 * i);
+    return value;
+}
+
+static inline uint64_t any_mphf_load64(const uint8_t *buffer)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++)
+        value |= (uint64_t)buffer[i] << (8 * i);
+    return value;
+}
+
+// Map a 32 bit value to [0, range) without a division
+static inline uint64_t any_mphf_reduce(uint32_t value, uint64_t range)
+{
+    return (uint64_t)value * range >> 32;
+}
+
+// The bucket of a key comes from the hash, f1 and f2 from a remix of it
+typedef struct {
+    uint64_t bucket;
+    uint64_t f1;
+    uint64_t f2;
+} any_mphf_hash_t;
+
+static inline any_mphf_hash_t any_mphf_hash(uint64_t hash, uint64_t seed, uint64_t count, uint64_t buckets)
+{
+    const uint64_t mix = any_hash_xxh64_u64(hash, seed);
+
+    any_mphf_hash_t h;
+    h.bucket = any_mphf_reduce((uint32_t)(hash >> 32), buckets);
+    h.f1 = any_mphf_reduce((uint32_t)mix, count);
+    h.f2 = any_mphf_reduce((uint32_t)(mix >> 32), count);
+    return h;
+}
+
+// The displacement index k encodes d0 = k / count and d1 = k % count
+static inline uint64_t any_mphf_slot(const any_mphf_hash_t *h, uint64_t k, uint64_t count)
+{
+    return (h->f1 + (k / count) * h->f2 + k % count) % count;
+}
+
+size_t any_mphf_index(const any_mphf_t *mphf, const uint8_t *key, size_t length)
+{
+    if (mphf->count == 0)
+        return SIZE_MAX;
+
+    const any_mphf_hash_t h = any_mphf_hash(any_hash_xxh64(key, length, mphf->seed), mphf->seed,
+                                            mphf->count, mphf->buckets);
+    const uint32_t k = any_mphf_load32(mphf->displacements + 4 * h.bucket);
+    return (size_t)any_mphf_slot(&h, k, mphf->count);
+}
+
+const uint8_t *any_mphf_key(const any_mphf_t *mphf, size_t index, size_t *length)
+{
+    const uint32_t start = any_mphf_load32(mphf->offsets + 4 * index);
+    *length = any_mphf_load32(mphf->offsets + 4 * (index + 1)) - start;
+    return mphf->keys + start;
+}
+
+size_t any_mphf_find(const any_mphf_t *mphf, const uint8_t *key, size_t length)
+{
+    const size_t index = any_mphf_index(mphf, key, length);
+    if (index == SIZE_MAX)
+        return SIZE_MAX;
+
+    size_t stored;
+    const uint8_t *other = any_mphf_key(mphf, index, &stored);
+    return stored == length && memcmp(other, key, length) == 0 ? index : SIZE_MAX;
+}
+
+static size_t any_mphf_size(uint64_t count, uint64_t buckets, uint64_t bytes)
+{
+    return (size_t)(ANY_MPHF_HEADER + 4 * buckets + 4 * (count + 1) + bytes);
+}
+
+static void any_mphf_attach(any_mphf_t *mphf, const uint8_t *data)
+{
+    mphf->count = any_mphf_load64(data + 16);
+    mphf->buckets = any_mphf_load64(data + 24);
+    mphf->seed = any_mphf_load64(data + 32);
+    mphf->displacements = data + ANY_MPHF_HEADER;
+    mphf->offsets = mphf->displacements + 4 * mphf->buckets;
+    mphf->keys = mphf->offsets + 4 * (mphf->count + 1);
+}
+
+// The inputs of the builder
+typedef struct {
+    const uint8_t **keys;
+    const size_t *lengths;
+    size_t count;
+    size_t buckets;
+    any_mphf_hash_t *hashes;
+    size_t *order;
+    size_t *starts;
+    uint8_t *taken;
+    uint64_t *slots;
+    bool repeated;
+} any_mphf_builder_t;
+
+// Check that no two keys of a bucket have the same f1 and f2, because then
+// they would have the same slot for every displacement
+static bool any_mphf_distinct(any_mphf_builder_t *builder, const size_t *keys, size_t size)
+{
+    for (size_t i = 0; i < size; i++) {
+        for (size_t j = i + 1; j < size; j++) {
+            const any_mphf_hash_t *a = &builder->hashes[keys[i]], *b = &builder->hashes[keys[j]];
+            if (a->f1 != b->f1 || a->f2 != b->f2)
+                continue;
+
+            builder->repeated = builder->lengths[keys[i]] == builder->lengths[keys[j]]
+                                && memcmp(builder->keys[keys[i]], builder->keys[keys[j]], builder->lengths[keys[i]]) == 0;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Place the buckets, largest first, storing their displacements. This
+// function returns false if two keys of a bucket collide.
+static bool any_mphf_place(any_mphf_builder_t *builder, uint8_t *displacements)
+{
+    const size_t count = builder->count, buckets = builder->buckets;
+    const any_mphf_hash_t *hashes = builder->hashes;
+    size_t *starts = builder->starts, *order = builder->order, *keys = builder->order + buckets;
+    uint8_t *taken = builder->taken;
+    uint64_t *slots = builder->slots, *bases = builder->slots + buckets;
+
+    // Sort the keys by bucket, and the buckets by size
+    memset(starts, 0, (buckets + 1) * sizeof(size_t));
+    for (size_t i = 0; i < count; i++)
+        starts[hashes[i].bucket + 1]++;
+
+    size_t largest = 0;
+    for (size_t i = 0; i < buckets; i++)
+        largest = starts[i + 1] > largest ? starts[i + 1] : largest;
+
+    for (size_t i = 0; i < buckets; i++)
+        starts[i + 1] += starts[i];
+
+    for (size_t i = 0; i < buckets; i++)
+        slots[i] = starts[i];
+    for (size_t i = 0; i < count; i++)
+        keys[slots[hashes[i].bucket]++] = i;
+
+    size_t placed = 0;
+    for (size_t size = largest; size > 0; size--) {
+        for (size_t b = 0; b < buckets; b++) {
+            if (starts[b + 1] - starts[b] == size)
+                order[placed++] = b;
+        }
+    }
+
+    memset(taken, 0, count);
+    memset(displacements, 0, 4 * buckets);
+
+    const uint64_t limit = (uint64_t)count * count < UINT32_MAX ? (uint64_t)count * count : UINT32_MAX;
+    for (size_t i = 0; i < placed; i++) {
+        const size_t b = order[i];
+        const size_t first = starts[b], size = starts[b + 1] - first;
+
+        if (!any_mphf_distinct(builder, keys + first, size))
+            return false;
+
+        // Try the displacements in the order of k, keeping the base slots
+        // f1 + d0 * f2 of the keys to avoid the divisions
+        uint64_t k = 0;
+        bool found = false;
+        for (uint64_t d0 = 0; !found && k < limit; d0++) {
+            for (size_t j = 0; j < size; j++) {
+                const any_mphf_hash_t *h = &hashes[keys[first + j]];
+                bases[j] = (h->f1 + d0 * h->f2) % count;
+            }
+
+            for (uint64_t d1 = 0; d1 < count && k < limit; d1++, k++) {
+                size_t j = 0;
+                for (; j < size; j++) {
+                    slots[j] = bases[j] + d1 < count ? bases[j] + d1 : bases[j] + d1 - count;
+                    if (taken[slots[j]])
+                        break;
+                    taken[slots[j]] = 1;
+                }
+
+                if (j == size) {
+                    found = true;
+                    break;
+                }
+
+                // Release the slots of a partial placement
+                while (j-- > 0)
+                    taken[slots[j]] = 0;
+            }
+        }
+
+        if (!found)
+            return false;
+
+        any_mphf_store32(displacements + 4 * b, (uint32_t)k);
+    }
+
+    return true;
+}
+
+// Store the keys in the order of their indexes
+static void any_mphf_store_keys(any_mphf_t *mphf, const uint8_t **keys, const size_t *lengths, size_t *index_keys)
+{
+    const size_t count = (size_t)mphf->count;
+
+    for (size_t i = 0; i < count; i++)
+        index_keys[any_mphf_index(mphf, keys[i], lengths[i])] = i;
+
+    uint8_t *offsets = (uint8_t *)mphf->offsets;
+    uint8_t *bytes = (uint8_t *)mphf->keys;
+    uint32_t offset = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        const size_t key = index_keys[i];
+        any_mphf_store32(offsets + 4 * i, offset);
+        memcpy(bytes + offset, keys[key], lengths[key]);
+        offset += (uint32_t)lengths[key];
+    }
+    any_mphf_store32(offsets + 4 * count, offset);
+}
+
+bool any_mphf_build(any_mphf_t *mphf, const uint8_t **keys, const size_t *lengths, size_t count, uint64_t seed)
+{
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < count; i++)
+        bytes += lengths[i];
+
+    if (bytes >= UINT32_MAX || count >= UINT32_MAX)
+        return false;
+
+    any_mphf_builder_t builder;
+    builder.keys = keys;
+    builder.lengths = lengths;
+    builder.count = count;
+    builder.buckets = count / ANY_MPHF_BUCKET_SIZE + 1;
+    builder.repeated = false;
+
+    const size_t buckets = builder.buckets;
+    const size_t size = any_mphf_size(count, buckets, bytes);
+
+    uint8_t *data = (uint8_t *)ANY_MPHF_MALLOC(size);
+    builder.hashes = (any_mphf_hash_t *)ANY_MPHF_MALLOC((count + 1) * sizeof(any_mphf_hash_t));
+    builder.order = (size_t *)ANY_MPHF_MALLOC((buckets + count) * sizeof(size_t));
+    builder.starts = (size_t *)ANY_MPHF_MALLOC((buckets + 1) * sizeof(size_t));
+    builder.taken = (uint8_t *)ANY_MPHF_MALLOC(count + 1);
+    builder.slots = (uint64_t *)ANY_MPHF_MALLOC((buckets + 2 * count) * sizeof(uint64_t));
+
+    bool built = false;
+    if (data != NULL && builder.hashes != NULL && builder.order != NULL && builder.starts != NULL
+        && builder.taken != NULL && builder.slots != NULL) {
+        memset(data, 0, ANY_MPHF_HEADER);
+        memcpy(data, ANY_MPHF_MAGIC, 8);
+        any_mphf_store32(data + 8, ANY_MPHF_VERSION);
+        any_mphf_store64(data + 16, count);
+        any_mphf_store64(data + 24, buckets);
+        any_mphf_store64(data + 40, bytes);
+
+        for (int attempt = 0; attempt < ANY_MPHF_ATTEMPTS && !built && !builder.repeated; attempt++, seed++) {
+            for (size_t i = 0; i < count; i++)
+                builder.hashes[i] = any_mphf_hash(any_hash_xxh64(keys[i], lengths[i], seed), seed, count, buckets);
+
+            built = any_mphf_place(&builder, data + ANY_MPHF_HEADER);
+            if (built)
+                any_mphf_store64(data + 32, seed);
+        }
+    }
+
+    if (built) {
+        any_mphf_attach(mphf, data);
+        mphf->memory = data;
+        any_mphf_store_keys(mphf, keys, lengths, builder.order);
+    } else if (data != NULL)
+        ANY_MPHF_FREE(data);
+
+    if (builder.hashes != NULL)
+        ANY_MPHF_FREE(builder.hashes);
+    if (builder.order != NULL)
+        ANY_MPHF_FREE(builder.order);
+    if (builder.starts != NULL)
+        ANY_MPHF_FREE(builder.starts);
+    if (builder.taken != NULL)
+        ANY_MPHF_FREE(builder.taken);
+    if (builder.slots != NULL)
+        ANY_MPHF_FREE(builder.slots);
+    return built;
+}
+
+void any_mphf_free(any_mphf_t *mphf)
+{
+    if (mphf->memory != NULL)
+        ANY_MPHF_FREE(mphf->memory);
+
+    mphf->memory = NULL;
+    mphf->count = 0;
+    mphf->buckets = 0;
+}
+
+size_t any_mphf_serialized_size(const any_mphf_t *mphf)
+{
+    const uint32_t bytes = any_mphf_load32(mphf->offsets + 4 * mphf->count);
+    return any_mphf_size(mphf->count, mphf->buckets, bytes);
+}
+
+void any_mphf_serialize(const any_mphf_t *mphf, uint8_t *buffer)
+{
+    memcpy(buffer, mphf->displacements - ANY_MPHF_HEADER, any_mphf_serialized_size(mphf));
+}
+
+bool any_mphf_load(any_mphf_t *mphf, const uint8_t *data, size_t size)
+{
+    if (size < ANY_MPHF_HEADER || memcmp(data, ANY_MPHF_MAGIC, 8) != 0
+        || any_mphf_load32(data + 8) != ANY_MPHF_VERSION)
+        return false;
+
+    const uint64_t count = any_mphf_load64(data + 16);
+    const uint64_t buckets = any_mphf_load64(data + 24);
+    const uint64_t bytes = any_mphf_load64(data + 40);
+
+    if (count >= UINT32_MAX || bytes >= UINT32_MAX || buckets == 0 || buckets > count + 1
+        || any_mphf_size(count, buckets, bytes) != size)
+        return false;
+
+    any_mphf_attach(mphf, data);
+    mphf->memory = NULL;
+
+    // The offsets are checked once here, so that the lookups can't read
+    // outside of data
+    uint32_t previous = 0;
+    for (uint64_t i = 0; i <= count; i++) {
+        const uint32_t offset = any_mphf_load32(mphf->offsets + 4 * i);
+        if (offset < previous || offset > bytes || (i == count && offset != bytes))
+            return false;
+        previous = offset;
+    }
+
+    return true;
+}
+
+#endif
+
+// MIT License
+//
+// Copyright (c) 2024 Federico Angelilli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
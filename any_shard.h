@@ -0,0 +1,244 @@
+// any_shard
+//
+// A single-file library that provides consistent hashing helpers, jump hash
+// and weighted rendezvous hashing, for assigning keys to shards or nodes
+// with any_hash digests.
+//
+// To use this library you should choose a suitable file to put the
+// implementation and define ANY_SHARD_IMPLEMENT. For example
+//
+//    #define ANY_SHARD_IMPLEMENT
+//    #include "any_shard.h"
+//
+// The node ids are hashed with any_hash, so its implementation must be
+// included in some file of the project as well (not necessarily the same).
+//
+// This library is licensed under the terms of the MIT license.
+// A copy of the license is included at the end of this file.
+//
+
+// Which one should I use?
+//
+// Taking the hash modulo the number of nodes moves almost every key when a
+// node is added or removed. Both these algorithms move only the keys that
+// must move (about 1/n of them).
+//
+// Jump hash (Lamping and Veach, "A Fast, Minimal Memory, Consistent Hash
+// Algorithm") needs no memory and runs in O(log n), but the buckets are
+// numbered from 0 to n - 1 and only the last one can be removed. It fits
+// the shards of a storage, which only grow.
+//
+// Rendezvous hashing (highest random weight) scores every node for the key
+// and picks the highest, so it runs in O(n), but any node can be removed and
+// the nodes can have weights. It fits a small set of worker nodes.
+//
+
+#ifndef ANY_SHARD_INCLUDE
+#define ANY_SHARD_INCLUDE
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "any_hash.h"
+
+// Map the hash of a key to a bucket in [0, buckets), for example
+//
+//    int32_t shard = any_shard_jump(any_hash_xxh64(key, length, 0), shards);
+//
+// When the buckets go from n to n + 1, only the keys that move to the new
+// bucket change (about 1 / (n + 1) of them).
+//
+int32_t any_shard_jump(uint64_t hash, int32_t buckets);
+
+// Map count hashes at once. Several keys are advanced together to hide the
+// latency of the divisions.
+//
+void any_shard_jump_batch(const uint64_t *hashes, size_t count, int32_t buckets, int32_t *results);
+
+// A node for rendezvous hashing. The id should be the hash of a stable name
+// of the node (like its address), so that the assignments don't depend on
+// the order of the nodes. A node with twice the weight gets twice the keys,
+// and a node with a weight of zero (or less) gets none.
+//
+typedef struct {
+    uint64_t id;
+    double weight;
+} any_shard_node_t;
+
+// Initialize a node from its name.
+//
+void any_shard_node_init(any_shard_node_t *node, const char *name, size_t length, double weight);
+
+// Return the index of the node of a key, or SIZE_MAX if there are no nodes
+// with a positive weight.
+// For example
+//
+//    size_t node = any_shard_rendezvous(nodes, count, any_hash_xxh64(key, length, 0));
+//
+// When a node is added only the keys that move to it change, and when a
+// node is removed only its keys change.
+//
+size_t any_shard_rendezvous(const any_shard_node_t *nodes, size_t count, uint64_t hash);
+
+// Map hash_count hashes at once. If all the nodes have the same weight the
+// scores are compared directly, without computing their logarithm.
+//
+void any_shard_rendezvous_batch(const any_shard_node_t *nodes, size_t count,
+                                const uint64_t *hashes, size_t hash_count, size_t *results);
+
+#endif
+
+#ifdef ANY_SHARD_IMPLEMENT
+
+#include <math.h>
+
+// The number of keys advanced together by any_shard_jump_batch
+#define ANY_SHARD_JUMP_WAYS 4
+
+#define ANY_SHARD_JUMP_MUL 2862933555777941757ull
+
+int32_t any_shard_jump(uint64_t hash, int32_t buckets)
+{
+    int64_t bucket = -1, next = 0;
+
+    while (next < buckets) {
+        bucket = next;
+        hash = hash * ANY_SHARD_JUMP_MUL + 1;
+        next = (int64_t)((bucket + 1) * ((double)(1ll << 31) / (double)((hash >> 33) + 1)));
+    }
+
+    return (int32_t)bucket;
+}
+
+void any_shard_jump_batch(const uint64_t *hashes, size_t count, int32_t buckets, int32_t *results)
+{
+    size_t i = 0;
+
+    for (; i + ANY_SHARD_JUMP_WAYS <= count; i += ANY_SHARD_JUMP_WAYS) {
+        uint64_t hash[ANY_SHARD_JUMP_WAYS];
+        int64_t bucket[ANY_SHARD_JUMP_WAYS], next[ANY_SHARD_JUMP_WAYS];
+
+        for (int j = 0; j < ANY_SHARD_JUMP_WAYS; j++) {
+            hash[j] = hashes[i + j];
+            bucket[j] = -1;
+            next[j] = 0;
+        }
+
+        // The finished keys keep jumping past the end, which doesn't change
+        // their bucket, until all of them are done
+        bool active;
+        do {
+            active = false;
+            for (int j = 0; j < ANY_SHARD_JUMP_WAYS; j++) {
+                const bool inside = next[j] < buckets;
+                bucket[j] = inside ? next[j] : bucket[j];
+                hash[j] = hash[j] * ANY_SHARD_JUMP_MUL + 1;
+                next[j] = inside ? (int64_t)((bucket[j] + 1) * ((double)(1ll << 31) / (double)((hash[j] >> 33) + 1))) : next[j];
+                active |= next[j] < buckets;
+            }
+        } while (active);
+
+        for (int j = 0; j < ANY_SHARD_JUMP_WAYS; j++)
+            results[i + j] = (int32_t)bucket[j];
+    }
+
+    for (; i < count; i++)
+        results[i] = any_shard_jump(hashes[i], buckets);
+}
+
+void any_shard_node_init(any_shard_node_t *node, const char *name, size_t length, double weight)
+{
+    node->id = any_hash_xxh64((const uint8_t *)name, length, 0);
+    node->weight = weight;
+}
+
+// The pseudo random number of a key for a node
+static inline uint64_t any_shard_mix(uint64_t hash, uint64_t id)
+{
+    return any_hash_xxh64_u128(hash, id, 0);
+}
+
+// The weighted score is -weight / ln(u), with u uniform in (0, 1), so that
+// the probability of a node being the highest is proportional to its weight
+// (see Schindelhauer and Schomaker, "Weighted Distributed Hash Tables")
+static inline double any_shard_score(uint64_t mix, double weight)
+{
+    const double u = ((double)(mix >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+    return -weight / log(u);
+}
+
+size_t any_shard_rendezvous(const any_shard_node_t *nodes, size_t count, uint64_t hash)
+{
+    size_t best = SIZE_MAX;
+    double best_score = -1;
+
+    for (size_t i = 0; i < count; i++) {
+        if (!(nodes[i].weight > 0))
+            continue;
+
+        const double score = any_shard_score(any_shard_mix(hash, nodes[i].id), nodes[i].weight);
+        if (score > best_score) {
+            best_score = score;
+            best = i;
+        }
+    }
+
+    return best;
+}
+
+void any_shard_rendezvous_batch(const any_shard_node_t *nodes, size_t count,
+                                const uint64_t *hashes, size_t hash_count, size_t *results)
+{
+    bool uniform = true;
+    for (size_t i = 1; i < count; i++)
+        uniform &= nodes[i].weight == nodes[0].weight;
+
+    // The score grows with the mix, so with the same positive weights the
+    // highest mix is the highest score
+    if (!uniform || count == 0 || !(nodes[0].weight > 0)) {
+        for (size_t i = 0; i < hash_count; i++)
+            results[i] = any_shard_rendezvous(nodes, count, hashes[i]);
+        return;
+    }
+
+    for (size_t i = 0; i < hash_count; i++) {
+        size_t best = 0;
+        uint64_t best_mix = any_shard_mix(hashes[i], nodes[0].id) >> 11;
+
+        for (size_t j = 1; j < count; j++) {
+            const uint64_t mix = any_shard_mix(hashes[i], nodes[j].id) >> 11;
+            if (mix > best_mix) {
+                best_mix = mix;
+                best = j;
+            }
+        }
+
+        results[i] = best;
+    }
+}
+
+#endif
+
+// MIT License
+//
+// Copyright (c) 2024 Federico Angelilli
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
@@ -0,0 +1,236 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define ANY_HASH_IMPLEMENT
+#include "any_hash.h"
+
+// Measure the speed of the hash functions on inputs from 1 B to 1 MiB, at an
+// aligned and at an unaligned offset.
+//
+// Usage: bench/hash [runs] [milliseconds] [algorithm...]
+//
+// By default every algorithm is measured with the median of 7 runs of 10 ms
+// each, after a warmup. The output has one line per algorithm, size and
+// offset, with the columns separated by spaces and the comments starting
+// with '#', so that the output of two builds can be compared with the usual
+// text tools (awk, join, diff).
+//
+// The large inputs of the performance table in any_hash.h correspond to the
+// 1048576 bytes rows. The batch rows hash BATCH keys of the given size in
+// every call (up to BATCH_SIZE bytes, the longer keys are not batched) and
+// their hash/s are keys per second.
+
+#define MAX_SIZE (1024 * 1024)
+#define ALIGN 64
+#define BATCH 64
+#define BATCH_SIZE 256
+
+typedef uint64_t (*hash_function_t)(const uint8_t *data, size_t length, uint64_t seed);
+
+typedef struct {
+    const char *name;
+    hash_function_t hash;
+    size_t keys;
+} algorithm_t;
+
+static uint64_t xxh32(const uint8_t *data, size_t length, uint64_t seed)
+{
+    return any_hash_xxh32(data, length, (any_hash32_t)seed);
+}
+
+static uint64_t xxh64(const uint8_t *data, size_t length, uint64_t seed)
+{
+    return any_hash_xxh64(data, length, seed);
+}
+
+// The keys of the batches follow each other in the input
+static const uint8_t *batch_keys[BATCH];
+static size_t batch_lengths[BATCH];
+
+static void batch_prepare(const uint8_t *data, size_t length)
+{
+    for (size_t i = 0; i < BATCH; i++) {
+        batch_keys[i] = data + i * length;
+        batch_lengths[i] = length;
+    }
+}
+
+static uint64_t xxh32_batch(const uint8_t *data, size_t length, uint64_t seed)
+{
+    any_hash32_t hashes[BATCH];
+    (void)data;
+    (void)length;
+
+    any_hash_xxh32_batch(batch_keys, batch_lengths, BATCH, (any_hash32_t)seed, hashes);
+    return hashes[0] ^ hashes[BATCH - 1];
+}
+
+static uint64_t xxh64_batch(const uint8_t *data, size_t length, uint64_t seed)
+{
+    any_hash64_t hashes[BATCH];
+    (void)data;
+    (void)length;
+
+    any_hash_xxh64_batch(batch_keys, batch_lengths, BATCH, seed, hashes);
+    return hashes[0] ^ hashes[BATCH - 1];
+}
+
+#ifndef ANY_HASH_NO_XXH3
+
+static uint64_t xxh3_64(const uint8_t *data, size_t length, uint64_t seed)
+{
+    return any_hash_xxh3_64(data, length, seed);
+}
+
+static uint64_t xxh128(const uint8_t *data, size_t length, uint64_t seed)
+{
+    any_hash128_t hash = any_hash_xxh128(data, length, seed);
+    return hash.low ^ hash.high;
+}
+
+// The keyed functions have no seed, so they alternate between two secrets
+// to keep the calls in the loop, like the seed does for the others
+static uint8_t secrets[2][ANY_HASH_SECRET_SIZE];
+
+static uint64_t xxh3_64_secret(const uint8_t *data, size_t length, uint64_t seed)
+{
+    return any_hash_xxh3_64_secret(data, length, secrets[seed & 1]);
+}
+
+static uint64_t xxh128_secret(const uint8_t *data, size_t length, uint64_t seed)
+{
+    any_hash128_t hash = any_hash_xxh128_secret(data, length, secrets[seed & 1]);
+    return hash.low ^ hash.high;
+}
+
+#endif
+
+static const algorithm_t algorithms[] = {
+    { "xxh32", xxh32, 1 },
+    { "xxh64", xxh64, 1 },
+    { "xxh32_batch", xxh32_batch, BATCH },
+    { "xxh64_batch", xxh64_batch, BATCH },
+#ifndef ANY_HASH_NO_XXH3
+    { "xxh3_64", xxh3_64, 1 },
+    { "xxh128", xxh128, 1 },
+    { "xxh3_64_secret", xxh3_64_secret, 1 },
+    { "xxh128_secret", xxh128_secret, 1 },
+#endif
+};
+
+#define ALGORITHMS (sizeof(algorithms) / sizeof(*algorithms))
+
+// Keeps the results alive, so that the hashing is not optimized away
+static volatile uint64_t sink;
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare(const void *a, const void *b)
+{
+    const double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Hash the input many times, changing the seed so that no call can be hoisted
+// out of the loop, and return the seconds taken
+static double measure(hash_function_t hash, const uint8_t *data, size_t length, size_t iterations)
+{
+    uint64_t result = 0;
+
+    const double start = now();
+    for (size_t i = 0; i < iterations; i++)
+        result += hash(data, length, i);
+    const double end = now();
+
+    sink = result;
+    return end - start;
+}
+
+// Return the median of the hashes per second of the runs
+static double benchmark(hash_function_t hash, const uint8_t *data, size_t length, int runs, double duration)
+{
+    // Warmup, also used to find how many iterations fit in a run
+    size_t iterations = 1;
+    double elapsed;
+    while ((elapsed = measure(hash, data, length, iterations)) < duration / 10)
+        iterations *= 2;
+
+    iterations = (size_t)(iterations * duration / elapsed) + 1;
+
+    double speeds[runs];
+    for (int run = 0; run < runs; run++)
+        speeds[run] = iterations / measure(hash, data, length, iterations);
+
+    qsort(speeds, runs, sizeof(double), compare);
+    return speeds[runs / 2];
+}
+
+int main(int argc, char **argv)
+{
+    const int runs = argc > 1 ? atoi(argv[1]) : 7;
+    const double duration = (argc > 2 ? atof(argv[2]) : 10) / 1e3;
+
+    if (runs < 1 || duration <= 0) {
+        fprintf(stderr, "Usage: %s [runs] [milliseconds] [algorithm...]\n", argv[0]);
+        return 1;
+    }
+
+    uint8_t *buffer = malloc(MAX_SIZE + 2 * ALIGN);
+    if (buffer == NULL) {
+        fprintf(stderr, "cannot allocate %d bytes\n", MAX_SIZE + 2 * ALIGN);
+        return 1;
+    }
+
+    uint8_t *aligned = buffer + (ALIGN - (uintptr_t)buffer % ALIGN) % ALIGN;
+    for (size_t i = 0; i < MAX_SIZE + ALIGN; i++)
+        aligned[i] = (uint8_t)(i * 2654435761u >> 24);
+
+#ifndef ANY_HASH_NO_XXH3
+    for (size_t i = 0; i < 2; i++) {
+        for (size_t j = 0; j < ANY_HASH_SECRET_SIZE; j++)
+            secrets[i][j] = (uint8_t)((i * ANY_HASH_SECRET_SIZE + j) * 2246822519u >> 24);
+    }
+#endif
+
+    printf("# kernel %s, median of %d runs of %g ms\n",
+           any_hash_kernel_to_string(any_hash_kernel()), runs, duration * 1e3);
+    printf("%-14s %8s %6s %10s %14s\n", "algorithm", "size", "offset", "GB/s", "hash/s");
+
+    for (size_t a = 0; a < ALGORITHMS; a++) {
+        const algorithm_t *algorithm = &algorithms[a];
+
+        // Only the algorithms given on the command line, if any
+        bool selected = argc <= 3;
+        for (int i = 3; i < argc; i++)
+            selected |= strcmp(argv[i], algorithm->name) == 0;
+
+        if (!selected)
+            continue;
+
+        const size_t max_size = algorithm->keys > 1 ? BATCH_SIZE : MAX_SIZE;
+
+        for (size_t size = 1; size <= max_size; size *= 2) {
+            for (size_t offset = 0; offset <= 1; offset++) {
+                batch_prepare(aligned + offset, size);
+
+                const double speed = benchmark(algorithm->hash, aligned + offset, size, runs, duration)
+                                   * algorithm->keys;
+                printf("%-14s %8zu %6zu %10.2f %14.0f\n", algorithm->name, size, offset, speed * size / 1e9, speed);
+                fflush(stdout);
+            }
+        }
+    }
+
+    free(buffer);
+    return 0;
+}
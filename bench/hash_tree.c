@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define ANY_HASH_IMPLEMENT
+#include "any_hash.h"
+
+// Measure the throughput of the tree mode with pools from 1 to N threads.
+//
+// Usage: bench/hash_tree [megabytes] [threads]
+//
+// By default it hashes 1024 MiB with up to one thread per cpu.
+
+#define RUNS 5
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare(const void *a, const void *b)
+{
+    const double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char **argv)
+{
+    const size_t size = (argc > 1 ? strtoull(argv[1], NULL, 10) : 1024) << 20;
+    const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    const size_t max = argc > 2 ? strtoull(argv[2], NULL, 10) : (cpus > 0 ? (size_t)cpus : 1);
+
+    uint8_t *data = malloc(size);
+    if (data == NULL) {
+        fprintf(stderr, "cannot allocate %zu bytes\n", size);
+        return 1;
+    }
+
+    // Touch every page before timing
+    for (size_t i = 0; i < size; i++)
+        data[i] = (uint8_t)(i * 2654435761u >> 24);
+
+    printf("# %zu MiB, leaf %d KiB, median of %d runs\n", size >> 20, ANY_HASH_TREE_LEAF >> 10, RUNS);
+    printf("%-8s %10s %10s %18s\n", "threads", "GB/s", "speedup", "hash");
+
+    double base = 0;
+    for (size_t threads = 1; threads <= max; threads++) {
+        any_hash_pool_t *pool = any_hash_pool_new(threads);
+        any_hash64_t hash = any_hash_xxh64_tree(pool, data, size, 0);
+
+        double times[RUNS];
+        for (int run = 0; run < RUNS; run++) {
+            const double start = now();
+            hash = any_hash_xxh64_tree(pool, data, size, 0);
+            times[run] = now() - start;
+        }
+        any_hash_pool_free(pool);
+
+        qsort(times, RUNS, sizeof(double), compare);
+        const double speed = size / times[RUNS / 2] / 1e9;
+        if (threads == 1)
+            base = speed;
+
+        printf("%-8zu %10.2f %10.2f %18.16llx\n", threads, speed, speed / base, (unsigned long long)hash);
+    }
+
+    free(data);
+    return 0;
+}
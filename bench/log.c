@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+
+#define ANY_LOG_IMPLEMENT
+#define ANY_LOG_MODULE "bench"
+#include "any_log.h"
+
+// Measure the nanoseconds per log_info call in the text and binary modes,
+// synchronous and asynchronous, writing to /dev/null. The text mode is also
+// measured with THREADS threads logging at the same time, and the
+// structured logging with log_value_info and log_pairs_info (8 pairs, the
+// last column is the cost of each pair). The last rows are the cost of the
+// log_debug calls filtered by the level of their module and of the
+// log_info calls disabled with any_log_sites_set.
+//
+// Usage: bench/log [calls]
+//
+// By default it logs one million records, the median of 5 runs is printed.
+
+#define RUNS 5
+#define THREADS 4
+#define PAIRS 8
+
+static size_t count;
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare(const void *a, const void *b)
+{
+    const double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+typedef enum { TEXT, TEXT_THREADS, BINARY, TEXT_ASYNC, BINARY_ASYNC, STRUCTURED_VALUE, STRUCTURED_PAIRS,
+               FILTERED, DISABLED } log_mode_t;
+
+static const char *mode_names[] = {
+    "text", "text_threads", "binary", "text_async", "binary_async", "value", "pairs", "filtered", "disabled"
+};
+
+static void *producer(void *data)
+{
+    const size_t calls = *(const size_t *)data;
+    for (size_t i = 0; i < calls; i++)
+        log_info("request %zu from %s took %.3f ms (status %d)", i, "10.0.0.1", i * 0.001, 200);
+    return NULL;
+}
+
+static double run(log_mode_t mode, FILE *null)
+{
+    any_log_init(null, ANY_LOG_INFO);
+
+#ifndef ANY_LOG_NO_BINARY
+    if (mode == BINARY || mode == BINARY_ASYNC)
+        any_log_init_binary(null, ANY_LOG_INFO);
+#endif
+
+#ifndef ANY_LOG_NO_ASYNC
+    if (mode == TEXT_ASYNC || mode == BINARY_ASYNC)
+        any_log_async_start(1 << 24, ANY_LOG_BLOCK);
+#endif
+
+    const double start = now();
+
+    if (mode == TEXT_THREADS) {
+        pthread_t threads[THREADS];
+        size_t calls = count / THREADS;
+
+        for (int i = 0; i < THREADS; i++)
+            pthread_create(&threads[i], NULL, producer, &calls);
+        for (int i = 0; i < THREADS; i++)
+            pthread_join(threads[i], NULL);
+    } else if (mode == STRUCTURED_VALUE) {
+        for (size_t i = 0; i < count; i++)
+            log_value_info("request", "l:id", (long)i, "s:from", "10.0.0.1", "f:ms", i * 0.001,
+                           "d:status", 200, "b:cached", i & 1, "x:flags", 0x10u, "p:peer", NULL,
+                           "user", "admin");
+    } else if (mode == STRUCTURED_PAIRS) {
+        for (size_t i = 0; i < count; i++)
+            log_pairs_info("request", ANY_LOG_PAIR("id", (long)i), ANY_LOG_PAIR("from", "10.0.0.1"),
+                           ANY_LOG_PAIR("ms", i * 0.001), ANY_LOG_PAIR("status", 200),
+                           ANY_LOG_PAIR_BOOL("cached", i & 1), ANY_LOG_PAIR("flags", 0x10u),
+                           ANY_LOG_PAIR("peer", NULL), ANY_LOG_PAIR("user", "admin"));
+    } else if (mode == FILTERED) {
+        any_log_set_levels("net=trace,bench=info");
+        for (size_t i = 0; i < count; i++)
+            log_debug("request %zu from %s took %.3f ms (status %d)", i, "10.0.0.1", i * 0.001, 200);
+        any_log_set_levels("");
+    } else if (mode == DISABLED) {
+        any_log_sites_set("producer", ANY_LOG_SITE_DISABLED);
+        producer(&count);
+        any_log_sites_set("producer", ANY_LOG_SITE_DEFAULT);
+    } else {
+        producer(&count);
+    }
+
+    const double elapsed = now() - start;
+
+#ifndef ANY_LOG_NO_ASYNC
+    any_log_async_stop();
+#endif
+    return elapsed;
+}
+
+static void bench(log_mode_t mode, FILE *null)
+{
+    double times[RUNS];
+
+    run(mode, null);
+    for (int i = 0; i < RUNS; i++)
+        times[i] = run(mode, null);
+
+    qsort(times, RUNS, sizeof(double), compare);
+
+    const double ns = times[RUNS / 2] * 1e9 / count;
+    if (mode == STRUCTURED_VALUE || mode == STRUCTURED_PAIRS)
+        printf("%-14s %10.1f %10.1f\n", mode_names[mode], ns, ns / PAIRS);
+    else
+        printf("%-14s %10.1f\n", mode_names[mode], ns);
+}
+
+int main(int argc, char **argv)
+{
+    count = argc > 1 ? strtoull(argv[1], NULL, 10) : 1000000;
+
+    FILE *null = fopen("/dev/null", "w");
+    if (null == NULL)
+        return 1;
+
+    printf("%-14s %10s %10s\n", "mode", "ns/call", "ns/pair");
+    bench(TEXT, null);
+    bench(TEXT_THREADS, null);
+#ifndef ANY_LOG_NO_BINARY
+    bench(BINARY, null);
+#endif
+#ifndef ANY_LOG_NO_ASYNC
+    bench(TEXT_ASYNC, null);
+#endif
+#ifndef ANY_LOG_NO_BINARY
+    bench(BINARY_ASYNC, null);
+#endif
+    bench(STRUCTURED_VALUE, null);
+    bench(STRUCTURED_PAIRS, null);
+    bench(FILTERED, null);
+    bench(DISABLED, null);
+
+    fclose(null);
+    return 0;
+}
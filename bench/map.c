@@ -0,0 +1,357 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define ANY_HASH_IMPLEMENT
+#include "any_hash.h"
+
+#define ANY_MAP_IMPLEMENT
+#include "any_map.h"
+
+// Compare any_map with a chained hash table (one allocation per key, the
+// usual hand written one), with integer and string keys.
+//
+// Usage: bench/map [keys]
+//
+// By default it uses one million keys. Every operation is measured as the
+// median of 5 runs, in millions of operations per second. The lookups of
+// missing keys use keys that were never inserted.
+
+#define RUNS 5
+
+typedef struct chain_node {
+    struct chain_node *next;
+    uint64_t hash;
+    const char *key;
+    size_t length;
+    void *value;
+} chain_node_t;
+
+typedef struct {
+    chain_node_t **buckets;
+    size_t capacity;
+    size_t count;
+} chain_t;
+
+static void chain_init(chain_t *chain)
+{
+    chain->capacity = 16;
+    chain->count = 0;
+    chain->buckets = calloc(chain->capacity, sizeof(chain_node_t *));
+}
+
+static void chain_free(chain_t *chain)
+{
+    for (size_t i = 0; i < chain->capacity; i++) {
+        for (chain_node_t *node = chain->buckets[i], *next; node != NULL; node = next) {
+            next = node->next;
+            free(node);
+        }
+    }
+    free(chain->buckets);
+}
+
+static void chain_grow(chain_t *chain)
+{
+    const size_t capacity = chain->capacity * 2;
+    chain_node_t **buckets = calloc(capacity, sizeof(chain_node_t *));
+
+    for (size_t i = 0; i < chain->capacity; i++) {
+        for (chain_node_t *node = chain->buckets[i], *next; node != NULL; node = next) {
+            next = node->next;
+            chain_node_t **bucket = &buckets[node->hash & (capacity - 1)];
+            node->next = *bucket;
+            *bucket = node;
+        }
+    }
+
+    free(chain->buckets);
+    chain->buckets = buckets;
+    chain->capacity = capacity;
+}
+
+static chain_node_t **chain_find(chain_t *chain, const char *key, size_t length, uint64_t hash)
+{
+    chain_node_t **node = &chain->buckets[hash & (chain->capacity - 1)];
+    while (*node != NULL && ((*node)->hash != hash || (*node)->length != length || memcmp((*node)->key, key, length) != 0))
+        node = &(*node)->next;
+    return node;
+}
+
+// Integer keys are stored in the key pointer itself
+static chain_node_t **chain_find_int(chain_t *chain, uint64_t key, uint64_t hash)
+{
+    chain_node_t **node = &chain->buckets[hash & (chain->capacity - 1)];
+    while (*node != NULL && (uint64_t)(uintptr_t)(*node)->key != key)
+        node = &(*node)->next;
+    return node;
+}
+
+static void chain_insert(chain_t *chain, chain_node_t **node, const char *key, size_t length, uint64_t hash, void *value)
+{
+    if (*node != NULL) {
+        (*node)->value = value;
+        return;
+    }
+
+    chain_node_t *new_node = malloc(sizeof(chain_node_t));
+    new_node->next = NULL;
+    new_node->hash = hash;
+    new_node->key = key;
+    new_node->length = length;
+    new_node->value = value;
+    *node = new_node;
+
+    if (++chain->count > chain->capacity)
+        chain_grow(chain);
+}
+
+static void chain_remove(chain_t *chain, chain_node_t **node)
+{
+    if (*node == NULL)
+        return;
+
+    chain_node_t *next = (*node)->next;
+    free(*node);
+    *node = next;
+    chain->count--;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare(const void *a, const void *b)
+{
+    const double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+enum { OP_INSERT, OP_HIT, OP_MISS, OP_REMOVE, OPS };
+
+static const char *op_names[OPS] = { "insert", "hit", "miss", "remove" };
+
+static size_t count;
+static uint64_t *ints;
+static char **strings;
+static size_t *lengths;
+
+// The inserted keys in another order, for the lookups and the removals,
+// so that the chained table doesn't walk its nodes in allocation order
+static uint64_t *shuffled_ints;
+static char **shuffled_strings;
+static size_t *shuffled_lengths;
+
+// The keys from count to 2 * count are used for the misses
+static size_t found;
+
+static void run_map_int(double times[OPS])
+{
+    any_map_int_t map;
+    any_map_int_init(&map, 0);
+
+    double start = now();
+    for (size_t i = 0; i < count; i++)
+        any_map_int_put(&map, ints[i], &ints[i]);
+    times[OP_INSERT] = now() - start;
+
+    start = now();
+    for (size_t i = 0; i < count; i++)
+        found += any_map_int_get(&map, shuffled_ints[i], NULL);
+    times[OP_HIT] = now() - start;
+
+    start = now();
+    for (size_t i = count; i < 2 * count; i++)
+        found += any_map_int_get(&map, ints[i], NULL);
+    times[OP_MISS] = now() - start;
+
+    start = now();
+    for (size_t i = 0; i < count; i++)
+        any_map_int_remove(&map, shuffled_ints[i]);
+    times[OP_REMOVE] = now() - start;
+
+    any_map_int_free(&map);
+}
+
+static void run_chain_int(double times[OPS])
+{
+    chain_t chain;
+    chain_init(&chain);
+
+    double start = now();
+    for (size_t i = 0; i < count; i++) {
+        const uint64_t hash = any_hash_xxh64_u64(ints[i], 0);
+        chain_insert(&chain, chain_find_int(&chain, ints[i], hash), (const char *)(uintptr_t)ints[i], 0, hash, &ints[i]);
+    }
+    times[OP_INSERT] = now() - start;
+
+    start = now();
+    for (size_t i = 0; i < count; i++)
+        found += *chain_find_int(&chain, shuffled_ints[i], any_hash_xxh64_u64(shuffled_ints[i], 0)) != NULL;
+    times[OP_HIT] = now() - start;
+
+    start = now();
+    for (size_t i = count; i < 2 * count; i++)
+        found += *chain_find_int(&chain, ints[i], any_hash_xxh64_u64(ints[i], 0)) != NULL;
+    times[OP_MISS] = now() - start;
+
+    start = now();
+    for (size_t i = 0; i < count; i++)
+        chain_remove(&chain, chain_find_int(&chain, shuffled_ints[i], any_hash_xxh64_u64(shuffled_ints[i], 0)));
+    times[OP_REMOVE] = now() - start;
+
+    chain_free(&chain);
+}
+
+static void run_map_str(double times[OPS])
+{
+    any_map_str_t map;
+    any_map_str_init(&map, 0);
+
+    double start = now();
+    for (size_t i = 0; i < count; i++)
+        any_map_str_put(&map, strings[i], lengths[i], strings[i]);
+    times[OP_INSERT] = now() - start;
+
+    start = now();
+    for (size_t i = 0; i < count; i++)
+        found += any_map_str_get(&map, shuffled_strings[i], shuffled_lengths[i], NULL);
+    times[OP_HIT] = now() - start;
+
+    start = now();
+    for (size_t i = count; i < 2 * count; i++)
+        found += any_map_str_get(&map, strings[i], lengths[i], NULL);
+    times[OP_MISS] = now() - start;
+
+    start = now();
+    for (size_t i = 0; i < count; i++)
+        any_map_str_remove(&map, shuffled_strings[i], shuffled_lengths[i]);
+    times[OP_REMOVE] = now() - start;
+
+    any_map_str_free(&map);
+}
+
+static void run_chain_str(double times[OPS])
+{
+    chain_t chain;
+    chain_init(&chain);
+
+    double start = now();
+    for (size_t i = 0; i < count; i++) {
+        const uint64_t hash = any_hash_xxh64((const uint8_t *)strings[i], lengths[i], 0);
+        chain_insert(&chain, chain_find(&chain, strings[i], lengths[i], hash), strings[i], lengths[i], hash, strings[i]);
+    }
+    times[OP_INSERT] = now() - start;
+
+    start = now();
+    for (size_t i = 0; i < count; i++)
+        found += *chain_find(&chain, shuffled_strings[i], shuffled_lengths[i], any_hash_xxh64((const uint8_t *)shuffled_strings[i], shuffled_lengths[i], 0)) != NULL;
+    times[OP_HIT] = now() - start;
+
+    start = now();
+    for (size_t i = count; i < 2 * count; i++)
+        found += *chain_find(&chain, strings[i], lengths[i], any_hash_xxh64((const uint8_t *)strings[i], lengths[i], 0)) != NULL;
+    times[OP_MISS] = now() - start;
+
+    start = now();
+    for (size_t i = 0; i < count; i++)
+        chain_remove(&chain, chain_find(&chain, shuffled_strings[i], shuffled_lengths[i], any_hash_xxh64((const uint8_t *)shuffled_strings[i], shuffled_lengths[i], 0)));
+    times[OP_REMOVE] = now() - start;
+
+    chain_free(&chain);
+}
+
+static void bench(const char *table, const char *keys, void (*run)(double times[OPS]))
+{
+    double times[OPS][RUNS], runs[OPS];
+
+    // Warmup
+    run(runs);
+
+    for (int i = 0; i < RUNS; i++) {
+        run(runs);
+        for (int op = 0; op < OPS; op++)
+            times[op][i] = runs[op];
+    }
+
+    for (int op = 0; op < OPS; op++) {
+        qsort(times[op], RUNS, sizeof(double), compare);
+        printf("%-6s %-4s %-7s %10.2f\n", table, keys, op_names[op], count / times[op][RUNS / 2] / 1e6);
+    }
+    fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    count = argc > 1 ? strtoull(argv[1], NULL, 10) : 1000000;
+
+    // Random integer keys and symbol like string keys, in random order
+    ints = malloc(2 * count * sizeof(uint64_t));
+    strings = malloc(2 * count * sizeof(char *));
+    lengths = malloc(2 * count * sizeof(size_t));
+
+    uint64_t state = 0x9e3779b97f4a7c15;
+    for (size_t i = 0; i < 2 * count; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        ints[i] = state;
+
+        char buffer[64];
+        lengths[i] = snprintf(buffer, sizeof(buffer), "module.symbol_%zu", i);
+        strings[i] = malloc(lengths[i] + 1);
+        memcpy(strings[i], buffer, lengths[i] + 1);
+    }
+
+    for (size_t i = 2 * count - 1; i > 0; i--) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        const size_t j = state % (i + 1);
+        char *string = strings[i];
+        strings[i] = strings[j];
+        strings[j] = string;
+        const size_t length = lengths[i];
+        lengths[i] = lengths[j];
+        lengths[j] = length;
+    }
+
+    shuffled_ints = malloc(count * sizeof(uint64_t));
+    shuffled_strings = malloc(count * sizeof(char *));
+    shuffled_lengths = malloc(count * sizeof(size_t));
+
+    for (size_t i = 0; i < count; i++) {
+        const size_t j = (i * 2654435761u) % count;
+        shuffled_ints[i] = ints[j];
+        shuffled_strings[i] = strings[j];
+        shuffled_lengths[i] = lengths[j];
+    }
+
+    printf("# %zu keys, median of %d runs\n", count, RUNS);
+    printf("%-6s %-4s %-7s %10s\n", "table", "keys", "op", "Mops/s");
+
+    bench("any", "int", run_map_int);
+    bench("chain", "int", run_chain_int);
+    bench("any", "str", run_map_str);
+    bench("chain", "str", run_chain_str);
+
+    if (found != (RUNS + 1) * 4 * count)
+        fprintf(stderr, "unexpected lookups: %zu\n", found);
+
+    for (size_t i = 0; i < 2 * count; i++)
+        free(strings[i]);
+    free(strings);
+    free(lengths);
+    free(ints);
+    free(shuffled_strings);
+    free(shuffled_lengths);
+    free(shuffled_ints);
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define ANY_HASH_IMPLEMENT
+#include "any_hash.h"
+
+#define ANY_SHARD_IMPLEMENT
+#include "any_shard.h"
+
+// Measure the keys per second of jump hash and rendezvous hashing, one key
+// at a time and in batches, for different numbers of buckets and nodes.
+//
+// Usage: bench/shard [keys]
+//
+// By default it assigns one million keys, the median of 5 runs is printed.
+
+#define RUNS 5
+
+static size_t count;
+static uint64_t *hashes;
+static int32_t *buckets;
+static size_t *nodes;
+static size_t sink;
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare(const void *a, const void *b)
+{
+    const double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+typedef enum { JUMP, JUMP_BATCH, RENDEZVOUS, RENDEZVOUS_BATCH } algorithm_t;
+
+static const char *algorithm_names[] = { "jump", "jump_batch", "rendezvous", "rendezvous_batch" };
+
+static double run(algorithm_t mode, size_t n, const any_shard_node_t *list)
+{
+    const double start = now();
+
+    switch (mode) {
+    case JUMP:
+        for (size_t i = 0; i < count; i++)
+            buckets[i] = any_shard_jump(hashes[i], (int32_t)n);
+        break;
+    case JUMP_BATCH:
+        any_shard_jump_batch(hashes, count, (int32_t)n, buckets);
+        break;
+    case RENDEZVOUS:
+        for (size_t i = 0; i < count; i++)
+            nodes[i] = any_shard_rendezvous(list, n, hashes[i]);
+        break;
+    case RENDEZVOUS_BATCH:
+        any_shard_rendezvous_batch(list, n, hashes, count, nodes);
+        break;
+    }
+
+    const double elapsed = now() - start;
+    sink += (size_t)buckets[count / 2] + nodes[count / 2];
+    return elapsed;
+}
+
+static void bench(algorithm_t mode, size_t n, const any_shard_node_t *list, const char *weights)
+{
+    double times[RUNS];
+
+    run(mode, n, list);
+    for (int i = 0; i < RUNS; i++)
+        times[i] = run(mode, n, list);
+
+    qsort(times, RUNS, sizeof(double), compare);
+    printf("%-18s %8zu %-8s %12.0f\n", algorithm_names[mode], n, weights, count / times[RUNS / 2]);
+    fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    count = argc > 1 ? strtoull(argv[1], NULL, 10) : 1000000;
+
+    hashes = malloc(count * sizeof(uint64_t));
+    buckets = calloc(count, sizeof(int32_t));
+    nodes = calloc(count, sizeof(size_t));
+    for (size_t i = 0; i < count; i++)
+        hashes[i] = any_hash_xxh64_u64(i, 0);
+
+    static const size_t node_counts[] = { 4, 16, 64 };
+    any_shard_node_t uniform[64], weighted[64];
+    for (size_t i = 0; i < 64; i++) {
+        char name[32];
+        const int length = snprintf(name, sizeof(name), "node-%zu", i);
+        any_shard_node_init(&uniform[i], name, length, 1.0);
+        any_shard_node_init(&weighted[i], name, length, 1.0 + i % 3);
+    }
+
+    printf("# %zu keys, median of %d runs\n", count, RUNS);
+    printf("%-18s %8s %-8s %12s\n", "algorithm", "nodes", "weights", "keys/s");
+
+    static const size_t bucket_counts[] = { 10, 1000, 100000 };
+    for (size_t i = 0; i < 3; i++) {
+        bench(JUMP, bucket_counts[i], NULL, "-");
+        bench(JUMP_BATCH, bucket_counts[i], NULL, "-");
+    }
+
+    for (size_t i = 0; i < 3; i++) {
+        bench(RENDEZVOUS, node_counts[i], uniform, "uniform");
+        bench(RENDEZVOUS_BATCH, node_counts[i], uniform, "uniform");
+        bench(RENDEZVOUS, node_counts[i], weighted, "weighted");
+        bench(RENDEZVOUS_BATCH, node_counts[i], weighted, "weighted");
+    }
+
+    free(hashes);
+    free(buckets);
+    free(nodes);
+    return sink == 0;
+}
@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ANY_HASH_IMPLEMENT
+#include "any_hash.h"
+
+#define ANY_BLOOM_IMPLEMENT
+#include "any_bloom.h"
+
+// Every added key must be found, the false positive rate must be close to
+// the requested one and the batch and loaded filters must give the same
+// answers of the single lookups
+
+#define KEYS 20000
+#define PROBES 200000
+#define RATE 0.01
+
+static char keys[KEYS + PROBES][24];
+static const uint8_t *pointers[KEYS + PROBES];
+static size_t lengths[KEYS + PROBES];
+static bool results[KEYS + PROBES];
+
+void test_bloom(const char *name, uint32_t flags)
+{
+    any_bloom_t bloom;
+    if (!any_bloom_init(&bloom, KEYS, RATE, 42, flags)) {
+        printf("%s: init failed\n", name);
+        return;
+    }
+
+    int failed = 0;
+
+    // Half of the keys are added one by one, the others with the batch
+    for (size_t i = 0; i < KEYS / 2; i++)
+        any_bloom_add(&bloom, pointers[i], lengths[i]);
+    any_bloom_add_batch(&bloom, pointers + KEYS / 2, lengths + KEYS / 2, KEYS - KEYS / 2);
+
+    size_t positives = 0;
+    for (size_t i = 0; i < KEYS + PROBES; i++) {
+        const bool found = any_bloom_has(&bloom, pointers[i], lengths[i]);
+        if (i < KEYS)
+            failed += !found;
+        else
+            positives += found;
+    }
+
+    // The blocked filter has a slightly higher rate
+    const double rate = (double)positives / PROBES;
+    if (rate > RATE * 1.5) {
+        printf("%s: false positive rate %.4f\n", name, rate);
+        failed++;
+    }
+
+    any_bloom_has_batch(&bloom, pointers, lengths, KEYS + PROBES, results);
+    for (size_t i = 0; i < KEYS + PROBES; i++)
+        failed += results[i] != any_bloom_has(&bloom, pointers[i], lengths[i]);
+
+    // Load a copy of the serialized filter
+    const size_t size = any_bloom_serialized_size(&bloom);
+    uint8_t *buffer = malloc(size);
+    any_bloom_serialize(&bloom, buffer);
+
+    any_bloom_t loaded;
+    if (!any_bloom_load(&loaded, buffer, size)) {
+        printf("%s: load failed\n", name);
+        failed++;
+    } else {
+        for (size_t i = 0; i < KEYS + PROBES; i++)
+            failed += any_bloom_has(&loaded, pointers[i], lengths[i]) != results[i];
+        any_bloom_free(&loaded);
+    }
+
+    // Truncated or corrupted filters are rejected
+    failed += any_bloom_load(&loaded, buffer, size - 1);
+    buffer[0] = 'X';
+    failed += any_bloom_load(&loaded, buffer, size);
+
+    printf("%s: %zu bits, %u hashes, false positive rate %.4f, %d failed\n",
+           name, (size_t)bloom.size, bloom.hashes, rate, failed);
+
+    free(buffer);
+    any_bloom_free(&bloom);
+}
+
+int main()
+{
+    for (size_t i = 0; i < KEYS + PROBES; i++) {
+        lengths[i] = snprintf(keys[i], sizeof(keys[i]), "/cache/%zu", i * 2654435761u);
+        pointers[i] = (const uint8_t *)keys[i];
+    }
+
+    test_bloom("bloom", 0);
+    test_bloom("bloom blocked", ANY_BLOOM_BLOCKED);
+    return 0;
+}
@@ -0,0 +1,659 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <unistd.h>
+
+#define ANY_HASH_IMPLEMENT
+#include "any_hash.h"
+
+// The expected values were computed with the xxHash library on a buffer
+// filled like the one of its sanity check (see fill_buffer)
+
+#define BUFFER_SIZE 4096
+
+typedef struct {
+    size_t length;
+    uint64_t seed;
+    uint64_t hash;
+} test_vector_t;
+
+static const test_vector_t xxh32_vectors[] = {
+    {    0, 0x00000000, 0x02cc5d05 },
+    {    0, 0x85ebca8d, 0x058efd0e },
+    {    1, 0x00000000, 0xcf65b03e },
+    {    1, 0x85ebca8d, 0x66a77325 },
+    {    4, 0x00000000, 0xa9de7ce9 },
+    {    4, 0x85ebca8d, 0xe0b5e0d6 },
+    {    9, 0x00000000, 0xffb82a24 },
+    {    9, 0x85ebca8d, 0xbfe9250e },
+    {   17, 0x00000000, 0x89fdc23e },
+    {   17, 0x85ebca8d, 0xeb6e058d },
+    {   65, 0x00000000, 0x16992b3d },
+    {   65, 0x85ebca8d, 0x6d4ff516 },
+    {  129, 0x00000000, 0x68c9ec37 },
+    {  129, 0x85ebca8d, 0x4f7944a0 },
+    {  241, 0x00000000, 0xe5f7c54d },
+    {  241, 0x85ebca8d, 0xfad8b9e6 },
+    { 1025, 0x00000000, 0x75b3b8a1 },
+    { 1025, 0x85ebca8d, 0x33e60335 },
+    { 4096, 0x00000000, 0x20fc444f },
+    { 4096, 0x85ebca8d, 0x3a919988 },
+};
+
+static const test_vector_t xxh64_vectors[] = {
+    {    0, 0x0000000000000000, 0xef46db3751d8e999 },
+    {    0, 0x9e3779b185ebca8d, 0x0b303d920ec349df },
+    {    1, 0x0000000000000000, 0xe934a84adb052768 },
+    {    1, 0x9e3779b185ebca8d, 0x9c6678669fcd2e6d },
+    {    4, 0x0000000000000000, 0x9136a0dca57457ee },
+    {    4, 0x9e3779b185ebca8d, 0xccfe4ead7e01983c },
+    {    9, 0x0000000000000000, 0x554b1ae991eda6b6 },
+    {    9, 0x9e3779b185ebca8d, 0x6a7ef24927b938a0 },
+    {   17, 0x0000000000000000, 0x0d39a2d051a30c2c },
+    {   17, 0x9e3779b185ebca8d, 0x1dd902d73122eda0 },
+    {   65, 0x0000000000000000, 0xde0f20dc2631af7a },
+    {   65, 0x9e3779b185ebca8d, 0x7814174cd6405bee },
+    {  129, 0x0000000000000000, 0x41c280132d697aba },
+    {  129, 0x9e3779b185ebca8d, 0xaeb872c374eabf84 },
+    {  241, 0x0000000000000000, 0x95d76c8b4d8fc4d6 },
+    {  241, 0x9e3779b185ebca8d, 0x6bd0db4ef4123409 },
+    { 1025, 0x0000000000000000, 0x847fa6006d7c2ac0 },
+    { 1025, 0x9e3779b185ebca8d, 0x880172cbae03711f },
+    { 4096, 0x0000000000000000, 0xab77f4af85f4e70b },
+    { 4096, 0x9e3779b185ebca8d, 0x7b950d3ad86dcd2c },
+};
+
+static const test_vector_t xxh3_64_vectors[] = {
+    {    0, 0x0000000000000000, 0x2d06800538d394c2 },
+    {    0, 0x9e3779b185ebca8d, 0xa8a6b918b2f0364a },
+    {    1, 0x0000000000000000, 0xc44bdff4074eecdb },
+    {    1, 0x9e3779b185ebca8d, 0x032be332dd766ef8 },
+    {    4, 0x0000000000000000, 0xe5dc74bc51848a51 },
+    {    4, 0x9e3779b185ebca8d, 0xaa2e7eccb0c8f747 },
+    {    9, 0x0000000000000000, 0x14d5001c15dd3f2b },
+    {    9, 0x9e3779b185ebca8d, 0xb3ae7333d9013f60 },
+    {   17, 0x0000000000000000, 0x796f5acd3a60f862 },
+    {   17, 0x9e3779b185ebca8d, 0xf3ec5067f4306db3 },
+    {   65, 0x0000000000000000, 0xfd81aac4bebc3883 },
+    {   65, 0x9e3779b185ebca8d, 0xad80aeec1fc9e0a7 },
+    {  129, 0x0000000000000000, 0x98f1b0a679a2ca29 },
+    {  129, 0x9e3779b185ebca8d, 0x21fffdbca099c844 },
+    {  241, 0x0000000000000000, 0xc5a639ecd2030e5e },
+    {  241, 0x9e3779b185ebca8d, 0xdda9b0a161d4829a },
+    { 1025, 0x0000000000000000, 0xd870c0fa13211c6a },
+    { 1025, 0x9e3779b185ebca8d, 0x96792bcf9af88519 },
+    { 4096, 0x0000000000000000, 0xe91206429d1f48f9 },
+    { 4096, 0x9e3779b185ebca8d, 0x2a3bbb20a5439dcd },
+};
+
+typedef struct {
+    size_t length;
+    uint64_t seed;
+    uint64_t low;
+    uint64_t high;
+} test_vector128_t;
+
+static const test_vector128_t xxh128_vectors[] = {
+    {    0, 0x0000000000000000, 0x6001c324468d497f, 0x99aa06d3014798d8 },
+    {    0, 0x9e3779b185ebca8d, 0xa986dfc5d7605bfe, 0x00feaa732a3ce25e },
+    {    1, 0x0000000000000000, 0xc44bdff4074eecdb, 0xa6cd5e9392000f6a },
+    {    1, 0x9e3779b185ebca8d, 0x032be332dd766ef8, 0x20e49abcc53b3842 },
+    {    4, 0x0000000000000000, 0x2e7d8d6876a39fe9, 0x970d585ac632bf8e },
+    {    4, 0x9e3779b185ebca8d, 0xbfaf51f1e67e0b0f, 0x3d53e5dfd837d927 },
+    {    9, 0x0000000000000000, 0xed7ccbc501eb7501, 0x564ef6078950d457 },
+    {    9, 0x9e3779b185ebca8d, 0xaef5dfc0ac9f9044, 0x6b380b43ffa61042 },
+    {   17, 0x0000000000000000, 0xabbc12d11973d7db, 0x955fa78643ed3669 },
+    {   17, 0x9e3779b185ebca8d, 0x980a14119985a7df, 0xd77681219e464828 },
+    {   65, 0x0000000000000000, 0xfe2f650fa500ec6e, 0x6c074d65e54db85a },
+    {   65, 0x9e3779b185ebca8d, 0x9d60c345e5c297cd, 0x72503a6fa8d07adb },
+    {  129, 0x0000000000000000, 0x86c9e3bc8f0a3b5c, 0x03815fc91f1b30b6 },
+    {  129, 0x9e3779b185ebca8d, 0xd4aae26fcec7dc03, 0xad559266067c0bf3 },
+    {  241, 0x0000000000000000, 0xc5a639ecd2030e5e, 0x99a80ecf0ecfc647 },
+    {  241, 0x9e3779b185ebca8d, 0xdda9b0a161d4829a, 0xec64afae6a137582 },
+    { 1025, 0x0000000000000000, 0xd870c0fa13211c6a, 0xfd3ee4fe7f2954c6 },
+    { 1025, 0x9e3779b185ebca8d, 0x96792bcf9af88519, 0x2c383949f57bf7e1 },
+    { 4096, 0x0000000000000000, 0xe91206429d1f48f9, 0xb9cfaea2ca5626a4 },
+    { 4096, 0x9e3779b185ebca8d, 0x2a3bbb20a5439dcd, 0x8fbc8fd4d526d1bd },
+};
+
+// The keyed vectors use the secret filled by fill_secret
+static const test_vector_t xxh3_64_secret_vectors[] = {
+    {    0, 0, 0x426a3ef446e845aa },
+    {    1, 0, 0xcaa9c5ffb8db4b76 },
+    {    4, 0, 0x0126d5532064f4ff },
+    {    9, 0, 0xdc5a446eaa304212 },
+    {   17, 0, 0xe755a223a91c337c },
+    {   65, 0, 0xc6a701e3f59a8c2d },
+    {  129, 0, 0x4ce14b0646e2f849 },
+    {  241, 0, 0x29a0bdb752c22cd6 },
+    { 1025, 0, 0xe8f9990987b148a5 },
+    { 4096, 0, 0x454ea47daefe3365 },
+};
+
+static const test_vector128_t xxh128_secret_vectors[] = {
+    {    0, 0, 0x3ade9c171db9a5af, 0xdf453db66daa3b18 },
+    {    1, 0, 0xcaa9c5ffb8db4b76, 0x43f21b5d3936c35a },
+    {    4, 0, 0x972eb6d96fe25b30, 0x5eeec41adaab9ae0 },
+    {    9, 0, 0xfb458a92a580527d, 0x3b8081c2ae8fcdd7 },
+    {   17, 0, 0x9532d4595ee4b338, 0x0d53b1197c9dc297 },
+    {   65, 0, 0xf8cdf51ca767ac0b, 0x3cdb882e1adb8654 },
+    {  129, 0, 0x5684be148c2d4bb0, 0x397d37217a218a78 },
+    {  241, 0, 0x29a0bdb752c22cd6, 0x18c2dbecd8313403 },
+    { 1025, 0, 0xe8f9990987b148a5, 0xc6952a1f009f7500 },
+    { 4096, 0, 0x454ea47daefe3365, 0x55c7d5c6763adeea },
+};
+
+#define VECTORS(v) v, sizeof(v) / sizeof(*v)
+
+// The buffers are kept as uint64_t to be sure about their alignment
+static uint64_t aligned[BUFFER_SIZE / 8];
+static uint64_t unaligned[BUFFER_SIZE / 8 + 1];
+
+static uint8_t secret[ANY_HASH_SECRET_SIZE];
+
+void fill_buffer(uint8_t *data, size_t length)
+{
+    uint64_t gen = 2654435761u;
+    for (size_t i = 0; i < length; i++) {
+        data[i] = (uint8_t)(gen >> 56);
+        gen *= 11400714785074694797ull;
+    }
+}
+
+void fill_secret(uint8_t *data)
+{
+    uint64_t gen = 0x9e3779b185ebca8d;
+    for (size_t i = 0; i < ANY_HASH_SECRET_SIZE; i++) {
+        data[i] = (uint8_t)(gen >> 56);
+        gen *= 11400714785074694797ull;
+    }
+}
+
+// Every vector is checked both on an aligned and an unaligned pointer
+#define TEST_HASH(name, func, vectors, count) \
+    do { \
+        int failed = 0; \
+        for (size_t i = 0; i < count; i++) { \
+            const test_vector_t *v = &vectors[i]; \
+            const uint8_t *buffers[] = { (uint8_t *)aligned, (uint8_t *)unaligned + 1 }; \
+            for (size_t j = 0; j < 2; j++) { \
+                uint64_t hash = func(buffers[j], v->length, v->seed); \
+                if (hash != v->hash) { \
+                    printf("%s(%zu, %#" PRIx64 ")%s = %#" PRIx64 " (expected %#" PRIx64 ")\n", \
+                           name, v->length, v->seed, j ? " unaligned" : "", hash, v->hash); \
+                    failed++; \
+                } \
+            } \
+        } \
+        printf("%s: %zu vectors, %d failed\n", name, count, failed); \
+    } while (0)
+
+void test_xxh32(const test_vector_t *vectors, size_t count)
+{
+    TEST_HASH("xxh32", any_hash_xxh32, vectors, count);
+}
+
+void test_xxh64(const test_vector_t *vectors, size_t count)
+{
+    TEST_HASH("xxh64", any_hash_xxh64, vectors, count);
+}
+
+void test_xxh3_64(const test_vector_t *vectors, size_t count)
+{
+    TEST_HASH("xxh3_64", any_hash_xxh3_64, vectors, count);
+}
+
+// The seed is ignored by the keyed functions
+static uint64_t xxh3_64_secret(const uint8_t *data, size_t length, uint64_t seed)
+{
+    (void)seed;
+    return any_hash_xxh3_64_secret(data, length, secret);
+}
+
+static any_hash128_t xxh128_secret(const uint8_t *data, size_t length, uint64_t seed)
+{
+    (void)seed;
+    return any_hash_xxh128_secret(data, length, secret);
+}
+
+void test_xxh3_64_secret(const test_vector_t *vectors, size_t count)
+{
+    TEST_HASH("xxh3_64 secret", xxh3_64_secret, vectors, count);
+}
+
+void test_xxh128(const char *name, any_hash128_t (*func)(const uint8_t *, size_t, uint64_t),
+                 const test_vector128_t *vectors, size_t count)
+{
+    int failed = 0;
+    for (size_t i = 0; i < count; i++) {
+        const test_vector128_t *v = &vectors[i];
+        const uint8_t *buffers[] = { (uint8_t *)aligned, (uint8_t *)unaligned + 1 };
+        for (size_t j = 0; j < 2; j++) {
+            any_hash128_t hash = func(buffers[j], v->length, v->seed);
+            if (hash.low != v->low || hash.high != v->high) {
+                printf("%s(%zu, %#" PRIx64 ")%s = %016" PRIx64 "%016" PRIx64 " (expected %016" PRIx64 "%016" PRIx64 ")\n",
+                       name, v->length, v->seed, j ? " unaligned" : "", hash.high, hash.low, v->high, v->low);
+                failed++;
+            }
+        }
+    }
+    printf("%s: %zu vectors, %d failed\n", name, count, failed);
+}
+
+#ifndef ANY_HASH_NO_RANDOM
+
+// Two random secrets must differ
+void test_secret_random(void)
+{
+    uint8_t first[ANY_HASH_SECRET_SIZE], second[ANY_HASH_SECRET_SIZE];
+    int failed = 0;
+
+    if (!any_hash_secret_random(first) || !any_hash_secret_random(second)) {
+        printf("secret random: %s\n", strerror(errno));
+        failed++;
+    } else if (memcmp(first, second, ANY_HASH_SECRET_SIZE) == 0)
+        failed++;
+
+    printf("secret random: %d failed\n", failed);
+}
+
+#endif
+
+// Hash the buffer in pieces of varying size
+#define TEST_STREAM(name, bits, vectors, count) \
+    do { \
+        static const size_t pieces[] = { 1, 3, 16, 5, 33, 64, 7, 250 }; \
+        int failed = 0; \
+        for (size_t i = 0; i < count; i++) { \
+            const test_vector_t *v = &vectors[i]; \
+            any_hash_xxh##bits##_state_t state; \
+            any_hash_xxh##bits##_reset(&state, v->seed); \
+            for (size_t off = 0, p = 0; off < v->length; p++) { \
+                size_t piece = pieces[p % 8]; \
+                if (piece > v->length - off) \
+                    piece = v->length - off; \
+                any_hash_xxh##bits##_update(&state, (uint8_t *)unaligned + 1 + off, piece); \
+                off += piece; \
+            } \
+            uint64_t hash = any_hash_xxh##bits##_digest(&state); \
+            if (hash != v->hash) { \
+                printf("%s(%zu, %#" PRIx64 ") = %#" PRIx64 " (expected %#" PRIx64 ")\n", \
+                       name, v->length, v->seed, hash, v->hash); \
+                failed++; \
+            } \
+        } \
+        printf("%s: %zu vectors, %d failed\n", name, count, failed); \
+    } while (0)
+
+void test_xxh32_stream(const test_vector_t *vectors, size_t count)
+{
+    TEST_STREAM("xxh32 stream", 32, vectors, count);
+}
+
+void test_xxh64_stream(const test_vector_t *vectors, size_t count)
+{
+    TEST_STREAM("xxh64 stream", 64, vectors, count);
+}
+
+// Hash keys of every length up to a few stripes, at different offsets,
+// and compare the results with the one shot function
+#define BATCH_KEYS 320
+
+#define TEST_BATCH(name, bits) \
+    do { \
+        const uint8_t *keys[BATCH_KEYS]; \
+        size_t lengths[BATCH_KEYS]; \
+        any_hash##bits##_t hashes[BATCH_KEYS]; \
+        for (size_t i = 0; i < BATCH_KEYS; i++) { \
+            keys[i] = (uint8_t *)unaligned + 1 + (i * 7) % 64; \
+            lengths[i] = i % 3 == 0 ? (i * 13) % 1024 : i; \
+        } \
+        int failed = 0; \
+        for (size_t count = BATCH_KEYS - 7; count <= BATCH_KEYS; count++) { \
+            any_hash_xxh##bits##_batch(keys, lengths, count, (any_hash##bits##_t)count, hashes); \
+            for (size_t i = 0; i < count; i++) { \
+                uint64_t hash = any_hash_xxh##bits(keys[i], lengths[i], (any_hash##bits##_t)count); \
+                if (hashes[i] != hash) { \
+                    printf("%s(%zu, %zu) = %#" PRIx64 " (expected %#" PRIx64 ")\n", \
+                           name, count, lengths[i], (uint64_t)hashes[i], hash); \
+                    failed++; \
+                } \
+            } \
+        } \
+        printf("%s: %d keys, %d failed\n", name, BATCH_KEYS, failed); \
+    } while (0)
+
+void test_xxh32_batch(void)
+{
+    TEST_BATCH("xxh32 batch", 32);
+}
+
+void test_xxh64_batch(void)
+{
+    TEST_BATCH("xxh64 batch", 64);
+}
+
+#ifndef ANY_HASH_NO_IOV
+
+// Split the buffer in fragments of varying size, some empty
+#define TEST_IOV(name, bits, vectors, count) \
+    do { \
+        static const size_t pieces[] = { 0, 3, 16, 5, 0, 33, 64, 7, 250, 1 }; \
+        int failed = 0; \
+        for (size_t i = 0; i < count; i++) { \
+            const test_vector_t *v = &vectors[i]; \
+            struct iovec iov[BUFFER_SIZE]; \
+            int cnt = 0; \
+            for (size_t off = 0; off < v->length || cnt == 0; cnt++) { \
+                size_t piece = pieces[cnt % 10]; \
+                if (piece > v->length - off) \
+                    piece = v->length - off; \
+                iov[cnt].iov_base = (uint8_t *)unaligned + 1 + off; \
+                iov[cnt].iov_len = piece; \
+                off += piece; \
+            } \
+            uint64_t hash = any_hash_xxh##bits##_iov(iov, cnt, (any_hash##bits##_t)v->seed); \
+            if (hash != v->hash) { \
+                printf("%s(%zu, %#" PRIx64 ") = %#" PRIx64 " (expected %#" PRIx64 ")\n", \
+                       name, v->length, v->seed, hash, v->hash); \
+                failed++; \
+            } \
+        } \
+        printf("%s: %zu vectors, %d failed\n", name, count, failed); \
+    } while (0)
+
+void test_xxh32_iov(const test_vector_t *vectors, size_t count)
+{
+    TEST_IOV("xxh32 iov", 32, vectors, count);
+}
+
+void test_xxh64_iov(const test_vector_t *vectors, size_t count)
+{
+    TEST_IOV("xxh64 iov", 64, vectors, count);
+}
+
+#endif
+
+// Compare the fixed width functions with the hash of the little endian bytes
+void test_xxh64_fixed(void)
+{
+    int failed = 0, count = 0;
+    for (uint64_t i = 0; i < 64; i++) {
+        const uint64_t low = i * 0x9e3779b97f4a7c15ull, high = ~low >> (i % 64);
+        const uint64_t seed = i % 2 ? 0 : 0x9e3779b185ebca8d;
+        uint8_t bytes[16];
+        for (size_t j = 0; j < 8; j++) {
+            bytes[j] = (uint8_t)(low >> (8 * j));
+            bytes[j + 8] = (uint8_t)(high >> (8 * j));
+        }
+
+        const uint64_t hashes[3] = {
+            any_hash_xxh64_u32((uint32_t)low, seed),
+            any_hash_xxh64_u64(low, seed),
+            any_hash_xxh64_u128(low, high, seed),
+        };
+        const uint64_t expected[3] = {
+            any_hash_xxh64(bytes, 4, seed),
+            any_hash_xxh64(bytes, 8, seed),
+            any_hash_xxh64(bytes, 16, seed),
+        };
+
+        for (size_t j = 0; j < 3; j++, count++) {
+            if (hashes[j] != expected[j]) {
+                printf("xxh64 fixed(%#" PRIx64 ", %d bytes) = %#" PRIx64 " (expected %#" PRIx64 ")\n",
+                       low, 4 << j, hashes[j], expected[j]);
+                failed++;
+            }
+        }
+    }
+    printf("xxh64 fixed: %d keys, %d failed\n", count, failed);
+}
+
+// The tree hash is computed by hand from the leaves and compared with the
+// results of pools of different sizes
+void test_xxh64_tree(void)
+{
+    static const size_t lengths[] = {
+        0, 1000, ANY_HASH_TREE_LEAF, ANY_HASH_TREE_LEAF + 1,
+        2 * ANY_HASH_TREE_LEAF, 3 * ANY_HASH_TREE_LEAF + 12345,
+    };
+    static const size_t threads[] = { 1, 2, 3, 8 };
+    const size_t size = 3 * ANY_HASH_TREE_LEAF + 12345;
+    const uint64_t seed = 0x9e3779b185ebca8d;
+
+    uint8_t *data = malloc(size);
+    fill_buffer(data, size);
+
+    any_hash_pool_t *pools[4];
+    for (size_t i = 0; i < 4; i++)
+        pools[i] = any_hash_pool_new(threads[i]);
+
+    int failed = 0;
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(*lengths); i++) {
+        const size_t length = lengths[i];
+        uint64_t expected;
+
+        if (length <= ANY_HASH_TREE_LEAF)
+            expected = any_hash_xxh64(data, length, seed);
+        else {
+            uint8_t leaves[8 * 4];
+            size_t count = 0;
+            for (size_t offset = 0; offset < length; offset += ANY_HASH_TREE_LEAF, count++) {
+                const size_t rest = length - offset;
+                uint64_t hash = any_hash_xxh64(data + offset, rest < ANY_HASH_TREE_LEAF ? rest : ANY_HASH_TREE_LEAF, seed);
+                for (size_t j = 0; j < 8; j++)
+                    leaves[8 * count + j] = (uint8_t)(hash >> (8 * j));
+            }
+            expected = any_hash_xxh64(leaves, 8 * count, seed);
+        }
+
+        uint64_t hash = any_hash_xxh64_tree(NULL, data, length, seed);
+        if (hash != expected) {
+            printf("xxh64 tree(%zu) = %#" PRIx64 " (expected %#" PRIx64 ")\n", length, hash, expected);
+            failed++;
+        }
+
+        for (size_t j = 0; j < 4; j++) {
+            hash = any_hash_xxh64_tree(pools[j], data, length, seed);
+            if (hash != expected) {
+                printf("xxh64 tree(%zu) with %zu threads = %#" PRIx64 " (expected %#" PRIx64 ")\n",
+                       length, threads[j], hash, expected);
+                failed++;
+            }
+        }
+    }
+    printf("xxh64 tree: %zu lengths, %d failed\n", sizeof(lengths) / sizeof(*lengths), failed);
+
+    for (size_t i = 0; i < 4; i++)
+        any_hash_pool_free(pools[i]);
+    free(data);
+}
+
+typedef struct {
+    uint64_t offsets[1024];
+    size_t lengths[1024];
+    uint64_t hashes[1024];
+    size_t count;
+} chunks_t;
+
+static void add_chunk(void *user, uint64_t offset, size_t length, any_hash64_t hash)
+{
+    chunks_t *chunks = user;
+    if (chunks->count < 1024) {
+        chunks->offsets[chunks->count] = offset;
+        chunks->lengths[chunks->count] = length;
+        chunks->hashes[chunks->count] = hash;
+    }
+    chunks->count++;
+}
+
+// The data is chunked at once and in pieces of different sizes, which must
+// give the same chunks, then a byte is inserted in the middle, which must
+// change only the chunks around it
+void test_xxh64_chunker(void)
+{
+    static const size_t pieces[] = { 1, 7, 1000, 4096, 65536 };
+    const size_t min = 512, avg = 2048, max = 8192, size = 1 << 20;
+    const uint64_t seed = 0x9e3779b185ebca8d;
+
+    uint8_t *data = malloc(size + 1);
+    fill_buffer(data, size);
+
+    static chunks_t expected, chunks;
+    any_hash_chunker_t chunker;
+    int failed = 0;
+
+    if (any_hash_chunker_init(&chunker, avg, min, max, seed)) {
+        printf("xxh64 chunker: min > avg didn't fail\n");
+        failed++;
+    }
+
+    any_hash_chunker_init(&chunker, min, avg, max, seed);
+    any_hash_chunker_update(&chunker, data, size, add_chunk, &expected);
+    any_hash_chunker_final(&chunker, add_chunk, &expected);
+
+    uint64_t offset = 0;
+    for (size_t i = 0; i < expected.count && i < 1024; i++) {
+        const size_t length = expected.lengths[i];
+        if (expected.offsets[i] != offset || length > max || (length < min && i + 1 < expected.count) ||
+            expected.hashes[i] != any_hash_xxh64(data + offset, length, seed)) {
+            printf("xxh64 chunker: chunk %zu at %" PRIu64 " of %zu bytes is wrong\n", i, expected.offsets[i], length);
+            failed++;
+        }
+        offset += length;
+    }
+    if (offset != size || expected.count > 1024) {
+        printf("xxh64 chunker: %zu chunks cover %" PRIu64 " bytes (expected %zu)\n", expected.count, offset, size);
+        failed++;
+    }
+
+    for (size_t i = 0; i < sizeof(pieces) / sizeof(*pieces); i++) {
+        memset(&chunks, 0, sizeof(chunks));
+        for (size_t start = 0; start < size; start += pieces[i]) {
+            const size_t rest = size - start;
+            any_hash_chunker_update(&chunker, data + start, rest < pieces[i] ? rest : pieces[i], add_chunk, &chunks);
+        }
+        any_hash_chunker_final(&chunker, add_chunk, &chunks);
+
+        if (memcmp(&chunks, &expected, sizeof(chunks)) != 0) {
+            printf("xxh64 chunker: pieces of %zu bytes give different chunks\n", pieces[i]);
+            failed++;
+        }
+    }
+
+    memmove(data + size / 2 + 1, data + size / 2, size / 2);
+    data[size / 2] ^= 0x5a;
+    memset(&chunks, 0, sizeof(chunks));
+    any_hash_chunker_update(&chunker, data, size + 1, add_chunk, &chunks);
+    any_hash_chunker_final(&chunker, add_chunk, &chunks);
+
+    size_t shared = 0;
+    for (size_t i = 0, j = 0; i < expected.count && j < chunks.count;) {
+        if (expected.hashes[i] == chunks.hashes[j]) {
+            shared++;
+            i++, j++;
+        } else if (expected.offsets[i] < chunks.offsets[j])
+            i++;
+        else
+            j++;
+    }
+    if (shared + 3 < expected.count) {
+        printf("xxh64 chunker: %zu of %zu chunks survive an insertion\n", shared, expected.count);
+        failed++;
+    }
+
+    printf("xxh64 chunker: %zu chunks, %d failed\n", expected.count, failed);
+    free(data);
+}
+
+#ifndef ANY_HASH_NO_FILE
+
+// Write the buffer to a temporary file and to a pipe, to test both the mmap
+// and the read path
+#define TEST_FILE(name, bits, vectors, count) \
+    do { \
+        int failed = 0; \
+        for (size_t i = 0; i < count; i++) { \
+            const test_vector_t *v = &vectors[i]; \
+            char path[] = "/tmp/any_hash_XXXXXX"; \
+            int fd = mkstemp(path), fds[2]; \
+            any_hash##bits##_t hash = 0, piped = 0; \
+            if (fd < 0 || write(fd, aligned, v->length) != (ssize_t)v->length || \
+                !any_hash_file_xxh##bits(path, (any_hash##bits##_t)v->seed, &hash)) \
+                printf("%s(%zu): %s\n", name, v->length, strerror(errno)); \
+            if (pipe(fds) < 0 || write(fds[1], aligned, v->length) != (ssize_t)v->length || \
+                close(fds[1]) < 0 || !any_hash_fd_xxh##bits(fds[0], (any_hash##bits##_t)v->seed, &piped)) \
+                printf("%s(%zu) pipe: %s\n", name, v->length, strerror(errno)); \
+            if (hash != v->hash || piped != v->hash) { \
+                printf("%s(%zu, %#" PRIx64 ") = %#" PRIx64 ", %#" PRIx64 " (expected %#" PRIx64 ")\n", \
+                       name, v->length, v->seed, (uint64_t)hash, (uint64_t)piped, v->hash); \
+                failed++; \
+            } \
+            close(fds[0]); \
+            close(fd); \
+            unlink(path); \
+        } \
+        any_hash##bits##_t hash; \
+        if (any_hash_file_xxh##bits("/nonexistent/any_hash", 0, &hash) || errno != ENOENT) { \
+            printf("%s: a missing file didn't fail with ENOENT\n", name); \
+            failed++; \
+        } \
+        printf("%s: %zu vectors, %d failed\n", name, count, failed); \
+    } while (0)
+
+void test_xxh32_file(const test_vector_t *vectors, size_t count)
+{
+    TEST_FILE("xxh32 file", 32, vectors, count);
+}
+
+void test_xxh64_file(const test_vector_t *vectors, size_t count)
+{
+    TEST_FILE("xxh64 file", 64, vectors, count);
+}
+
+#endif
+
+int main()
+{
+    fill_buffer((uint8_t *)aligned, BUFFER_SIZE);
+    fill_buffer((uint8_t *)unaligned + 1, BUFFER_SIZE);
+    fill_secret(secret);
+
+    test_xxh32(VECTORS(xxh32_vectors));
+    test_xxh64(VECTORS(xxh64_vectors));
+    test_xxh64_fixed();
+    // The xxh3 long input loop and the batches are vectorized, so test every
+    // kernel available
+    for (int kernel = ANY_HASH_KERNEL_SCALAR; kernel < ANY_HASH_KERNEL_ALL; kernel++) {
+        if (!any_hash_set_kernel(kernel))
+            continue;
+
+        printf("kernel %s\n", any_hash_kernel_to_string(kernel));
+        test_xxh3_64(VECTORS(xxh3_64_vectors));
+        test_xxh128("xxh128", any_hash_xxh128, VECTORS(xxh128_vectors));
+        test_xxh3_64_secret(VECTORS(xxh3_64_secret_vectors));
+        test_xxh128("xxh128 secret", xxh128_secret, VECTORS(xxh128_secret_vectors));
+        test_xxh32_batch();
+        test_xxh64_batch();
+    }
+
+    test_xxh32_stream(VECTORS(xxh32_vectors));
+    test_xxh64_stream(VECTORS(xxh64_vectors));
+    test_xxh64_tree();
+    test_xxh64_chunker();
+#ifndef ANY_HASH_NO_RANDOM
+    test_secret_random();
+#endif
+#ifndef ANY_HASH_NO_IOV
+    test_xxh32_iov(VECTORS(xxh32_vectors));
+    test_xxh64_iov(VECTORS(xxh64_vectors));
+#endif
+#ifndef ANY_HASH_NO_FILE
+    test_xxh32_file(VECTORS(xxh32_vectors));
+    test_xxh64_file(VECTORS(xxh64_vectors));
+#endif
+
+    return 0;
+}
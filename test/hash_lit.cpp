@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include <string.h>
+
+#define ANY_HASH_IMPLEMENT
+#include "any_hash.h"
+
+// The compile time hashes must be equal to the runtime ones for every
+// length around the stripe sizes, and usable as case labels
+
+static_assert(ANY_HASH_LIT32("") == 0x02cc5d05u, "xxh32 of the empty string");
+static_assert(ANY_HASH_LIT64("") == 0xef46db3751d8e999ull, "xxh64 of the empty string");
+
+static int command(const char *name)
+{
+    switch (any_hash_xxh32((const uint8_t *)name, strlen(name), 0)) {
+    case ANY_HASH_LIT32("get"):
+        return 1;
+    case ANY_HASH_LIT32("set"):
+        return 2;
+    case ANY_HASH_LIT32("a command name longer than sixteen bytes"):
+        return 3;
+    default:
+        return 0;
+    }
+}
+
+static int option(const char *name)
+{
+    switch (any_hash_xxh64((const uint8_t *)name, strlen(name), 0)) {
+    case ANY_HASH_LIT64("timeout"):
+        return 1;
+    case ANY_HASH_LIT64("an option name longer than thirty two bytes"):
+        return 2;
+    default:
+        return 0;
+    }
+}
+
+int main()
+{
+    char data[128];
+    for (size_t i = 0; i < sizeof(data); i++)
+        data[i] = (char)(i * 2654435761u >> 24);
+
+    static const uint64_t seeds[] = { 0, 1, 0x9e3779b185ebca8d };
+
+    int failed = 0;
+    for (size_t length = 0; length <= sizeof(data); length++) {
+        for (size_t i = 0; i < 3; i++) {
+            const uint8_t *bytes = (const uint8_t *)data;
+            failed += any_hash_xxh32_constexpr(data, length, (any_hash32_t)seeds[i])
+                      != any_hash_xxh32(bytes, length, (any_hash32_t)seeds[i]);
+            failed += any_hash_xxh64_constexpr(data, length, seeds[i]) != any_hash_xxh64(bytes, length, seeds[i]);
+        }
+    }
+
+    failed += command("get") != 1 || command("set") != 2 || command("a command name longer than sixteen bytes") != 3;
+    failed += command("del") != 0;
+    failed += option("timeout") != 1 || option("an option name longer than thirty two bytes") != 2;
+    failed += option("retries") != 0;
+
+    printf("hash literals: %zu lengths, %d failed\n", sizeof(data) + 1, failed);
+    return 0;
+}
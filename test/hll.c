@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <math.h>
+
+#define ANY_HASH_IMPLEMENT
+#include "any_hash.h"
+
+#define ANY_HLL_IMPLEMENT
+#include "any_hll.h"
+
+// The estimates must be within three standard errors of the cardinality
+// (the sparse ones are almost exact), and merging the sketches of disjoint
+// parts of the keys must give the same estimate of a single sketch
+
+#define PRECISION 14
+#define PARTS 4
+
+static const size_t cardinalities[] = { 0, 1, 10, 100, 1000, 3000, 10000, 30000, 100000, 1000000 };
+
+void test_hll(void)
+{
+    const double error = 3 * 1.04 / sqrt(1 << PRECISION);
+    int failed = 0;
+
+    for (size_t c = 0; c < sizeof(cardinalities) / sizeof(*cardinalities); c++) {
+        const size_t cardinality = cardinalities[c];
+
+        any_hll_t hll, parts[PARTS];
+        any_hll_init(&hll, PRECISION, 42);
+        for (int i = 0; i < PARTS; i++)
+            any_hll_init(&parts[i], PRECISION, 42);
+
+        // Every key is added twice
+        for (size_t i = 0; i < 2 * cardinality; i++) {
+            const uint64_t key = (i % cardinality) * 0x9e3779b97f4a7c15ull;
+            any_hll_add(&hll, (const uint8_t *)&key, sizeof(key));
+            any_hll_add(&parts[key % PARTS], (const uint8_t *)&key, sizeof(key));
+        }
+
+        for (int i = 1; i < PARTS; i++)
+            any_hll_merge(&parts[0], &parts[i]);
+
+        const double estimate = any_hll_count(&hll);
+        const double merged = any_hll_count(&parts[0]);
+        const double relative = cardinality > 0 ? fabs(estimate - cardinality) / cardinality : estimate;
+
+        if (relative > error || fabs(merged - estimate) > 1e-6 * (estimate + 1)) {
+            printf("hll(%zu) = %.1f, merged %.1f\n", cardinality, estimate, merged);
+            failed++;
+        }
+
+        printf("hll(%zu): %s, error %.3f%%\n", cardinality, hll.registers ? "dense" : "sparse", 100 * relative);
+
+        any_hll_free(&hll);
+        for (int i = 0; i < PARTS; i++)
+            any_hll_free(&parts[i]);
+    }
+
+    // Sketches with different parameters can't be merged
+    any_hll_t a, b;
+    any_hll_init(&a, 12, 0);
+    any_hll_init(&b, 13, 0);
+    failed += any_hll_merge(&a, &b);
+    failed += any_hll_init(&b, 3, 0);
+    any_hll_free(&a);
+    any_hll_free(&b);
+
+    printf("hll: %zu cardinalities, %d failed\n", sizeof(cardinalities) / sizeof(*cardinalities), failed);
+}
+
+int main()
+{
+    test_hll();
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#define ANY_LOG_IMPLEMENT
+#define ANY_LOG_MODULE "test"
+#include "any_log.h"
+
+// Every record logged by the threads must be written whole, exactly once
+// and in the order of its thread, unless it was dropped and counted. The
+// synchronous mode must not interleave the records as well.
+
+#ifndef ANY_LOG_NO_ASYNC
+
+#define THREADS 4
+#define RECORDS 20000
+
+static void *producer(void *data)
+{
+    const int thread = (int)(size_t)data;
+    for (int i = 0; i < RECORDS; i++)
+        log_info("thread %d record %d %s", thread, i, "padding padding padding");
+    return NULL;
+}
+
+void test_async(const char *name, bool async, any_log_overflow_t overflow)
+{
+    FILE *file = tmpfile();
+    any_log_init(file, ANY_LOG_INFO);
+    any_log_colors = any_log_colors_disabled;
+
+    if (async && !any_log_async_start(0, overflow)) {
+        printf("%s: start failed\n", name);
+        return;
+    }
+
+    pthread_t threads[THREADS];
+    for (int i = 0; i < THREADS; i++)
+        pthread_create(&threads[i], NULL, producer, (void *)(size_t)i);
+    for (int i = 0; i < THREADS; i++)
+        pthread_join(threads[i], NULL);
+
+    // A long record is truncated to a line only in the asynchronous mode
+    any_log_flush();
+    char *long_message = malloc(2 * ANY_LOG_RECORD_SIZE);
+    memset(long_message, 'x', 2 * ANY_LOG_RECORD_SIZE - 1);
+    long_message[2 * ANY_LOG_RECORD_SIZE - 1] = '\0';
+    log_warn("%s", long_message);
+    free(long_message);
+
+    any_log_flush();
+    any_log_async_stop();
+    const size_t dropped = async ? any_log_dropped() : 0;
+
+    int failed = 0, next[THREADS] = {0};
+    size_t lines = 0, reported = 0, long_lines = 0;
+    char line[3 * ANY_LOG_RECORD_SIZE];
+
+    rewind(file);
+    while (fgets(line, sizeof(line), file)) {
+        int thread, record;
+        unsigned long long count;
+
+        if (sscanf(line, "[test producer] info: thread %d record %d", &thread, &record) == 2
+            && thread >= 0 && thread < THREADS) {
+            failed += record < next[thread]
+                || strcmp(strrchr(line, ' '), " padding\n") != 0;
+            next[thread] = record + 1;
+            lines++;
+        } else if (strncmp(line, "[test test_async] warn: xxx", 27) == 0) {
+            const size_t length = async ? ANY_LOG_RECORD_SIZE - 1 : 24 + 2 * ANY_LOG_RECORD_SIZE;
+            failed += strlen(line) != length || line[strlen(line) - 1] != '\n';
+            long_lines++;
+        } else if (sscanf(line, "any_log: %llu records dropped", &count) == 1) {
+            reported += count;
+        } else {
+            failed++;
+        }
+    }
+
+    failed += long_lines != 1;
+    failed += lines + dropped != THREADS * RECORDS;
+    failed += overflow == ANY_LOG_BLOCK && dropped != 0;
+    failed += overflow == ANY_LOG_COUNT && reported != dropped;
+
+    printf("%s: %d failed\n", name, failed);
+    fclose(file);
+}
+
+#endif
+
+int main()
+{
+#ifndef ANY_LOG_NO_ASYNC
+    test_async("sync", false, ANY_LOG_BLOCK);
+    test_async("async block", true, ANY_LOG_BLOCK);
+    test_async("async drop", true, ANY_LOG_DROP);
+    test_async("async count", true, ANY_LOG_COUNT);
+#endif
+
+    any_log_init(stdout, ANY_LOG_INFO);
+    return 0;
+}
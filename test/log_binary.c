@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+#define ANY_LOG_IMPLEMENT
+#define ANY_LOG_MODULE "test"
+#include "any_log.h"
+
+// A binary log, once decoded, must be the same of the text log of the same
+// calls, including the calls that are written as text records
+
+#ifndef ANY_LOG_NO_BINARY
+
+static void log_calls(void)
+{
+    const char *name = "binary";
+    char unterminated[3] = { 'a', 'b', 'c' };
+
+    for (int i = 0; i < 3; i++) {
+        log_info("plain message");
+        log_info("int %d %5d %-3i| %u %x %#o %hhd %hd %c", -i, i, i, 3000000000u, 255, 8, 300, 70000, 'a' + i);
+        log_warn("long %ld %#lx %lld %zu %jd %td", -1L, 0xabcL, 1LL << 40, (size_t)i, (intmax_t)-5, (ptrdiff_t)7);
+        log_error("real %f %.3f %e %g %10.4Lf %a", 1.5, 2.0 / 3, 1e300, 0.0001, (long double)i / 3, 0.5);
+        log_debug("string %s %10s %-6s| %p", name, name, "x", (void *)&name);
+        log_info("star %*d %-*d %.*s %.*s %*.*f %%", 6, i, 4, i, 2, unterminated, -1, "all", 8, 2, 3.14159);
+        log_info("text %ls %.2s", L"wide", name);
+        log_trace("filtered %d", i);
+        log_value_info("value", "d:i", i, "s", "text");
+    }
+}
+
+// Volatile so that the compiler can't see that it's null
+static const char *volatile null_string = NULL;
+
+static char *read_file(FILE *file, size_t *length)
+{
+    fflush(file);
+    *length = (size_t)ftell(file);
+    char *data = malloc(*length + 1);
+
+    rewind(file);
+    *length = fread(data, 1, *length, file);
+    data[*length] = '\0';
+    return data;
+}
+
+void test_binary(const char *name, bool async)
+{
+    FILE *text = tmpfile(), *binary = tmpfile(), *decoded = tmpfile();
+    size_t text_length, binary_length, decoded_length;
+    int failed = 0;
+
+    any_log_colors = any_log_colors_disabled;
+
+    any_log_init(text, ANY_LOG_DEBUG);
+    log_calls();
+    char *expected = read_file(text, &text_length);
+
+    any_log_init_binary(binary, ANY_LOG_DEBUG);
+    if (async)
+        failed += !any_log_async_start(0, ANY_LOG_BLOCK);
+    log_calls();
+    if (async)
+        any_log_async_stop();
+    char *data = read_file(binary, &binary_length);
+
+    failed += !any_log_decode(data, binary_length, decoded, false);
+    char *result = read_file(decoded, &decoded_length);
+    failed += decoded_length != text_length || strcmp(result, expected) != 0;
+
+    // A record cut at the end is ignored
+    rewind(decoded);
+    failed += !any_log_decode(data, binary_length - 3, decoded, false);
+
+    // The decoding of a corrupted log fails
+    data[0] = 'X';
+    failed += any_log_decode(data, binary_length, decoded, false);
+
+    // The null strings are written as "(null)", only in the binary mode
+    // since printf doesn't have to support them
+    FILE *nulls = tmpfile();
+    any_log_init_binary(nulls, ANY_LOG_DEBUG);
+    log_info("null %s", null_string);
+    char *null_data = read_file(nulls, &binary_length);
+
+    rewind(decoded);
+    failed += !any_log_decode(null_data, binary_length, decoded, false);
+    fflush(decoded);
+    decoded_length = (size_t)ftell(decoded);
+    rewind(decoded);
+    free(result);
+    result = malloc(decoded_length + 1);
+    result[fread(result, 1, decoded_length, decoded)] = '\0';
+    failed += strstr(result, "null (null)\n") == NULL;
+
+    free(null_data);
+    fclose(nulls);
+
+    printf("%s: %d failed\n", name, failed);
+
+    free(expected);
+    free(data);
+    free(result);
+    fclose(text);
+    fclose(binary);
+    fclose(decoded);
+}
+
+#endif
+
+int main()
+{
+#ifndef ANY_LOG_NO_BINARY
+    test_binary("binary", false);
+    test_binary("binary async", true);
+#endif
+
+    any_log_init(stdout, ANY_LOG_INFO);
+    return 0;
+}
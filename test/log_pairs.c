@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#define ANY_LOG_IMPLEMENT
+#define ANY_LOG_MODULE "test"
+#include "any_log.h"
+
+// log_pairs_[level] must write the same bytes of log_value_[level] with the
+// matching type specifiers, with and without custom types (the pairs
+// without them are formatted without printf)
+
+struct pair {
+    const char *s1, *s2;
+};
+
+void pairs_format(FILE *stream, struct pair *pairs)
+{
+    fprintf(stream, "[");
+    for (int i = 0; pairs[i].s1 && pairs[i].s2; i++)
+        fprintf(stream, "%s%s -> %s", i > 0 ? ", " : "", pairs[i].s1, pairs[i].s2);
+    fprintf(stream, "]");
+}
+
+static char *read_file(FILE *file)
+{
+    fflush(file);
+    const size_t length = (size_t)ftell(file);
+    char *data = malloc(length + 1);
+
+    rewind(file);
+    data[fread(data, 1, length, file)] = '\0';
+    return data;
+}
+
+int main()
+{
+    FILE *values = tmpfile(), *pairs = tmpfile();
+    int failed = 0;
+
+    struct pair list[] = { { "v", "v2" }, { "23", "42" }, { NULL, NULL } };
+    const char *name = "nice app";
+    char buffer[] = "buffer";
+    const short small = -3;
+    const unsigned char byte = 200;
+    const long big = -(1L << 40);
+    const float scale = 1.25f;
+    const int width = 100;
+
+    any_log_colors = any_log_colors_disabled;
+
+    any_log_init(values, ANY_LOG_DEBUG);
+    log_value_info("Created graphical context",
+                   "d:width", width,
+                   "d:small", small,
+                   "x:byte", byte,
+                   "u:mask", 0xffu,
+                   "l:big", big,
+                   "p:window", NULL,
+                   "p:list", (void *)list,
+                   "f:scale", scale,
+                   "f:dpi", 96.5,
+                   "b:hidden", width > 50,
+                   "b:shown", 0,
+                   "g:pairs", ANY_LOG_FORMATTER(pairs_format), list,
+                   "s:buffer", buffer,
+                   "appname", name);
+    log_value_warn("One pair", "d:x", 1);
+    log_value_error("Limits",
+                    "d:min", INT_MIN, "d:max", INT_MAX, "d:zero", 0,
+                    "x:zero", 0u, "x:max", UINT_MAX,
+                    "l:min", LONG_MIN, "l:max", LONG_MAX,
+                    "s:null", (char *)NULL, "s:empty", "",
+                    "b:true", 1, "p:null", NULL);
+    log_info("Wide [min=%lld, max=%lld, max=%#llx, zero=0, size=%#lx]",
+             LLONG_MIN, LLONG_MAX, ULLONG_MAX, (unsigned long)sizeof(struct pair));
+
+    any_log_init(pairs, ANY_LOG_DEBUG);
+    log_pairs_info("Created graphical context",
+                   ANY_LOG_PAIR("width", width),
+                   ANY_LOG_PAIR("small", small),
+                   ANY_LOG_PAIR("byte", byte),
+                   ANY_LOG_PAIR("mask", 0xffu),
+                   ANY_LOG_PAIR("big", big),
+                   ANY_LOG_PAIR("window", NULL),
+                   ANY_LOG_PAIR("list", (void *)list),
+                   ANY_LOG_PAIR("scale", scale),
+                   ANY_LOG_PAIR("dpi", 96.5),
+                   ANY_LOG_PAIR_BOOL("hidden", width > 50),
+                   ANY_LOG_PAIR("shown", (bool)0),
+                   ANY_LOG_PAIR_GENERIC("pairs", pairs_format, list),
+                   ANY_LOG_PAIR("buffer", buffer),
+                   ANY_LOG_PAIR("appname", name));
+    log_pairs_warn("One pair", ANY_LOG_PAIR("x", 1));
+    log_pairs_error("Limits",
+                    ANY_LOG_PAIR("min", INT_MIN), ANY_LOG_PAIR("max", INT_MAX), ANY_LOG_PAIR("zero", 0),
+                    ANY_LOG_PAIR("zero", 0u), ANY_LOG_PAIR("max", UINT_MAX),
+                    ANY_LOG_PAIR("min", LONG_MIN), ANY_LOG_PAIR("max", LONG_MAX),
+                    ANY_LOG_PAIR("null", (char *)NULL), ANY_LOG_PAIR("empty", ""),
+                    ANY_LOG_PAIR_BOOL("true", 1), ANY_LOG_PAIR("null", NULL));
+    log_pairs_info("Wide",
+                   ANY_LOG_PAIR("min", LLONG_MIN), ANY_LOG_PAIR("max", LLONG_MAX),
+                   ANY_LOG_PAIR("max", ULLONG_MAX), ANY_LOG_PAIR("zero", 0ul),
+                   ANY_LOG_PAIR("size", sizeof(struct pair)));
+    log_pairs_trace("Filtered", ANY_LOG_PAIR("x", 1));
+
+    char *expected = read_file(values), *result = read_file(pairs);
+    failed += strcmp(expected, result) != 0;
+
+    printf("pairs: %d failed\n", failed);
+
+    free(expected);
+    free(result);
+    fclose(values);
+    fclose(pairs);
+    return 0;
+}
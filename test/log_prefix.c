@@ -0,0 +1,44 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A custom prefix can change at every record, so the call sites must not
+// keep it
+static int counter;
+
+#define ANY_LOG_IMPLEMENT
+#define ANY_LOG_MODULE "test"
+#define ANY_LOG_FORMAT_BEFORE(level, module, func) "%d %s: ", ++counter, any_log_level_strings[level]
+#include "any_log.h"
+
+static char *read_file(FILE *file)
+{
+    fflush(file);
+    const size_t length = (size_t)ftell(file);
+    char *data = malloc(length + 1);
+
+    rewind(file);
+    data[fread(data, 1, length, file)] = '\0';
+    return data;
+}
+
+int main()
+{
+    FILE *file = tmpfile();
+    int failed = 0;
+
+    any_log_init(file, ANY_LOG_INFO);
+    for (int i = 0; i < 3; i++)
+        log_info("site %d", i);
+    log_error("other");
+
+    char *result = read_file(file);
+    failed += strcmp(result, "1 info: site 0\n2 info: site 1\n3 info: site 2\n4 error: other\n") != 0;
+
+    printf("custom prefix: %d failed\n", failed);
+
+    free(result);
+    fclose(file);
+    any_log_init(stdout, ANY_LOG_INFO);
+    return 0;
+}
@@ -0,0 +1,231 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ANY_LOG_IMPLEMENT
+#define ANY_LOG_MODULE "test"
+#include "any_log.h"
+
+// The prefixes kept by the call sites must be the same of the formatted
+// ones, also when the colors change
+
+#define LONG_MODULE "a module with a name so long that its prefix doesn't fit in the call site, " \
+                    "so it is formatted at every call instead"
+
+static void log_sites(int i)
+{
+    log_info("site %d", i);
+    log_error("site %d", i);
+#undef ANY_LOG_MODULE
+#define ANY_LOG_MODULE LONG_MODULE
+    log_warn("long %d", i);
+#undef ANY_LOG_MODULE
+#define ANY_LOG_MODULE "test"
+}
+
+static void log_formats(int i)
+{
+    any_log_format(ANY_LOG_INFO, "test", "log_sites", "site %d", i);
+    any_log_format(ANY_LOG_ERROR, "test", "log_sites", "site %d", i);
+    any_log_format(ANY_LOG_WARN, LONG_MODULE, "log_sites", "long %d", i);
+}
+
+static char *read_file(FILE *file)
+{
+    fflush(file);
+    const size_t length = (size_t)ftell(file);
+    char *data = malloc(length + 1);
+
+    rewind(file);
+    data[fread(data, 1, length, file)] = '\0';
+    return data;
+}
+
+void test_site_prefix(void)
+{
+    FILE *sites = tmpfile(), *formats = tmpfile();
+    const char **tables[] = { any_log_colors_default, any_log_colors_disabled, any_log_colors_default };
+    int failed = 0;
+
+    for (int i = 0; i < 3; i++) {
+        any_log_colors = tables[i];
+
+        any_log_init(sites, ANY_LOG_INFO);
+        log_sites(i);
+        log_sites(i);
+
+        any_log_init(formats, ANY_LOG_INFO);
+        log_formats(i);
+        log_formats(i);
+    }
+
+    char *expected = read_file(formats), *result = read_file(sites);
+    failed += strcmp(expected, result) != 0;
+
+    printf("site prefix: %d failed\n", failed);
+
+    free(expected);
+    free(result);
+    fclose(sites);
+    fclose(formats);
+}
+
+// The call sites must follow the levels of their module, also after the
+// levels or any_log_level change
+
+static void log_modules(void)
+{
+#undef ANY_LOG_MODULE
+#define ANY_LOG_MODULE "net"
+    log_trace("net trace");
+    log_info("net info");
+#undef ANY_LOG_MODULE
+#define ANY_LOG_MODULE "db"
+    log_info("db info");
+    log_warn("db warn");
+#undef ANY_LOG_MODULE
+#define ANY_LOG_MODULE "test"
+    log_debug("test debug");
+    log_info("test info");
+}
+
+static int count_lines(FILE *file)
+{
+    char *data = read_file(file);
+    int lines = 0;
+
+    for (char *c = data; *c != '\0'; c++)
+        lines += *c == '\n';
+
+    free(data);
+    fclose(file);
+    return lines;
+}
+
+static int test_levels(const char *spec, any_log_level_t level, int expected)
+{
+    FILE *file = tmpfile();
+    any_log_init(file, level);
+
+    if (spec != NULL && !any_log_set_levels(spec)) {
+        fclose(file);
+        return 1;
+    }
+
+    log_modules();
+    return count_lines(file) != expected;
+}
+
+void test_site_levels(void)
+{
+    int failed = 0;
+
+    any_log_colors = any_log_colors_disabled;
+
+    failed += test_levels(NULL, ANY_LOG_INFO, 4);
+    failed += test_levels("net=trace,db=warn,*=info", ANY_LOG_INFO, 4);
+    failed += test_levels(" net = trace , db=warn,, *=debug ", ANY_LOG_INFO, 5);
+    failed += test_levels("warn", ANY_LOG_INFO, 1);
+    failed += test_levels("net=error,db=error", ANY_LOG_INFO, 1);
+    failed += test_levels(NULL, ANY_LOG_PANIC, 0);
+
+    // The levels don't change when the spec is invalid
+    failed += any_log_set_levels("net=loud");
+    failed += any_log_set_levels("net=");
+    failed += any_log_set_levels("=info");
+    failed += test_levels(NULL, ANY_LOG_INFO, 1);
+
+    failed += any_log_module_level("net") != ANY_LOG_ERROR;
+    failed += any_log_module_level("db") != ANY_LOG_ERROR;
+    failed += any_log_module_level("other") != ANY_LOG_INFO;
+
+    failed += !any_log_set_levels("");
+    failed += any_log_module_level("net") != ANY_LOG_INFO;
+    failed += test_levels(NULL, ANY_LOG_TRACE, 6);
+
+    printf("site levels: %d failed\n", failed);
+}
+
+// The registered call sites can be enabled and disabled one by one, and
+// the disabled ones don't evaluate their arguments
+
+static int evaluated;
+
+enum { REGISTRY_LINE = __LINE__ };
+static void log_registry(void)
+{
+    log_trace("trace %d", ++evaluated);
+    log_info("info %d", ++evaluated);
+    log_error("error %d", ++evaluated);
+}
+
+static int test_registry(const char *pattern, any_log_site_state_t state, size_t sites, int expected)
+{
+    FILE *file = tmpfile();
+    int failed = 0;
+
+    any_log_init(file, ANY_LOG_INFO);
+    failed += pattern != NULL && any_log_sites_set(pattern, state) != sites;
+
+    evaluated = 0;
+    log_registry();
+    failed += evaluated != expected;
+    failed += count_lines(file) != expected;
+
+    return failed;
+}
+
+void test_site_registry(void)
+{
+    int failed = 0;
+
+#ifndef ANY_LOG_NO_REGISTRY
+    const any_log_level_t levels[] = { ANY_LOG_TRACE, ANY_LOG_INFO, ANY_LOG_ERROR };
+    size_t count, found = 0;
+    const any_log_site_info_t *sites = any_log_sites(&count);
+
+    for (size_t i = 0; i < count; i++) {
+        const any_log_site_info_t *info = &sites[i];
+        if (strcmp(info->func, "log_registry") != 0)
+            continue;
+
+        const int index = info->line - REGISTRY_LINE - 3;
+        failed += index < 0 || index > 2 || info->level != levels[index];
+        failed += strcmp(info->module, "test") != 0 || strcmp(info->file, __FILE__) != 0;
+        failed += info->site->state != ANY_LOG_SITE_DEFAULT;
+        found++;
+    }
+
+    failed += found != 3;
+
+    // The sites of log_sites, log_modules and log_registry
+    failed += test_registry(NULL, ANY_LOG_SITE_DEFAULT, 0, 2);
+    failed += test_registry("log_registry", ANY_LOG_SITE_DISABLED, 3, 0);
+    failed += test_registry("*log_site.c:*", ANY_LOG_SITE_ENABLED, 12, 3);
+    failed += test_registry("log_reg*", ANY_LOG_SITE_DEFAULT, 3, 2);
+    failed += test_registry("net", ANY_LOG_SITE_DISABLED, 2, 2);
+
+    // Only the log_info of log_registry
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "*log_si?e.c:%d", REGISTRY_LINE + 4);
+    failed += test_registry(pattern, ANY_LOG_SITE_DISABLED, 1, 1);
+
+    failed += test_registry("no_function", ANY_LOG_SITE_ENABLED, 0, 1);
+    failed += test_registry("*", ANY_LOG_SITE_DEFAULT, count, 2);
+#else
+    failed += test_registry(NULL, ANY_LOG_SITE_DEFAULT, 0, 2);
+#endif
+
+    printf("site registry: %d failed\n", failed);
+}
+
+int main()
+{
+    test_site_prefix();
+    test_site_levels();
+    test_site_registry();
+
+    any_log_colors = any_log_colors_default;
+    any_log_init(stdout, ANY_LOG_INFO);
+    return 0;
+}
@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <string.h>
+
+#define ANY_HASH_IMPLEMENT
+#include "any_hash.h"
+
+#define ANY_MAP_IMPLEMENT
+#include "any_map.h"
+
+// The maps are checked against arrays indexed by the key, with random
+// operations on a small set of keys, so that the table grows, shrinks its
+// clusters with the removals and wraps around
+
+#define KEYS 3000
+#define OPS 500000
+
+static uint64_t state = 0x9e3779b97f4a7c15;
+
+static uint64_t next_random(void)
+{
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+static bool present[KEYS];
+static void *values[KEYS];
+
+void test_int(void)
+{
+    any_map_int_t map;
+    any_map_int_init(&map, 42);
+    memset(present, 0, sizeof(present));
+
+    int failed = 0;
+    size_t count = 0;
+    for (int op = 0; op < OPS; op++) {
+        const uint64_t random = next_random();
+        const size_t key = random % KEYS;
+        void *value = (void *)(uintptr_t)(random >> 32);
+        void *found = NULL;
+
+        switch (random >> 60) {
+        case 0: case 1: case 2: case 3: case 4: case 5:
+            if (!any_map_int_put(&map, key * 0x100000001ull, value))
+                failed++;
+            count += !present[key];
+            present[key] = true;
+            values[key] = value;
+            break;
+        case 6: case 7: case 8: case 9: case 10:
+            if (any_map_int_remove(&map, key * 0x100000001ull) != present[key])
+                failed++;
+            count -= present[key];
+            present[key] = false;
+            break;
+        default:
+            if (any_map_int_get(&map, key * 0x100000001ull, &found) != present[key] ||
+                (present[key] && found != values[key]))
+                failed++;
+            break;
+        }
+
+        if (map.count != count)
+            failed++;
+    }
+
+    size_t iter = 0, visited = 0;
+    any_map_int_slot_t *slot;
+    while ((slot = any_map_int_next(&map, &iter)) != NULL) {
+        const size_t key = slot->key / 0x100000001ull;
+        if (key >= KEYS || !present[key] || slot->value != values[key])
+            failed++;
+        visited++;
+    }
+    if (visited != count)
+        failed++;
+
+    printf("map int: %d ops, %zu keys, capacity %zu, %d failed\n", OPS, count, map.capacity, failed);
+    any_map_int_free(&map);
+}
+
+void test_str(void)
+{
+    static char keys[KEYS][16];
+    for (size_t i = 0; i < KEYS; i++)
+        snprintf(keys[i], sizeof(keys[i]), "key.%zu", i * 7919);
+
+    any_map_str_t map;
+    any_map_str_init(&map, 42);
+    memset(present, 0, sizeof(present));
+
+    int failed = 0;
+    size_t count = 0;
+    for (int op = 0; op < OPS; op++) {
+        const uint64_t random = next_random();
+        const size_t key = random % KEYS;
+        void *value = (void *)(uintptr_t)(random >> 32);
+        void *found = NULL;
+
+        // Look up a copy, the map must compare the contents
+        char copy[16];
+        memcpy(copy, keys[key], sizeof(copy));
+        const size_t length = strlen(copy);
+
+        switch (random >> 60) {
+        case 0: case 1: case 2: case 3: case 4: case 5:
+            if (!any_map_str_put(&map, keys[key], length, value))
+                failed++;
+            count += !present[key];
+            present[key] = true;
+            values[key] = value;
+            break;
+        case 6: case 7: case 8: case 9: case 10:
+            if (any_map_str_remove(&map, copy, length) != present[key])
+                failed++;
+            count -= present[key];
+            present[key] = false;
+            break;
+        default:
+            if (any_map_str_get(&map, copy, length, &found) != present[key] ||
+                (present[key] && found != values[key]))
+                failed++;
+            // A longer key with the same prefix is not in the map
+            copy[length] = 'x';
+            if (any_map_str_get(&map, copy, length + 1, NULL))
+                failed++;
+            break;
+        }
+
+        if (map.count != count)
+            failed++;
+    }
+
+    size_t iter = 0, visited = 0;
+    any_map_str_slot_t *slot;
+    while ((slot = any_map_str_next(&map, &iter)) != NULL) {
+        const size_t key = (size_t)(((const char (*)[16])slot->key) - keys);
+        if (key >= KEYS || !present[key] || slot->value != values[key])
+            failed++;
+        visited++;
+    }
+    if (visited != count)
+        failed++;
+
+    printf("map str: %d ops, %zu keys, capacity %zu, %d failed\n", OPS, count, map.capacity, failed);
+    any_map_str_free(&map);
+}
+
+// Empty keys, reserve and an empty map
+void test_edge(void)
+{
+    int failed = 0;
+
+    any_map_str_t map;
+    any_map_str_init(&map, 0);
+    failed += any_map_str_get(&map, "", 0, NULL);
+    failed += any_map_str_remove(&map, "a", 1);
+
+    failed += !any_map_str_reserve(&map, 1000);
+    const size_t capacity = map.capacity;
+    for (int i = 0; i < 1000; i++)
+        failed += !any_map_str_put(&map, "", 0, (void *)(uintptr_t)i);
+    failed += map.count != 1 || map.capacity != capacity;
+
+    void *value;
+    failed += !any_map_str_get(&map, "", 0, &value) || value != (void *)999;
+    failed += !any_map_str_remove(&map, "", 0) || map.count != 0;
+    any_map_str_free(&map);
+
+    printf("map edge: %d failed\n", failed);
+}
+
+int main()
+{
+    test_int();
+    test_str();
+    test_edge();
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ANY_HASH_IMPLEMENT
+#include "any_hash.h"
+
+#define ANY_MPHF_IMPLEMENT
+#include "any_mphf.h"
+
+// The indexes of the keys must be a permutation of [0, n), the keys outside
+// the set must be rejected and the loaded tables must give the same indexes
+// of the built ones
+
+#define KEYS 100000
+#define PROBES 100000
+
+static char keys[KEYS + PROBES][24];
+static const uint8_t *pointers[KEYS + PROBES];
+static size_t lengths[KEYS + PROBES];
+static uint8_t seen[KEYS];
+
+void test_mphf(size_t count)
+{
+    any_mphf_t mphf;
+    if (!any_mphf_build(&mphf, pointers, lengths, count, 42)) {
+        printf("mphf(%zu): build failed\n", count);
+        return;
+    }
+
+    int failed = 0;
+
+    memset(seen, 0, count);
+    for (size_t i = 0; i < count; i++) {
+        const size_t index = any_mphf_find(&mphf, pointers[i], lengths[i]);
+        if (index >= count || seen[index]++ || index != any_mphf_index(&mphf, pointers[i], lengths[i])) {
+            failed++;
+            continue;
+        }
+
+        size_t length;
+        const uint8_t *key = any_mphf_key(&mphf, index, &length);
+        failed += length != lengths[i] || memcmp(key, pointers[i], length) != 0;
+    }
+
+    for (size_t i = KEYS; i < KEYS + PROBES; i++)
+        failed += any_mphf_find(&mphf, pointers[i], lengths[i]) != SIZE_MAX;
+
+    // Load a copy of the serialized table
+    const size_t size = any_mphf_serialized_size(&mphf);
+    uint8_t *buffer = malloc(size);
+    any_mphf_serialize(&mphf, buffer);
+
+    any_mphf_t loaded;
+    if (!any_mphf_load(&loaded, buffer, size)) {
+        printf("mphf(%zu): load failed\n", count);
+        failed++;
+    } else {
+        for (size_t i = 0; i < KEYS + PROBES; i++) {
+            const size_t index = any_mphf_find(&loaded, pointers[i], lengths[i]);
+            failed += index != any_mphf_find(&mphf, pointers[i], lengths[i]);
+        }
+        any_mphf_free(&loaded);
+    }
+
+    // Truncated or corrupted tables are rejected
+    failed += any_mphf_load(&loaded, buffer, size - 1);
+    buffer[0] = 'X';
+    failed += any_mphf_load(&loaded, buffer, size);
+
+    printf("mphf(%zu): %.2f bits per key, %d failed\n",
+           count, count ? 32.0 * mphf.buckets / count : 0.0, failed);
+
+    free(buffer);
+    any_mphf_free(&mphf);
+}
+
+// A repeated key must make the build fail
+void test_mphf_repeated(void)
+{
+    const uint8_t *repeated[3] = { pointers[0], pointers[1], pointers[0] };
+    const size_t repeated_lengths[3] = { lengths[0], lengths[1], lengths[0] };
+
+    any_mphf_t mphf;
+    const bool built = any_mphf_build(&mphf, repeated, repeated_lengths, 3, 42);
+    if (built)
+        any_mphf_free(&mphf);
+
+    printf("mphf repeated: %d failed\n", built);
+}
+
+int main()
+{
+    for (size_t i = 0; i < KEYS + PROBES; i++) {
+        lengths[i] = snprintf(keys[i], sizeof(keys[i]), "config.key%zu", i * 2654435761u);
+        pointers[i] = (const uint8_t *)keys[i];
+    }
+
+    test_mphf(0);
+    test_mphf(1);
+    test_mphf(7);
+    test_mphf(1000);
+    test_mphf(KEYS);
+    test_mphf_repeated();
+    return 0;
+}
@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define ANY_HASH_IMPLEMENT
+#include "any_hash.h"
+
+#define ANY_SHARD_IMPLEMENT
+#include "any_shard.h"
+
+// Add and remove buckets and nodes and check that only the keys that must
+// move change their assignment, and that the shares are balanced
+
+#define KEYS 100000
+
+static uint64_t hashes[KEYS];
+static int32_t before[KEYS], after[KEYS];
+static size_t node_before[KEYS], node_after[KEYS];
+
+void test_jump(void)
+{
+    int failed = 0;
+
+    for (int32_t buckets = 1; buckets <= 64; buckets++) {
+        any_shard_jump_batch(hashes, KEYS, buckets, before);
+        any_shard_jump_batch(hashes, KEYS, buckets + 1, after);
+
+        size_t moved = 0;
+        for (size_t i = 0; i < KEYS; i++) {
+            failed += before[i] != any_shard_jump(hashes[i], buckets);
+            failed += before[i] < 0 || before[i] >= buckets;
+
+            // The keys that move go to the new bucket
+            if (before[i] != after[i]) {
+                failed += after[i] != buckets;
+                moved++;
+            }
+        }
+
+        // About 1 / (n + 1) of the keys move
+        const double expected = (double)KEYS / (buckets + 1);
+        if (fabs(moved - expected) > 5 * sqrt(expected)) {
+            printf("jump(%d -> %d): %zu moved (expected %.0f)\n", buckets, buckets + 1, moved, expected);
+            failed++;
+        }
+    }
+
+    printf("jump: 64 resizes, %d failed\n", failed);
+}
+
+void test_rendezvous(void)
+{
+    any_shard_node_t nodes[16];
+    char name[32];
+    for (size_t i = 0; i < 16; i++) {
+        const int length = snprintf(name, sizeof(name), "10.0.0.%zu:8080", i);
+        any_shard_node_init(&nodes[i], name, length, i < 8 ? 1.0 : 2.0);
+    }
+
+    int failed = 0;
+
+    // Adding a node moves keys only to it, about weight / total of them
+    double total = 0;
+    for (size_t count = 1; count < 16; count++) {
+        total += nodes[count - 1].weight;
+        any_shard_rendezvous_batch(nodes, count, hashes, KEYS, node_before);
+        any_shard_rendezvous_batch(nodes, count + 1, hashes, KEYS, node_after);
+
+        size_t moved = 0;
+        for (size_t i = 0; i < KEYS; i++) {
+            failed += node_before[i] != any_shard_rendezvous(nodes, count, hashes[i]);
+            if (node_before[i] != node_after[i]) {
+                failed += node_after[i] != count;
+                moved++;
+            }
+        }
+
+        const double expected = KEYS * nodes[count].weight / (total + nodes[count].weight);
+        if (fabs(moved - expected) > 5 * sqrt(expected)) {
+            printf("rendezvous(%zu -> %zu): %zu moved (expected %.0f)\n", count, count + 1, moved, expected);
+            failed++;
+        }
+    }
+
+    // Removing a node in the middle moves only its keys, the others keep
+    // their node (shifted by one index)
+    any_shard_rendezvous_batch(nodes, 16, hashes, KEYS, node_before);
+
+    any_shard_node_t removed[15];
+    for (size_t i = 0, j = 0; i < 16; i++) {
+        if (i != 5)
+            removed[j++] = nodes[i];
+    }
+    any_shard_rendezvous_batch(removed, 15, hashes, KEYS, node_after);
+
+    size_t shares[16] = { 0 };
+    for (size_t i = 0; i < KEYS; i++) {
+        shares[node_before[i]]++;
+        if (node_before[i] != 5)
+            failed += node_after[i] != node_before[i] - (node_before[i] > 5);
+    }
+
+    // A node of weight 2 has twice the keys of one of weight 1
+    for (size_t i = 0; i < 16; i++) {
+        const double expected = KEYS * nodes[i].weight / 24;
+        if (fabs(shares[i] - expected) > 5 * sqrt(expected)) {
+            printf("rendezvous share of node %zu: %zu (expected %.0f)\n", i, shares[i], expected);
+            failed++;
+        }
+    }
+
+    failed += any_shard_rendezvous(nodes, 0, hashes[0]) != SIZE_MAX;
+
+    // The nodes without weight get no keys
+    removed[0].weight = removed[1].weight = 0;
+    any_shard_rendezvous_batch(removed, 2, hashes, KEYS, node_after);
+    for (size_t i = 0; i < KEYS; i++)
+        failed += node_after[i] != SIZE_MAX;
+
+    removed[1].weight = 1;
+    any_shard_rendezvous_batch(removed, 2, hashes, KEYS, node_after);
+    for (size_t i = 0; i < KEYS; i++)
+        failed += node_after[i] != 1;
+
+    printf("rendezvous: 16 nodes, %d failed\n", failed);
+}
+
+int main()
+{
+    for (size_t i = 0; i < KEYS; i++)
+        hashes[i] = any_hash_xxh64_u64(i, 0);
+
+    test_jump();
+    test_rendezvous();
+    return 0;
+}
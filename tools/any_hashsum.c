@@ -0,0 +1,294 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#define ANY_HASH_IMPLEMENT
+#include "any_hash.h"
+
+// A replacement for xxhsum built on any_hash.
+//
+// Usage: any_hashsum [-H0|-H1] [--tag] [files...]
+//        any_hashsum -c [--quiet|--status] [files...]
+//
+// The output is the same of xxhsum: the canonical (big endian) hash in hex,
+// two spaces and the file name, or with --tag the BSD format. Without files,
+// or with "-", the standard input is hashed.
+//
+// Only xxh32 (-H0) and xxh64 (-H1, the default) are supported.
+
+typedef enum {
+    ALGORITHM_XXH32,
+    ALGORITHM_XXH64,
+} algorithm_t;
+
+static const char *program = "any_hashsum";
+
+static const char *algorithm_names[] = { "XXH32", "XXH64" };
+
+static bool hash_file(const char *path, algorithm_t algorithm, uint64_t *hash)
+{
+    const bool input = strcmp(path, "-") == 0;
+
+    if (algorithm == ALGORITHM_XXH32) {
+        any_hash32_t hash32;
+        const bool success = input
+            ? any_hash_fd_xxh32(0, 0, &hash32)
+            : any_hash_file_xxh32(path, 0, &hash32);
+
+        if (success)
+            *hash = hash32;
+        return success;
+    }
+
+    return input
+        ? any_hash_fd_xxh64(0, 0, hash)
+        : any_hash_file_xxh64(path, 0, hash);
+}
+
+// File names with a newline or a backslash are escaped and the line starts
+// with a backslash, like in GNU coreutils
+static bool needs_escape(const char *name)
+{
+    return strchr(name, '\n') != NULL || strchr(name, '\\') != NULL;
+}
+
+static void print_name(const char *name, bool escape)
+{
+    for (; *name; name++) {
+        if (escape && *name == '\n')
+            fputs("\\n", stdout);
+        else if (escape && *name == '\\')
+            fputs("\\\\", stdout);
+        else
+            putchar(*name);
+    }
+}
+
+static void print_hash(uint64_t hash, algorithm_t algorithm)
+{
+    if (algorithm == ALGORITHM_XXH32)
+        printf("%08llx", (unsigned long long)hash);
+    else
+        printf("%016llx", (unsigned long long)hash);
+}
+
+static int sum_files(char **files, int count, algorithm_t algorithm, bool tag)
+{
+    int status = 0;
+
+    for (int i = 0; i < count; i++) {
+        uint64_t hash;
+        if (!hash_file(files[i], algorithm, &hash)) {
+            fprintf(stderr, "%s: %s: %s\n", program, files[i], strerror(errno));
+            status = 1;
+            continue;
+        }
+
+        const char *name = strcmp(files[i], "-") == 0 ? "stdin" : files[i];
+        const bool escape = needs_escape(name);
+
+        if (escape)
+            putchar('\\');
+
+        if (tag) {
+            printf("%s (", algorithm_names[algorithm]);
+            print_name(name, escape);
+            printf(") = ");
+            print_hash(hash, algorithm);
+        } else {
+            print_hash(hash, algorithm);
+            printf("  ");
+            print_name(name, escape);
+        }
+        putchar('\n');
+    }
+
+    return status;
+}
+
+// Undo the escaping of print_name in place
+static void unescape(char *name)
+{
+    char *out = name;
+    for (; *name; name++) {
+        if (name[0] == '\\' && name[1] == 'n') {
+            *out++ = '\n';
+            name++;
+        } else if (name[0] == '\\' && name[1] == '\\') {
+            *out++ = '\\';
+            name++;
+        } else
+            *out++ = *name;
+    }
+    *out = '\0';
+}
+
+// Parse a line in the GNU or BSD format, the algorithm is deduced from the
+// length of the hash or from the tag
+static bool parse_line(char *line, char **name, char **hex, algorithm_t *algorithm)
+{
+    line[strcspn(line, "\r\n")] = '\0';
+
+    const bool escape = line[0] == '\\';
+    if (escape)
+        line++;
+
+    char *end;
+    if (strncmp(line, "XXH32 (", 7) == 0 || strncmp(line, "XXH64 (", 7) == 0) {
+        *algorithm = line[4] == '2' ? ALGORITHM_XXH32 : ALGORITHM_XXH64;
+        end = strstr(line, ") = ");
+        if (end == NULL)
+            return false;
+
+        *end = '\0';
+        *name = line + 7;
+        *hex = end + 4;
+    } else {
+        end = strstr(line, "  ");
+        if (end == NULL)
+            return false;
+
+        *end = '\0';
+        *hex = line;
+        *name = end + 2;
+
+        if (strlen(*hex) == 8)
+            *algorithm = ALGORITHM_XXH32;
+        else if (strlen(*hex) == 16)
+            *algorithm = ALGORITHM_XXH64;
+        else
+            return false;
+    }
+
+    if (strlen(*hex) != (*algorithm == ALGORITHM_XXH32 ? 8 : 16) || strspn(*hex, "0123456789abcdefABCDEF") != strlen(*hex))
+        return false;
+
+    if (escape)
+        unescape(*name);
+
+    return true;
+}
+
+static int check_file(FILE *file, const char *path, bool quiet, bool status_only)
+{
+    char line[4096];
+    int failed = 0, unreadable = 0, malformed = 0;
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char *name, *hex;
+        algorithm_t algorithm;
+
+        if (!parse_line(line, &name, &hex, &algorithm)) {
+            malformed++;
+            continue;
+        }
+
+        uint64_t hash;
+        if (!hash_file(name, algorithm, &hash)) {
+            if (!status_only)
+                printf("%s: FAILED open or read\n", name);
+            unreadable++;
+            continue;
+        }
+
+        if (hash != strtoull(hex, NULL, 16)) {
+            if (!status_only)
+                printf("%s: FAILED\n", name);
+            failed++;
+        } else if (!quiet && !status_only)
+            printf("%s: OK\n", name);
+    }
+
+    if (!status_only) {
+        if (malformed > 0)
+            fprintf(stderr, "%s: %s: %d lines are improperly formatted\n", program, path, malformed);
+        if (unreadable > 0)
+            fprintf(stderr, "%s: %s: %d listed files could not be read\n", program, path, unreadable);
+        if (failed > 0)
+            fprintf(stderr, "%s: %s: %d computed checksums did NOT match\n", program, path, failed);
+    }
+
+    return failed > 0 || unreadable > 0 || malformed > 0;
+}
+
+static int check_files(char **files, int count, bool quiet, bool status_only)
+{
+    int status = 0;
+
+    for (int i = 0; i < count; i++) {
+        const bool input = strcmp(files[i], "-") == 0;
+
+        FILE *file = input ? stdin : fopen(files[i], "r");
+        if (file == NULL) {
+            fprintf(stderr, "%s: %s: %s\n", program, files[i], strerror(errno));
+            status = 1;
+            continue;
+        }
+
+        status |= check_file(file, input ? "stdin" : files[i], quiet, status_only);
+
+        if (!input)
+            fclose(file);
+    }
+
+    return status;
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "Usage: %s [-H0|-H1] [--tag] [files...]\n"
+            "       %s -c [--quiet|--status] [files...]\n"
+            "\n"
+            "  -H0       use xxh32\n"
+            "  -H1       use xxh64 (default)\n"
+            "  --tag     print the hashes in the BSD format\n"
+            "  -c        check the hashes listed in the files\n"
+            "  --quiet   don't print OK for the files that match\n"
+            "  --status  don't print anything, only set the exit status\n",
+            program, program);
+}
+
+int main(int argc, char **argv)
+{
+    algorithm_t algorithm = ALGORITHM_XXH64;
+    bool tag = false, check = false, quiet = false, status_only = false;
+    int first = 1;
+
+    for (; first < argc && argv[first][0] == '-' && argv[first][1] != '\0'; first++) {
+        const char *option = argv[first];
+
+        if (strcmp(option, "--") == 0) {
+            first++;
+            break;
+        } else if (strcmp(option, "-H0") == 0 || strcmp(option, "-H32") == 0)
+            algorithm = ALGORITHM_XXH32;
+        else if (strcmp(option, "-H1") == 0 || strcmp(option, "-H64") == 0)
+            algorithm = ALGORITHM_XXH64;
+        else if (strcmp(option, "--tag") == 0)
+            tag = true;
+        else if (strcmp(option, "-c") == 0 || strcmp(option, "--check") == 0)
+            check = true;
+        else if (strcmp(option, "-q") == 0 || strcmp(option, "--quiet") == 0)
+            quiet = true;
+        else if (strcmp(option, "--status") == 0)
+            status_only = true;
+        else if (strcmp(option, "-h") == 0 || strcmp(option, "--help") == 0) {
+            usage();
+            return 0;
+        } else {
+            fprintf(stderr, "%s: unsupported option '%s'\n", program, option);
+            usage();
+            return 1;
+        }
+    }
+
+    static char *input[] = { "-" };
+    char **files = first < argc ? argv + first : input;
+    const int count = first < argc ? argc - first : 1;
+
+    return check
+        ? check_files(files, count, quiet, status_only)
+        : sum_files(files, count, algorithm, tag);
+}
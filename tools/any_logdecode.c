@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#define ANY_LOG_IMPLEMENT
+#include "any_log.h"
+
+// The decoder of the logs written in the binary mode of any_log.
+//
+// Usage: any_logdecode [--color] [--no-time] [files...]
+//
+// The records are printed with the default text format of any_log, after
+// their local time. Without files, or with "-", the standard input is
+// decoded.
+
+static const char *program = "any_logdecode";
+
+#ifndef ANY_LOG_NO_BINARY
+
+static char *read_all(FILE *file, size_t *length)
+{
+    size_t capacity = 1 << 16;
+    char *data = malloc(capacity);
+    *length = 0;
+
+    while (data != NULL) {
+        *length += fread(data + *length, 1, capacity - *length, file);
+        if (*length < capacity)
+            break;
+
+        capacity *= 2;
+        char *grown = realloc(data, capacity);
+        if (grown == NULL)
+            free(data);
+        data = grown;
+    }
+
+    if (data != NULL && ferror(file)) {
+        free(data);
+        data = NULL;
+    }
+
+    return data;
+}
+
+static int decode_file(const char *path, bool timestamps)
+{
+    const bool input = strcmp(path, "-") == 0;
+    FILE *file = input ? stdin : fopen(path, "rb");
+
+    if (file == NULL) {
+        fprintf(stderr, "%s: %s: %s\n", program, path, strerror(errno));
+        return 1;
+    }
+
+    size_t length;
+    char *data = read_all(file, &length);
+    int status = 0;
+
+    if (data == NULL) {
+        fprintf(stderr, "%s: %s: %s\n", program, path, strerror(errno));
+        status = 1;
+    } else if (!any_log_decode(data, length, stdout, timestamps)) {
+        fprintf(stderr, "%s: %s: not a valid binary log\n", program, path);
+        status = 1;
+    }
+
+    free(data);
+    if (!input)
+        fclose(file);
+
+    return status;
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "Usage: %s [--color] [--no-time] [files...]\n"
+            "\n"
+            "  --color    print the colors of the default format\n"
+            "  --no-time  don't print the time of the records\n",
+            program);
+}
+
+int main(int argc, char **argv)
+{
+    bool timestamps = true;
+    int first = 1;
+
+    any_log_colors = any_log_colors_disabled;
+
+    for (; first < argc && argv[first][0] == '-' && argv[first][1] != '\0'; first++) {
+        const char *option = argv[first];
+
+        if (strcmp(option, "--") == 0) {
+            first++;
+            break;
+        } else if (strcmp(option, "--color") == 0)
+            any_log_colors = any_log_colors_default;
+        else if (strcmp(option, "--no-time") == 0)
+            timestamps = false;
+        else if (strcmp(option, "-h") == 0 || strcmp(option, "--help") == 0) {
+            usage();
+            return 0;
+        } else {
+            fprintf(stderr, "%s: unsupported option '%s'\n", program, option);
+            usage();
+            return 1;
+        }
+    }
+
+    int status = 0;
+
+    if (first == argc)
+        return decode_file("-", timestamps);
+
+    for (int i = first; i < argc; i++)
+        status |= decode_file(argv[i], timestamps);
+
+    return status;
+}
+
+#else
+
+int main(void)
+{
+    fprintf(stderr, "%s: any_log was built without the binary mode\n", program);
+    return 1;
+}
+
+#endif